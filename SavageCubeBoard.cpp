@@ -0,0 +1,116 @@
+#include "SavageCubeBoard.h"
+
+#include <cassert>
+
+#include "BH3D_JobSystem.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SAVAGE_CUBE_SSE
+#include <emmintrin.h>
+#endif
+
+void SavageCubeBoard::Clear()
+{
+	m_vPositionX.clear();
+	m_vPositionY.clear();
+	m_vPositionZ.clear();
+	m_vStatus.clear();
+	m_vTransforms.clear();
+	m_transformsDirty = false;
+}
+
+void SavageCubeBoard::Reserve(std::size_t count)
+{
+	m_vPositionX.reserve(count);
+	m_vPositionY.reserve(count);
+	m_vPositionZ.reserve(count);
+	m_vStatus.reserve(count);
+}
+
+std::size_t SavageCubeBoard::Add(const glm::vec3& position, int status)
+{
+	assert(status >= 0 && status < 256);
+
+	m_vPositionX.push_back(position.x);
+	m_vPositionY.push_back(position.y);
+	m_vPositionZ.push_back(position.z);
+	m_vStatus.push_back((std::uint8_t)status);
+	m_transformsDirty = true;
+
+	return m_vStatus.size() - 1;
+}
+
+void SavageCubeBoard::SetAnimation(const glm::mat4& animation)
+{
+	if (animation == m_animation)
+		return;
+	m_animation = animation;
+	m_transformsDirty = true;
+}
+
+const std::vector<glm::mat4>& SavageCubeBoard::GetTransforms() const
+{
+	if (m_transformsDirty)
+	{
+		UpdateTransforms();
+		m_transformsDirty = false;
+	}
+	return m_vTransforms;
+}
+
+void SavageCubeBoard::UpdateTransforms() const
+{
+	const std::size_t count = m_vStatus.size();
+	m_vTransforms.resize(count);
+	if (count == 0)
+		return;
+
+	//The cubes are independent : the ranges are computed by the job system workers
+	constexpr std::size_t grain = 4096;
+	bh3d::JobSystem::Default().ParallelFor(0, count, grain, [this](std::size_t begin, std::size_t end) {
+		UpdateTransforms(begin, end);
+	});
+}
+
+void SavageCubeBoard::UpdateTransforms(std::size_t begin, std::size_t end) const
+{
+	const glm::mat4& animation = m_animation;
+	const float* px = m_vPositionX.data();
+	const float* py = m_vPositionY.data();
+	const float* pz = m_vPositionZ.data();
+	float* dst = &m_vTransforms[begin][0][0];
+
+#ifdef SAVAGE_CUBE_SSE
+	//translate(p) * A : each column j of the result is A_j + (p, 0) * A_j.w
+	const __m128 a0 = _mm_loadu_ps(&animation[0][0]);
+	const __m128 a1 = _mm_loadu_ps(&animation[1][0]);
+	const __m128 a2 = _mm_loadu_ps(&animation[2][0]);
+	const __m128 a3 = _mm_loadu_ps(&animation[3][0]);
+	const __m128 w0 = _mm_set1_ps(animation[0][3]);
+	const __m128 w1 = _mm_set1_ps(animation[1][3]);
+	const __m128 w2 = _mm_set1_ps(animation[2][3]);
+	const __m128 w3 = _mm_set1_ps(animation[3][3]);
+
+	for (std::size_t i = begin; i < end; i++, dst += 16)
+	{
+		const __m128 p = _mm_set_ps(0.0f, pz[i], py[i], px[i]);
+		_mm_storeu_ps(dst + 0, _mm_add_ps(a0, _mm_mul_ps(p, w0)));
+		_mm_storeu_ps(dst + 4, _mm_add_ps(a1, _mm_mul_ps(p, w1)));
+		_mm_storeu_ps(dst + 8, _mm_add_ps(a2, _mm_mul_ps(p, w2)));
+		_mm_storeu_ps(dst + 12, _mm_add_ps(a3, _mm_mul_ps(p, w3)));
+	}
+#else
+	for (std::size_t i = begin; i < end; i++, dst += 16)
+	{
+		const glm::vec4 p(px[i], py[i], pz[i], 0.0f);
+		for (int j = 0; j < 4; j++)
+		{
+			const glm::vec4 col = animation[j] + p * animation[j][3];
+			dst[j * 4 + 0] = col.x;
+			dst[j * 4 + 1] = col.y;
+			dst[j * 4 + 2] = col.z;
+			dst[j * 4 + 3] = col.w;
+		}
+	}
+#endif
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+//! Structure of arrays storing the cubes of a board.
+//! A cube is only a position and a status, its world matrix is derived in bulk on demand (see GetTransforms)
+class SavageCubeBoard
+{
+	//Cube position streams (world position of the cube cell)
+	std::vector<float> m_vPositionX;
+	std::vector<float> m_vPositionY;
+	std::vector<float> m_vPositionZ;
+
+	//Cube status stream (CubeStatus / texture layer)
+	std::vector<std::uint8_t> m_vStatus;
+
+	//Derived stream : world matrix of each cube = translate(position) * animation
+	//Only computed when read (see GetTransforms) : the GPU draws with the shared animation
+	mutable std::vector<glm::mat4> m_vTransforms;
+	mutable bool m_transformsDirty = false;
+
+	glm::mat4 m_animation = glm::mat4(1.0f);		//Animation shared by all the cubes
+
+public:
+
+	void Clear();
+	void Reserve(std::size_t count);
+
+	//! Adds a cube and returns its id
+	std::size_t Add(const glm::vec3& position, int status);
+
+	inline std::size_t Size() const { return m_vStatus.size(); }
+	inline bool Empty() const { return m_vStatus.empty(); }
+
+	inline glm::vec3 GetPosition(std::size_t id) const { return { m_vPositionX[id], m_vPositionY[id], m_vPositionZ[id] }; }
+	inline int GetStatus(std::size_t id) const { return m_vStatus[id]; }
+	inline void SetStatus(std::size_t id, int status) { m_vStatus[id] = (std::uint8_t)status; }
+
+	inline const std::vector<float>& GetPositionsX() const { return m_vPositionX; }
+	inline const std::vector<float>& GetPositionsY() const { return m_vPositionY; }
+	inline const std::vector<float>& GetPositionsZ() const { return m_vPositionZ; }
+	inline const std::vector<std::uint8_t>& GetStatuses() const { return m_vStatus; }
+
+	//! Changes the animation shared by all the cubes, the world matrices are recomputed at the next GetTransforms
+	void SetAnimation(const glm::mat4& animation);
+	inline const glm::mat4& GetAnimation() const { return m_animation; }
+
+	//! World matrix of every cube : translate(position) * animation. Recomputed if the animation or the board changed.
+	const std::vector<glm::mat4>& GetTransforms() const;
+
+private:
+
+	//! Composes the world matrix of all the cubes with the animation matrix : translate(position) * animation
+	//! SSE kernel when available (the translation only changes the 4th row operations : col_j = anim_j + position * anim_j.w)
+	//! The board is split in ranges computed in parallel by the job system
+	void UpdateTransforms() const;
+
+	//! Transform kernel on the cubes [begin, end[
+	void UpdateTransforms(std::size_t begin, std::size_t end) const;
+};
@@ -0,0 +1,113 @@
+#include "SavageCubeChunk.h"
+
+#include "BH3D_Cube.hpp"
+#include "BH3D_Shader.hpp"
+
+#include <cstddef>
+
+//Per instance vertex format of the cube chunks
+using CubeInstanceFormat = bh3d::VertexFormat<
+	bh3d::VertexElement<bh3d::INSTANCE_ATTRIB_INDEX::POSITION, glm::vec3>,
+	bh3d::VertexElement<bh3d::INSTANCE_ATTRIB_INDEX::DATA0, int>>;
+
+static_assert(CubeInstanceFormat::stride == sizeof(CubeInstance)
+	&& CubeInstanceFormat::offsets[0] == offsetof(CubeInstance, m_position)
+	&& CubeInstanceFormat::offsets[1] == offsetof(CubeInstance, m_layer), "CubeInstance doesn't match its vertex format");
+
+bool SavageCubeChunk::Init(const SavageCubeBoard& board, std::size_t first, std::size_t count, const glm::vec3& cube_size)
+{
+	assert(count > 0 && first + count <= board.Size());
+
+	m_first = first;
+	m_count = count;
+
+	m_boxMin = m_boxMax = board.GetPosition(first);
+	for (std::size_t i = first + 1; i < first + count; i++)
+	{
+		m_boxMin = glm::min(m_boxMin, board.GetPosition(i));
+		m_boxMax = glm::max(m_boxMax, board.GetPosition(i));
+	}
+
+	m_mesh.Destroy();
+	bh3d::Cube::AddSubMesh(m_mesh, cube_size);
+
+	//Per instance data (streamed in the slots of the instance buffer, see Remesh)
+	CubeInstanceFormat::AddArrayBufferData(m_mesh.GetVBO(), nullptr, 0, 1);
+
+	if (!m_mesh.ComputeMesh())
+		return false;
+
+	if (!m_mesh.GetVBO().CreateInstanceStream((GLuint)count, sizeof(CubeInstance)))
+		return false;
+
+	m_dirty = true;
+	Remesh(board);
+
+	return true;
+}
+
+void SavageCubeChunk::Remesh(const SavageCubeBoard& board)
+{
+	if (!m_dirty)
+		return;
+
+	m_vInstances.resize(m_count);
+	for (std::size_t i = 0; i < m_count; i++)
+		m_vInstances[i] = CubeInstance{ board.GetPosition(m_first + i), board.GetStatus(m_first + i) };
+
+	m_mesh.GetVBO().MarkInstanceStreamDirty(0, (GLuint)m_count);
+	m_dirty = false;
+}
+
+std::size_t SavageCubeChunk::Draw(const SavageCubeBoard& board, const bh3d::Frustum* frustum, const glm::vec3& anim_center, const glm::vec3& anim_half_size, std::vector<std::uint8_t>& vVisible)
+{
+	m_vVisibleRuns.clear();
+	std::size_t visibleCount = m_count;
+
+	if (frustum)
+	{
+		//Whole chunk rejected by its box
+		const glm::vec3 center = 0.5f * (m_boxMin + m_boxMax) + anim_center;
+		const glm::vec3 half_size = 0.5f * (m_boxMax - m_boxMin) + anim_half_size;
+		if (!frustum->IsVisible(center, half_size))
+			return 0;
+
+		//Whole chunk accepted by its box : the cubes are not tested
+		if (frustum->IsInside(center, half_size))
+			frustum = nullptr;
+	}
+
+	if (frustum)
+	{
+		vVisible.resize(m_count);
+		visibleCount = frustum->CullBoxes(m_count,
+			board.GetPositionsX().data() + m_first, board.GetPositionsY().data() + m_first, board.GetPositionsZ().data() + m_first,
+			anim_center, anim_half_size, vVisible.data());
+
+		//Consecutive visible cubes are drawn with a single call
+		for (std::size_t i = 0; i < m_count;)
+		{
+			if (!vVisible[i]) { i++; continue; }
+			std::size_t first = i;
+			while (i < m_count && vVisible[i])
+				i++;
+			m_vVisibleRuns.emplace_back((GLuint)first, (GLsizei)(i - first));
+		}
+	}
+	else
+	{
+		m_vVisibleRuns.emplace_back(0, (GLsizei)m_count);
+	}
+
+	if (m_vVisibleRuns.empty())
+		return 0;
+
+	//Copy of the remeshed instances in the next slot of the instance stream (a clean chunk is not rewritten)
+	const GLuint baseInstance = m_mesh.GetVBO().CommitInstanceStream(m_vInstances.data());
+
+	m_mesh.BindVBO();
+	for (const auto& run : m_vVisibleRuns)
+		m_mesh.DrawSubMeshElementsInstanced(0, run.second, baseInstance + run.first);
+
+	return visibleCount;
+}
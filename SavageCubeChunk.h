@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "BH3D_Mesh.hpp"
+#include "BH3D_Frustum.hpp"
+#include "SavageCubeBoard.h"
+
+//! Per instance data of a cube, stored in the instance buffer of the chunk vbo
+struct CubeInstance
+{
+	glm::vec3 m_position;	//! Instance translation (shader attribute 14)
+	int m_layer = 0;		//! Texture array layer (shader attribute 13)
+};
+
+//! Cubes of a block of SIZE x SIZE x SIZE board cells.
+//! The cubes of a chunk are consecutive in the board (ids [first, first + count[) and are drawn with the own mesh and instance stream of the chunk.
+//! A status change only marks its chunk dirty, and only the dirty chunks are rebuilt and uploaded (see Remesh).
+class SavageCubeChunk
+{
+	bh3d::Mesh m_mesh;
+
+	std::size_t m_first = 0;		//! First board id of the chunk
+	std::size_t m_count = 0;		//! Cube number of the chunk
+
+	glm::vec3 m_boxMin = glm::vec3(0.0f);		//! Box of the cube positions
+	glm::vec3 m_boxMax = glm::vec3(0.0f);
+
+	std::vector<CubeInstance> m_vInstances;						//! Instance data (same order as the board)
+	std::vector<std::pair<GLuint, GLsizei>> m_vVisibleRuns;	//! Ranges of consecutive visible cubes (first, count)
+	bool m_dirty = true;
+
+public:
+	static constexpr int SIZE = 16;		//! Cells of a chunk on each axis
+
+	SavageCubeChunk() {}
+	SavageCubeChunk(const SavageCubeChunk&) = delete;
+	SavageCubeChunk& operator=(const SavageCubeChunk&) = delete;
+
+	//! Builds the mesh and the instance stream of the board cubes [first, first + count[
+	bool Init(const SavageCubeBoard& board, std::size_t first, std::size_t count, const glm::vec3& cube_size);
+
+	inline std::size_t GetFirst() const { return m_first; }
+	inline std::size_t GetCount() const { return m_count; }
+	inline bool Contains(std::size_t id) const { return id >= m_first && id < m_first + m_count; }
+
+	inline void MarkDirty() { m_dirty = true; }
+	inline bool IsDirty() const { return m_dirty; }
+
+	//! Rebuilds the instances of a dirty chunk from the board and marks them for the upload
+	void Remesh(const SavageCubeBoard& board);
+
+	//! Draws the visible cubes of the chunk (the shader and the texture are already binded)
+	//! frustum : nullptr to draw all the cubes. The chunk box is tested first, and the cubes are tested only if the box crosses the frustum.
+	//! vVisible : scratch buffer of the cube frustum tests
+	//! Returns the number of drawn cubes
+	std::size_t Draw(const SavageCubeBoard& board, const bh3d::Frustum* frustum, const glm::vec3& anim_center, const glm::vec3& anim_half_size, std::vector<std::uint8_t>& vVisible);
+};
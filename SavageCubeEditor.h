@@ -4,7 +4,10 @@
 
 #include "imgui.h"
 
-inline void SavageCubeEditor()
+#include "SavageCubeMatrix.h"
+
+//! hover : cube under the mouse, or nullptr
+inline void SavageCubeEditor(const SavageCubeMatrix& cubes, const bh3d::GridHit* hover)
 {
 	
     static bool show_demo_window = false;
@@ -22,6 +25,14 @@ inline void SavageCubeEditor()
         else
             ImGui::Text("A item isn't hovered !");
 
+        if (hover)
+        {
+            ImGui::Text("Hovered cube %d (status %d)", hover->m_id, cubes.GetBoard().GetStatus((std::size_t)hover->m_id));
+            ImGui::Text("Cell (%d, %d, %d) face (%d, %d, %d)", hover->m_cell.x, hover->m_cell.y, hover->m_cell.z, hover->m_normal.x, hover->m_normal.y, hover->m_normal.z);
+        }
+        else
+            ImGui::Text("No hovered cube");
+
         ImGui::End();
     }
 
@@ -3,17 +3,40 @@
 
 void SavageCubeEngine::Init()
 {
+	//Linked shader programs are kept on disk for the next runs (set before the first shader load)
+	bh3d::Shader::SetProgramCache(std::make_shared<bh3d::ProgramCache>("shader_cache"));
+
 	bh3d::SDLEngine::Init();
 	m_sdlImGUI.InitContext(*this);
 
 	m_cameraEngine.LookAt();
 
+	//Decoded textures and their mipmaps are kept on disk for the next runs
+	BH3D_TextureManager().SetTextureCache(std::make_shared<bh3d::TextureCache>("texture_cache"));
+
+	//An edited texture is reloaded in place (same OpenGL texture for the cubes and the floor)
+	m_fileWatcher.Watch("data3d/textures", [](const std::filesystem::path & pathname) {
+		BH3D_TextureManager().Reload(pathname);
+	});
+
+	//An edited shader source is recompiled in place by all the shaders loaded from it (same OpenGL program)
+	m_fileWatcher.Watch("shaders", [](const std::filesystem::path & pathname) {
+		bh3d::Shader::ReloadFile(pathname);
+	});
+
 	m_floor.Init(floor_size.y, floor_size.x);
 	m_savageCubes.Init(savageCube_size.y, savageCube_size.x);
 }
 
+void SavageCubeEngine::Simulate(float step)
+{
+	m_savageCubes.Animate(step, GetSimulationTime());
+}
+
 void SavageCubeEngine::Display()
 {
+	m_fileWatcher.Poll();
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	m_sdlImGUI.Frame();
@@ -23,13 +46,28 @@ void SavageCubeEngine::Display()
 		ImGui::End();
 	}
 
-	SavageCubeEditor();
+	//Cube under the mouse (the board is picked with the matrices of its last draw)
+	bh3d::GridHit hover;
+	bool hovered = m_cameraEngine.IsValid() && m_savageCubes.Pick(m_cameraEngine.UnprojectRay(m_mouse), hover);
+
+	SavageCubeEditor(m_savageCubes, hovered ? &hover : nullptr);
+	{
+		ImGui::Begin("Savage Cube Editor");
+		bool uncapped = m_schedulerInfo.uncappedRendering;
+		if (ImGui::Checkbox("Uncapped rendering", &uncapped))
+			SetUncappedRendering(uncapped);
+		ImGui::Text("Simulation ticks %d - interpolation %.2f", GetSimulationSteps(), GetInterpolation());
+		ImGui::Text("Textures %zu - %.1f MB (%zu evictable)", BH3D_TextureManager().Size(), BH3D_TextureManager().GetMemoryUsage() / (1024.0 * 1024.0), BH3D_TextureManager().GetEvictableCount());
+		ImGui::End();
+	}
 
 	if(!ImGui::IsAnyWindowHovered() && !ImGui::IsAnyItemHovered())
 		m_cameraEngine.LookAround(m_mouse);
+	UpdateFrameUniforms();		//Camera of the frame for the shaders declaring the frame uniform block
 
-	this->m_floor.Draw(m_cameraEngine.ProjViewTransform());
-	this->m_savageCubes.DrawAnimation(m_cameraEngine.ProjViewTransform());
+	this->m_floor.Draw(m_cameraEngine);
+	const CubeFrameState& frameState = m_savageCubes.AcquireFrameState();
+	this->m_savageCubes.DrawAnimation(m_cameraEngine.ProjViewTransform(), GetInterpolation(frameState.m_tick_time));
 
 	//Update the camera with the mouse deplacement/events
 
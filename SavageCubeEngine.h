@@ -3,14 +3,18 @@
 #include "BH3D_SDLEngine.hpp"
 #include "BH3D_SDLImGUI.hpp"
 #include "BH3D_Camera.hpp"
+#include "BH3D_FileWatcher.hpp"
 #include "SavageCubeMatrix.h"
+#include "SavageCubeFloor.h"
 #include "SavageCubeEditor.h"
 
 class SavageCubeEngine : public bh3d::SDLEngine
 {
 	bh3d::SDLImGUI m_sdlImGUI;
 
-	SavageCubeMatrix m_floor;
+	bh3d::FileWatcher m_fileWatcher;	//! Hot reload of the textures and the shaders
+
+	SavageCubeFloor m_floor;
 	SavageCubeMatrix m_savageCubes = { glm::vec3{0.99f,0.99f,0.99f} };
 
 	glm::ivec2 floor_size		= {	8,	32};
@@ -25,6 +29,7 @@ public:
 	}
 
 	void Init() override;
+	void Simulate(float step) override;
 	void Display() override;
 
 };
\ No newline at end of file
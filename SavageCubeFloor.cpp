@@ -0,0 +1,38 @@
+#include "SavageCubeFloor.h"
+#include "SavageCubeMatrix.h"
+
+#include "BH3D_GreedyMesher.hpp"
+#include "BH3D_TinyShader.hpp"
+
+void SavageCubeFloor::Init(int rows, int cols)
+{
+	this->m_rows = rows;
+	this->m_cols = cols;
+
+	if (!m_shader.IsValid())
+	{
+		m_shader.LoadRaw(bh3d::TinyShader::TEXTURE_ARRAY_VERTEX(), bh3d::TinyShader::TEXTURE_ARRAY_FRAGMENT());
+		assert(m_shader.IsValid());
+	}
+
+	if (!m_textureArray.IsValid())
+	{
+		//Same texture array as the savage cubes (shared by the texture manager)
+		m_textureArray = BH3D_LoadTextureArrayAsync(GetCubeTextures());
+		assert(m_textureArray.IsValid());
+	}
+
+	//One voxel per floor cube (x : cols, z : rows), all with the floor texture layer (floor.png)
+	const int floor_layer = 0;
+	const glm::ivec3 dims = { m_cols, 1, m_rows };
+	std::vector<int> vVoxels((std::size_t)m_cols * m_rows, floor_layer);
+
+	//The cube (i, j) is centered on (i, 0, j)
+	const glm::vec3 origin = -0.5f * m_cube_size;
+
+	m_mesh.Destroy();
+	bh3d::GreedyMesher::AddSubMesh(m_mesh, dims, vVoxels, m_cube_size, origin);
+	m_mesh.SetTexture(m_textureArray);
+	m_mesh.ComputeMesh();
+	assert(m_mesh.IsValid());
+}
@@ -0,0 +1,24 @@
+#pragma once 
+
+#include "BH3D_Drawable.hpp"
+
+
+//! Static floor of the board baked in a single mesh (one draw call whatever the floor size)
+class SavageCubeFloor : public bh3d::Drawable
+{
+	glm::vec3 m_cube_size = { 1.0f, 0.25f, 1.0f };
+
+	int m_cols = 8;
+	int m_rows = 32;
+
+	bh3d::Texture m_textureArray;	//! Cube texture array (the floor uses the layer 0)
+
+public:
+	SavageCubeFloor() {}
+	SavageCubeFloor(const glm::vec3 & cube_size) :
+		m_cube_size(cube_size)
+	{}
+
+	//! Bakes the rows x cols floor cubes : interior faces are removed and the coplanar faces are merged
+	void Init(int rows, int cols);
+};
@@ -1,25 +1,23 @@
 #include "SavageCubeMatrix.h"
 
-#include "BH3D_Cube.hpp"
 #include "BH3D_SDLTextureManager.hpp"
 #include "BH3D_TinyShader.hpp"
+#include "BH3D_Frustum.hpp"
 
 #include <random>
+#include <algorithm>
 
-namespace
+std::vector<std::filesystem::path> GetCubeTextures()
 {
-	std::vector<std::string> GetCubeTextures()
+	static std::vector <std::filesystem::path> vTextures =
 	{
-		static std::vector <std::string> vTextures =
-		{
-			"data3d/textures/floor.png",
-			"data3d/textures/metal.png",
-			"data3d/textures/metal2.png",
-			"data3d/textures/tnt2.png",
-			"data3d/textures/tnt3.png"
-		};
-		return vTextures;
-	}
+		"data3d/textures/floor.png",
+		"data3d/textures/metal.png",
+		"data3d/textures/metal2.png",
+		"data3d/textures/tnt2.png",
+		"data3d/textures/tnt3.png"
+	};
+	return vTextures;
 }
 
 void SavageCubeMatrix::Init(int rows, int cols)
@@ -30,58 +28,163 @@ void SavageCubeMatrix::Init(int rows, int cols)
 
 	if (!m_shader.IsValid())
 	{
-		m_shader.LoadRaw(bh3d::TinyShader::TEXTURE_VERTEX(), bh3d::TinyShader::TEXTURE_FRAGMENT());
+		m_shader.LoadRaw(bh3d::TinyShader::TEXTURE_ARRAY_INSTANCED_VERTEX(), bh3d::TinyShader::TEXTURE_ARRAY_FRAGMENT());
 		assert(m_shader.IsValid());
 	}
 
-	if (!m_mesh.IsValid())
+	if (!m_textureArray.IsValid())
 	{
-		bh3d::Cube::AddSubMesh(m_mesh, m_cube_size);
-		m_mesh.ComputeMesh();
-		assert(m_mesh.IsValid());
+		//All the cube textures in one texture array (layer = cube status), decoded in background : placeholder layers until uploaded
+		auto vTexturePaths = GetCubeTextures();
+		m_textureArray = BH3D_LoadTextureArrayAsync(vTexturePaths);
+		if (m_textureArray.IsValid())
+			m_textureLayers = (int)vTexturePaths.size();
 	}
+	assert(m_textureArray.IsValid() && m_textureLayers > 0);
+
+	m_board.Clear();
+	m_board.Reserve((std::size_t)m_cols * m_rows);
+	m_grid.Resize({ m_cols, 1, m_rows });
+
+	const int chunk_size = SavageCubeChunk::SIZE;
+	m_chunkDims = (m_grid.GetDims() + (chunk_size - 1)) / chunk_size;
+	m_vChunks.clear();
+	m_vChunks.resize((std::size_t)m_chunkDims.x * m_chunkDims.y * m_chunkDims.z);
+
 
-	if (m_vTextures.empty())
+	std::random_device rd;			//Will be used to obtain a seed for the random number engine
+	std::mt19937 gen(rd());			//Standard mersenne_twister_engine seeded with rd()
+	std::uniform_int_distribution<> dist(0, m_textureLayers - 1);
+
+
+	//The board is filled chunk by chunk : the cubes of a chunk are consecutive in the board
+	for (int cz = 0; cz < m_chunkDims.z; cz++)
 	{
-		auto vTexturePaths = GetCubeTextures();
-		for (auto& path : vTexturePaths)
+		for (int cx = 0; cx < m_chunkDims.x; cx++)
 		{
-			auto tex = BH3D_LoadTexture(path);
-			if(tex.IsValid())
-				m_vTextures.emplace_back(tex);
+			const std::size_t first = m_board.Size();
+
+			for (int j = cz * chunk_size; j < std::min((cz + 1) * chunk_size, m_rows); j++)
+			{
+				for (int i = cx * chunk_size; i < std::min((cx + 1) * chunk_size, m_cols); i++)
+				{
+					const glm::vec3 position = { (float)i, 0.0f, (float)j };
+					const int status = dist(gen);
+					assert(status < m_textureLayers);
+					const std::size_t id = m_board.Add(position, status);
+					m_grid.Set(GetCell(position), (int)id, status != CUBESTATUS_EMPTY);
+				}
+			}
+
+			auto pChunk = std::make_unique<SavageCubeChunk>();
+			if (!pChunk->Init(m_board, first, m_board.Size() - first, m_cube_size))
+			{
+				BH3D_LOGGER_ERROR("Can't build the chunk (" << cx << ", " << cz << ")");
+				continue;
+			}
+			m_vChunks[(std::size_t)cx + (std::size_t)m_chunkDims.x * ((std::size_t)m_chunkDims.y * cz)] = std::move(pChunk);
 		}
+	}
+
+	//Must not run with the simulation : the animation restarts from a published initial state
+	m_simulationState.m_rotation.reset();
+	m_simulationState.m_translation.reset();
+	m_simulationState.m_tick_time = 0.0;
+	m_frameStates.Write() = m_simulationState;
+	m_frameStates.Publish();
+
+}
+
+SavageCubeChunk* SavageCubeMatrix::GetChunk(const glm::ivec3& cell) const
+{
+	if (!m_grid.IsInside(cell))
+		return nullptr;
+	const glm::ivec3 chunk = cell / SavageCubeChunk::SIZE;
+	return m_vChunks[(std::size_t)chunk.x + (std::size_t)m_chunkDims.x * ((std::size_t)chunk.y + (std::size_t)m_chunkDims.y * chunk.z)].get();
+}
+
+void SavageCubeMatrix::SetCubeStatus(std::size_t id, int status)
+{
+	assert(id < m_board.Size());
+	assert(status >= 0 && status < m_textureLayers);
+
+	if (m_board.GetStatus(id) == status)
+		return;
+
+	m_board.SetStatus(id, status);
 
-		if(!m_vTextures.empty())
-			m_mesh.SetTexture(m_vTextures[0]);
+	const glm::ivec3 cell = GetCell(m_board.GetPosition(id));
+	m_grid.SetOccupied(cell, status != CUBESTATUS_EMPTY);
+
+	//Only the chunk of the cube is rebuilt and uploaded at the next draw
+	if (SavageCubeChunk* pChunk = GetChunk(cell))
+	{
+		assert(pChunk->Contains(id));
+		pChunk->MarkDirty();
 	}
-	assert(!m_vTextures.empty());
+}
 
-	m_vCubeLogics.clear();
-	m_vCubeLogics.reserve((std::size_t)m_cols * m_rows);
+bool SavageCubeMatrix::Pick(const bh3d::Ray& ray, bh3d::GridHit& hit) const
+{
+	//Board space to cell space : the cell of a cube at the position p covers [p - 0.5, p + 0.5[
+	bh3d::Ray cellRay = ray;
+	cellRay.m_origin -= glm::vec3(m_animation[3]) - 0.5f;
 
+	return m_grid.Raycast(cellRay, hit);
+}
 
-	std::random_device rd;			//Will be used to obtain a seed for the random number engine
-	std::mt19937 gen(rd());			//Standard mersenne_twister_engine seeded with rd()
-	std::uniform_int_distribution<> dist(0, (int)m_vTextures.size()-1);
+std::vector<std::size_t> SavageCubeMatrix::GetCubesInBox(const glm::ivec3& min, const glm::ivec3& max) const
+{
+	std::vector<std::size_t> vIds;
+	m_grid.ForEachOccupied(min, max, [&vIds](const glm::ivec3&, int id) {
+		vIds.push_back((std::size_t)id);
+	});
+	return vIds;
+}
+
+std::vector<std::size_t> SavageCubeMatrix::GetNeighbourCubes(std::size_t id) const
+{
+	assert(id < m_board.Size());
 
+	static const glm::ivec3 offsets[6] = { {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1} };
 
-	int k = 0;
-	for (int i = 0; i < m_cols; i++)
+	const glm::ivec3 cell = GetCell(m_board.GetPosition(id));
+	const int neighbours = m_grid.GetNeighbours6(cell);
+
+	std::vector<std::size_t> vIds;
+	for (int i = 0; i < 6; i++)
 	{
-		for (int j = 0; j < m_rows; j++)
-		{
-			m_vCubeLogics.emplace_back(CubeLogic{
-				k,
-				dist(gen),
-				{i,j,k},
-				glm::translate(glm::mat4(1.0f), {i, 0, j})
-			});
-
-			k++;
-		}
+		if (neighbours & (1 << i))
+			vIds.push_back((std::size_t)m_grid.GetId(cell + offsets[i]));
 	}
+	return vIds;
+}
+
+void SavageCubeMatrix::DrawInstances(const glm::mat4& mvp, const glm::mat4& anim_mat, int force_layer)
+{
+	m_animation = anim_mat;
+
+	const bh3d::Frustum frustum(mvp);
+
+	//Box of a cube moved by the shared transform, then translated by the cube position
+	const glm::vec3 half_size = 0.5f * m_cube_size;
+	const glm::vec3 anim_center = glm::vec3(anim_mat[3]);
+	const glm::vec3 anim_half_size = glm::abs(glm::vec3(anim_mat[0])) * half_size.x
+		+ glm::abs(glm::vec3(anim_mat[1])) * half_size.y
+		+ glm::abs(glm::vec3(anim_mat[2])) * half_size.z;
 
-	m_rotationAnimation.reset();
-	m_translationAnimation.reset();
+	//One texture bind for the whole board, the animation is shared by a uniform. The culling and the shader use the same mvp.
+	m_shader(mvp);
+	m_shader.SendTransform(anim_mat);
+	m_shader.Send1i("force_layer", force_layer);
+	m_textureArray.Bind(GL_TEXTURE0);
 
+	m_visibleCount = 0;
+	for (auto& pChunk : m_vChunks)
+	{
+		if (!pChunk)
+			continue;
+		pChunk->Remesh(m_board);
+		m_visibleCount += pChunk->Draw(m_board, m_frustumCulling ? &frustum : nullptr, anim_center, anim_half_size, m_vVisible);
+	}
 }
@@ -1,6 +1,12 @@
 #pragma once 
 
+#include <memory>
+
 #include "BH3D_Drawable.hpp"
+#include "SavageCubeBoard.h"
+#include "SavageCubeChunk.h"
+#include "BH3D_OccupancyGrid.hpp"
+#include "BH3D_TripleBuffer.hpp"
 
 
 enum CubeStatus
@@ -12,16 +18,8 @@ enum CubeStatus
 	CUBESTATUS_COUNT
 };
 
-struct CubeLogic
-{
-	//Constant variable in time
-	int m_id = 0;
-	int m_status = 0;
-	glm::ivec3 m_position;
-
-	//variable in time
-	glm::mat4 m_translate;
-};
+//! Texture path of each cube status (layer i of the cube texture array is the status i)
+std::vector<std::filesystem::path> GetCubeTextures();
 
 
 struct Animation
@@ -33,17 +31,25 @@ struct Animation
 struct RotationAnimation : public Animation
 {
 	float m_angle = 0;
+	float m_previous_angle = 0;		//! Angle of the previous tick
 	float m_speed = glm::half_pi<float>() / m_durations;
 	glm::vec3 m_axe = { 1.0, 0.0, 0.0 };	//! Rotation axes
 
 	inline auto compute(float elapse_time) {
 		float elapse = m_speed * elapse_time;
+		m_previous_angle = m_angle;
 		m_angle += elapse;
 		return glm::rotate(glm::mat4(1.0f), m_angle, m_axe);
 	}
 
+	//! Rotation between the two last ticks (alpha in [0, 1])
+	inline auto interpolate(float alpha) const {
+		return glm::rotate(glm::mat4(1.0f), glm::mix(m_previous_angle, m_angle, alpha), m_axe);
+	}
+
 	void reset() {
-		float m_angle = 0;
+		m_angle = 0;
+		m_previous_angle = 0;
 		m_speed = glm::half_pi<float>() / m_durations;
 	}
 };
@@ -51,22 +57,38 @@ struct RotationAnimation : public Animation
 struct TranslationAnimation : public Animation
 {
 	glm::vec3 m_position = { 0.0, 0.0, 0.0 };
+	glm::vec3 m_previous_position = { 0.0, 0.0, 0.0 };		//! Position of the previous tick
 	float m_speed = 1.0f / m_durations;
 	glm::vec3 m_direction = { 0.0, 0.0, 1.0 };
 
 	inline auto compute(float elapse_time) {
 		float elapse = m_speed * elapse_time;
+		m_previous_position = m_position;
 		m_position += (elapse * m_direction);
 		return glm::translate(glm::mat4(1.0f), m_position);
 	}
 
+	//! Translation between the two last ticks (alpha in [0, 1])
+	inline auto interpolate(float alpha) const {
+		return glm::translate(glm::mat4(1.0f), glm::mix(m_previous_position, m_position, alpha));
+	}
+
 	void reset() {
 		m_position = { 0.0, 0.0, 0.0 };
-		float m_speed = 1.0f / m_durations;
+		m_previous_position = { 0.0, 0.0, 0.0 };
+		m_speed = 1.0f / m_durations;
 	}
 };
 
 
+//! Animation state of the board, computed by the simulation and handed to the display
+struct CubeFrameState
+{
+	RotationAnimation m_rotation;
+	TranslationAnimation m_translation;
+	double m_tick_time = 0.0;		//! Simulation time of the state
+};
+
 
 class SavageCubeMatrix : public bh3d::Drawable
 {
@@ -77,11 +99,23 @@ class SavageCubeMatrix : public bh3d::Drawable
 
 	bh3d::Texture m_texture;
 
-	std::vector<CubeLogic> m_vCubeLogics;
-	std::vector<bh3d::Texture> m_vTextures;
+	SavageCubeBoard m_board;	//! Cube positions/statuses (the cube id is the index in the board, the cubes of a chunk are consecutive)
+
+	bh3d::Texture m_textureArray;	//! One layer per cube status (GL_TEXTURE_2D_ARRAY)
+	int m_textureLayers = 0;		//! Layer number of m_textureArray
+
+	glm::ivec3 m_chunkDims = { 0, 0, 0 };							//! Chunk number on each axis
+	std::vector<std::unique_ptr<SavageCubeChunk>> m_vChunks;		//! Chunks of the board grid (nullptr for a chunk without cube)
+
+	bh3d::OccupancyGrid m_grid;		//! Board cells : cube id of each cell, occupied if the cube status is not CUBESTATUS_EMPTY
+	glm::mat4 m_animation = glm::mat4(1.0f);	//! Shared transform of the last draw
 
-	RotationAnimation m_rotationAnimation;
-	TranslationAnimation m_translationAnimation;
+	CubeFrameState m_simulationState;						//! Simulation side state (see Animate)
+	bh3d::TripleBuffer<CubeFrameState> m_frameStates;		//! Lock-free handoff from the simulation to the display
+
+	bool m_frustumCulling = true;
+	std::vector<std::uint8_t> m_vVisible;		//! Frustum test result of the cubes of a chunk
+	std::size_t m_visibleCount = 0;
 
 public:
 	SavageCubeMatrix() {}
@@ -91,33 +125,82 @@ public:
 
 	void Init(int rows, int cols);
 
+	//! Changes the status of a cube (the texture layer of its instance). Only the chunk of the cube is remeshed.
+	void SetCubeStatus(std::size_t id, int status);
+
+	inline const SavageCubeBoard& GetBoard() const { return m_board; }
+
+	//! Spatial index of the board (maintained by Init and SetCubeStatus)
+	inline const bh3d::OccupancyGrid& GetGrid() const { return m_grid; }
+
+	//! Grid cell of a board position (board space, before animation)
+	inline glm::ivec3 GetCell(const glm::vec3& position) const { return glm::ivec3(glm::floor(position + 0.5f)); }
+
+	//! Id of the cube in a cell, or bh3d::OccupancyGrid::NONE
+	inline int GetCubeAt(const glm::ivec3& cell) const { return m_grid.GetId(cell); }
+
+	//! First non empty cube crossed by a ray (in the space of the mvp given to Draw/DrawAnimation), and the face entered.
+	//! The cubes only move with the translation of the animation, they rotate in place inside their cells.
+	bool Pick(const bh3d::Ray& ray, bh3d::GridHit& hit) const;
+
+	//! Ids of the non empty cubes in the cell box [min, max]
+	std::vector<std::size_t> GetCubesInBox(const glm::ivec3& min, const glm::ivec3& max) const;
+
+	//! Ids of the non empty cubes among the 6 neighbours of a cube
+	std::vector<std::size_t> GetNeighbourCubes(std::size_t id) const;
+
+	//! Enables the frustum culling of the cubes before drawing
+	inline void SetFrustumCulling(bool enable) { m_frustumCulling = enable; }
+
+	//! Number of cubes drawn by the last draw call
+	inline std::size_t GetVisibleCount() const { return m_visibleCount; }
+
 	void Draw(const glm::mat4& mvp) override
 	{
-		m_mesh.BindMaterial(0);
-		m_mesh.BindVBO();
-		for (auto& cube : m_vCubeLogics)
-		{
-			m_shader(mvp * cube.m_translate);
-			m_mesh.DrawSubMeshElements(0);
-		}
+		DrawInstances(mvp, glm::mat4(1.0f), 0);
 	}
 
-	void DrawAnimation(const glm::mat4& mvp, float elapse_time = 1.0f / 60.0f)
+	//! Advances the animations of one fixed simulation tick and publishes the new state (simulation thread, no OpenGL call)
+	void Animate(float elapse_time, double tick_time)
 	{
-		auto rotation_mat = m_rotationAnimation.compute(elapse_time);
-		auto translation_mat = m_translationAnimation.compute(elapse_time);
+		m_simulationState.m_rotation.compute(elapse_time);
+		m_simulationState.m_translation.compute(elapse_time);
+		m_simulationState.m_tick_time = tick_time;
+
+		m_frameStates.Write() = m_simulationState;
+		m_frameStates.Publish();
+	}
+
+	//! Takes the last state published by Animate (display thread)
+	const CubeFrameState& AcquireFrameState()
+	{
+		m_frameStates.Update();
+		return m_frameStates.Read();
+	}
+
+	//! Draws the cubes with the acquired animation interpolated between its two last ticks (alpha in [0, 1], see AcquireFrameState)
+	void DrawAnimation(const glm::mat4& mvp, float alpha = 1.0f)
+	{
+		const CubeFrameState& state = m_frameStates.Read();
+		auto rotation_mat = state.m_rotation.interpolate(alpha);
+		auto translation_mat = state.m_translation.interpolate(alpha);
 
 		auto anim_mat = translation_mat * rotation_mat;
 
-		m_mesh.BindVBO();
-		for (auto& cube : m_vCubeLogics)
-		{
-			assert(cube.m_status < m_vTextures.size());
-			m_vTextures[cube.m_status].Bind();
-			m_shader(mvp * cube.m_translate * anim_mat);
-			m_mesh.DrawSubMeshElements(0);
-		}
+		//The world matrix of every cube is only computed if a CPU user reads it (the GPU side only uses the shared anim_mat)
+		m_board.SetAnimation(anim_mat);
+
+		DrawInstances(mvp, anim_mat, -1);
 	}
 
+private:
+
+	//! Chunk containing a cell
+	SavageCubeChunk* GetChunk(const glm::ivec3& cell) const;
+
+	//! Culls the cubes and draws the visible ones with the shared transform anim_mat
+	//! mvp : projection * view matrix used both by the frustum culling and by the shader
+	//! force_layer : texture layer used by all the cubes, or -1 to use the cube status
+	void DrawInstances(const glm::mat4& mvp, const glm::mat4& anim_mat, int force_layer);
 
 };
\ No newline at end of file
@@ -38,6 +38,7 @@
 #include <glad/glad.h>
 
 #include "BH3D_Viewport.hpp"
+#include "BH3D_Ray.hpp"
 
 namespace bh3d
 {	
@@ -245,6 +246,22 @@ namespace bh3d
 		/// <param name="m_mouse">Mouse inputs</param>
 		void FreeFlight(const Mouse &m_mouse);
 
+		/// <summary>
+		/// Ray from the camera through a window pixel (the window origin is the top left corner, as the mouse events).
+		/// The ray is expressed in the space drawn with ProjViewTransform().
+		/// </summary>
+		/// <param name="x">Pixel position in X</param>
+		/// <param name="y">Pixel position in Y</param>
+		/// <returns>Ray starting on the near plane</returns>
+		Ray UnprojectRay(int x, int y) const;
+
+		/// <summary>
+		/// Ray from the camera through the mouse position
+		/// </summary>
+		/// <param name="m_mouse">Mouse inputs</param>
+		/// <returns>Ray starting on the near plane</returns>
+		Ray UnprojectRay(const Mouse &m_mouse) const;
+
 
 		void ModeviewTransformFusion() 
 		{
@@ -3,9 +3,12 @@
 #ifndef _BH3D_DRAWABLE_H_
 #define _BH3D_DRAWABLE_H_
 
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 
 #include "BH3D_Mesh.hpp"
+#include "BH3D_Camera.hpp"
 
 namespace bh3d
 {
@@ -18,6 +21,10 @@ namespace bh3d
 		Shader m_shader;										//! Shader used to draw the mesh
 		std::stringstream m_error;								//! If exception/error was occured
 
+		bool m_lodEnabled = true;								//! Select the mesh LOD from the screen size (see UpdateLod), no effect on a mesh without LOD
+		float m_lodScreenSize = 0.25f;							//! Screen size (bounding sphere radius / half screen height) under which the LOD 1 is used, halved at each next LOD
+		unsigned int m_lod = 0;									//! LOD drawn by DrawMesh
+
 		Drawable() {};
 		virtual ~Drawable() { Clear(); }
 
@@ -52,21 +59,79 @@ namespace bh3d
 
 		/// <summary>
 		/// Display the mesh with the specific shader.
-		/// A fusioned matrix are send to the sahder during the drawing process
+		/// A fusioned matrix are send to the sahder during the drawing process, with the dequantization of the packed positions (see Mesh::VertexCompression)
 		/// </summary>
 		/// <param name="projection_modelview_transform">Generaly combination of the projection, modelview and model transform matrices</param>
 		virtual void Draw(const glm::mat4 & projection_modelview_transform)
 		{
-			m_shader(projection_modelview_transform);	//Enable the shader and send the "projection modelview transform" matrix to the shader
+			//Enable the shader and send the "projection modelview transform" matrix to the shader
+			if (m_mesh.GetVertexCompression().positions)
+				m_shader(projection_modelview_transform * m_mesh.GetDequantizationMatrix());
+			else
+				m_shader(projection_modelview_transform);
 			DrawMesh();
 		}
 
+		/// <summary>
+		/// Display the mesh seen by a camera, with the LOD matching its screen size (see UpdateLod).
+		/// </summary>
+		/// <param name="camera">Camera of the frame</param>
+		/// <param name="model">Model transform of the mesh</param>
+		void Draw(const CameraEngine & camera, const glm::mat4 & model = glm::mat4(1.0f))
+		{
+			UpdateLod(camera, model);
+			Draw(camera.ProjViewTransform() * model);
+		}
+
 		/// <summary>
 		/// Display the mesh with the specific shader.
 		/// </summary>
 		virtual void DrawMesh() const {
 			assert(m_mesh.IsValid());
-			m_mesh.Draw();
+			m_mesh.DrawLod(std::min(m_lod, m_mesh.GetLodCount() - 1));
+		}
+
+		/// <summary>
+		/// Select the LOD to draw from the projected size of the mesh bounding sphere.
+		/// Does nothing if the LODs are disabled or the mesh has no LOD.
+		/// </summary>
+		/// <param name="modelview">Camera modelview combined with the model transform</param>
+		/// <param name="angle_fov">Vertical field of view of the camera in radians</param>
+		virtual void UpdateLod(const glm::mat4 & modelview, float angle_fov)
+		{
+			const unsigned int lodCount = m_mesh.GetLodCount();
+			if (!m_lodEnabled || lodCount < 2)
+			{
+				m_lod = 0;
+				return;
+			}
+
+			const BoundingBox & box = m_mesh.GetBoundingBox();
+			const float scale = std::max({ glm::length(glm::vec3(modelview[0])), glm::length(glm::vec3(modelview[1])), glm::length(glm::vec3(modelview[2])) });
+			const float radius = 0.5f * glm::length(box.size) * scale;
+			const float distance = glm::length(glm::vec3(modelview * glm::vec4(box.position, 1.0f)));
+
+			if (distance <= radius)
+			{
+				m_lod = 0;
+				return;
+			}
+
+			const float screenSize = radius / (distance * std::tan(0.5f * angle_fov));
+			if (screenSize >= m_lodScreenSize)
+				m_lod = 0;
+			else
+				m_lod = std::min(lodCount - 1, 1u + (unsigned int)std::log2(m_lodScreenSize / screenSize));
+		}
+
+		/// <summary>
+		/// Select the LOD to draw for a camera (modelview, transform and field of view of the camera).
+		/// </summary>
+		/// <param name="camera">Camera of the frame</param>
+		/// <param name="model">Model transform of the mesh</param>
+		void UpdateLod(const CameraEngine & camera, const glm::mat4 & model = glm::mat4(1.0f))
+		{
+			UpdateLod(camera.m_modelview * camera.m_transform * model, camera.m_angle_fov);
 		}
 
 		/// <summary>
@@ -28,6 +28,8 @@
 #define _BH3D_FILE_H_
 
 #include <filesystem>
+#include <functional>
+#include <ostream>
 
 namespace bh3d
 {	
@@ -92,6 +94,51 @@ namespace bh3d
 	};
 
 
+	/// <summary>
+	/// Read only memory mapping of a file (mmap / MapViewOfFile)
+	/// </summary>
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile() { Close(); }
+
+		MappedFile(const MappedFile &) = delete;
+		MappedFile& operator=(const MappedFile &) = delete;
+
+		/// <summary>
+		/// Map the overall file in memory
+		/// </summary>
+		/// <param name="path">File path</param>
+		/// <returns>if it's ok ?</returns>
+		bool Open(const std::filesystem::path & path);
+
+		//Unmap the file
+		void Close();
+
+		inline bool IsOpen() const { return m_data != nullptr; }
+		inline const unsigned char * Data() const { return m_data; }
+		inline std::size_t Size() const { return m_size; }
+
+	private:
+		const unsigned char * m_data = nullptr;
+		std::size_t m_size = 0;
+#ifdef _WIN32
+		void * m_fileHandle = nullptr;
+		void * m_mappingHandle = nullptr;
+#endif
+	};
+
+
+	/// <summary>
+	/// Write a file through a temporary file renamed over the destination : a reader never sees a partial file
+	/// </summary>
+	/// <param name="path">Destination file</param>
+	/// <param name="write">Writes the file content in the stream</param>
+	/// <returns>if it's ok ?</returns>
+	bool WriteFileAtomic(const std::filesystem::path & path, const std::function<void(std::ostream &)> & write);
+
+
 	//Inline fonctions
 	//------------------------------------------------
 
@@ -0,0 +1,116 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef _BH3D_FILE_WATCHER_H_
+#define _BH3D_FILE_WATCHER_H_
+
+#include <filesystem>
+#include <functional>
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+#include <string>
+
+namespace bh3d
+{
+	/// <summary>
+	/// Watch files or directories and report their changes (hot reload of shaders, textures...).
+	/// inotify is used on Linux, else the modification times are polled. The callbacks are called by Poll, on the caller thread.
+	/// </summary>
+	class FileWatcher
+	{
+	public:
+		using Callback = std::function<void(const std::filesystem::path & pathname)>;
+
+		/// <summary>
+		/// Create the watcher
+		/// </summary>
+		/// <param name="pollInterval">Minimum time between two scans of the modification times (polling fallback only)</param>
+		FileWatcher(std::chrono::milliseconds pollInterval = std::chrono::milliseconds(500));
+		~FileWatcher();
+
+		FileWatcher(const FileWatcher &) = delete;
+		FileWatcher& operator=(const FileWatcher &) = delete;
+
+		/// <summary>
+		/// Watch a file, or the files of a directory (not recursive)
+		/// </summary>
+		/// <param name="pathname">File or directory path</param>
+		/// <param name="callback">Called with the path of each changed file (written, created or replaced)</param>
+		/// <returns>Watch id (0 if the path can't be watched)</returns>
+		int Watch(const std::filesystem::path & pathname, Callback && callback);
+
+		//Stop a watch
+		void Unwatch(int id);
+
+		/// <summary>
+		/// Call the callbacks of the files changed since the last call (once per file)
+		/// </summary>
+		/// <returns>Number of changed files</returns>
+		std::size_t Poll();
+
+		//True if the changes come from the system (inotify), false if the modification times are polled
+		inline bool IsNative() const { return m_inotify >= 0; }
+
+	private:
+		struct FileStamp
+		{
+			std::filesystem::file_time_type time;
+			std::uintmax_t size = 0;
+
+			bool operator==(const FileStamp & stamp) const { return time == stamp.time && size == stamp.size; }
+		};
+
+		struct Entry
+		{
+			int id = 0;
+			std::filesystem::path pathname;		//lexically normal
+			bool directory = false;
+			Callback callback;
+			int descriptor = -1;				//inotify watch of the directory
+			std::unordered_map<std::string, FileStamp> stamps;	//polling fallback
+		};
+
+		//true if the changed file belongs to the watch
+		static bool Match(const Entry & entry, const std::filesystem::path & pathname);
+
+		//Changed files of the polling fallback
+		void Scan(Entry & entry, std::vector<std::filesystem::path> & vChanged);
+
+		//Changed files reported by inotify
+		void ReadEvents(std::vector<std::filesystem::path> & vChanged);
+
+		std::vector<Entry> m_vEntries;
+		int m_nextId = 1;
+
+		int m_inotify = -1;											//! inotify instance (-1 : polling)
+		std::unordered_map<int, std::filesystem::path> m_directories;	//! inotify watch -> directory
+
+		std::chrono::milliseconds m_pollInterval;
+		std::chrono::steady_clock::time_point m_lastScan;
+	};
+}
+#endif //_BH3D_FILE_WATCHER_H_
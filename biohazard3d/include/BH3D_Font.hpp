@@ -301,19 +301,23 @@ namespace bh3d
 
 		const auto * lastColor = &textColor;
 
+		//Locations resolved once for the whole list
+		const GLint colorLocation = pShader->GetUniformLocation(BH3D_FONT_COLOR_UNIFORM);
+		const GLint posLocation = pShader->GetUniformLocation(BH3D_FONT_POS_UNIFORM);
+
 		for (const UStaticText & utext : stdContainer)
 		{
 			const auto * color = utext.optionalColor.has_value() ? &utext.optionalColor.value() : &textColor;
 			if (*lastColor != *color)
 			{
 				lastColor = color;
-				pShader->Send4f(BH3D_FONT_COLOR_UNIFORM, *color);
+				pShader->Send4f(colorLocation, *color);
 			}
 
 			GLsizei start = (GLsizei) tStaticTextOffsets[utext.id].start;
 			GLsizei end = (GLsizei)tStaticTextOffsets[utext.id].end;
 
-			pShader->Send2i(BH3D_FONT_POS_UNIFORM, utext.x, utext.y);
+			pShader->Send2i(posLocation, utext.x, utext.y);
 			glDrawElements(GL_TRIANGLES, (end - start + 1) * 6, GL_UNSIGNED_INT, ((GLsizei*)nullptr) + (start * 6));
 		}
 	}
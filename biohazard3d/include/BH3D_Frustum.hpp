@@ -0,0 +1,105 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+#ifndef _BH3D_FRUSTUM_H_
+#define _BH3D_FRUSTUM_H_
+
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "BH3D_BoundingBox.hpp"
+
+namespace bh3d
+{
+
+	/// <summary>
+	/// View frustum defined by 6 planes extracted from a projection * view matrix (Gribb/Hartmann method).
+	/// A plane is (a, b, c, d) with a point p inside the frustum if a*p.x + b*p.y + c*p.z + d >= 0
+	/// </summary>
+	class Frustum
+	{
+	public:
+
+		enum PLANE { PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, N_PLANES };
+
+		Frustum() {}
+
+		/// <summary>
+		/// Build the frustum from a projection * view (* transform) matrix. The planes are in the space of the matrix input.
+		/// </summary>
+		Frustum(const glm::mat4 & projView) { Extract(projView); }
+
+		/// <summary>
+		/// Extract the normalized frustum planes from a projection * view (* transform) matrix
+		/// </summary>
+		void Extract(const glm::mat4 & projView);
+
+		/// <summary>
+		/// Test of an axis aligned box
+		/// </summary>
+		/// <param name="center">Center of the box</param>
+		/// <param name="halfSize">Half size of the box</param>
+		/// <returns>false if the box is fully outside the frustum</returns>
+		bool IsVisible(const glm::vec3 & center, const glm::vec3 & halfSize) const;
+
+		/// <summary>
+		/// Containment test of an axis aligned box
+		/// </summary>
+		/// <param name="center">Center of the box</param>
+		/// <param name="halfSize">Half size of the box</param>
+		/// <returns>true if the box is fully inside the frustum</returns>
+		bool IsInside(const glm::vec3 & center, const glm::vec3 & halfSize) const;
+
+		/// <summary>
+		/// Test of a bounding box (see BoundingBox, the position is the box center)
+		/// </summary>
+		inline bool IsVisible(const BoundingBox & box) const { return IsVisible(box.position, 0.5f * box.size); }
+
+		/// <summary>
+		/// Batch test of axis aligned boxes with the same size (SSE : 4 boxes per iteration).
+		/// The box i is centered on (cx[i], cy[i], cz[i]) + offset.
+		/// </summary>
+		/// <param name="count">Box number</param>
+		/// <param name="cx">x coordinates of the box centers</param>
+		/// <param name="cy">y coordinates of the box centers</param>
+		/// <param name="cz">z coordinates of the box centers</param>
+		/// <param name="offset">Offset added to all the centers</param>
+		/// <param name="halfSize">Half size of all the boxes</param>
+		/// <param name="visible">Output array of count elements : 1 if the box i is visible, else 0</param>
+		/// <returns>Number of visible boxes</returns>
+		std::size_t CullBoxes(std::size_t count, const float * cx, const float * cy, const float * cz, const glm::vec3 & offset, const glm::vec3 & halfSize, std::uint8_t * visible) const;
+
+		inline const glm::vec4 & GetPlane(PLANE plane) const { return m_planes[plane]; }
+
+	private:
+		glm::vec4 m_planes[N_PLANES];
+	};
+
+}
+#endif //_BH3D_FRUSTUM_H_
@@ -0,0 +1,76 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+#ifndef _BH3D_GREEDY_MESHER_H_
+#define _BH3D_GREEDY_MESHER_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "BH3D_Mesh.hpp"
+
+namespace bh3d
+{
+
+	/// <summary>
+	/// Factory class to bake a voxel grid in a mesh (static geometry).
+	/// Only the faces between a filled voxel and an empty voxel are kept, then the coplanar faces with the same texture layer are greedily merged in quads.
+	/// The texture coordinates are 3D (u, v, layer) to be used with a texture array, and repeat once per voxel.
+	/// </summary>
+	class GreedyMesher
+	{
+	public:
+
+		/// <summary>
+		/// Value of an empty voxel
+		/// </summary>
+		static constexpr int EMPTY = -1;
+
+		/// <summary>
+		/// Index of the voxel (x,y,z) in the voxel array
+		/// </summary>
+		static inline std::size_t VoxelIndex(const glm::ivec3 & dims, int x, int y, int z) {
+			return (std::size_t)x + (std::size_t)dims.x * ((std::size_t)y + (std::size_t)dims.y * (std::size_t)z);
+		}
+
+		/// <summary>
+		/// Factory function to add the baked voxels to a mesh (as a single submesh).
+		/// </summary>
+		/// <param name="mesh">The mesh reference where the voxels will be added</param>
+		/// <param name="dims">Voxel number on each axis</param>
+		/// <param name="vVoxels">Texture layer of each voxel (EMPTY if empty), see VoxelIndex</param>
+		/// <param name="voxelSize">Size of a voxel</param>
+		/// <param name="origin">Position of the corner of the voxel (0,0,0)</param>
+		/// <param name="pMaterial">Material of the submesh. Can be nullptr.</param>
+		/// <returns>BH3D_OK or BH3D_ERROR if there is no face to add</returns>
+		static bool AddSubMesh(Mesh & mesh, const glm::ivec3 & dims, const std::vector<int> & vVoxels, const glm::vec3 & voxelSize = glm::vec3(1.0f), const glm::vec3 & origin = glm::vec3(0.0f), const Material *pMaterial = nullptr);
+
+	};
+
+}
+#endif //_BH3D_GREEDY_MESHER_H_
@@ -0,0 +1,164 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef _BH3D_HASH_H_
+#define _BH3D_HASH_H_
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace bh3d
+{
+	constexpr std::uint64_t FNV1A_OFFSET_BASIS = 14695981039346656037ull;
+	constexpr std::uint64_t FNV1A_PRIME = 1099511628211ull;
+
+	/// <summary>
+	/// FNV-1a 64 bits hash of a string (names, cache keys)
+	/// </summary>
+	/// <param name="str">Hashed characters</param>
+	/// <param name="hash">Hash to continue, the offset basis to start a new hash</param>
+	/// <returns>Hash of the string</returns>
+	constexpr std::uint64_t HashFNV1a(std::string_view str, std::uint64_t hash = FNV1A_OFFSET_BASIS)
+	{
+		for (char c : str)
+		{
+			hash ^= (unsigned char)c;
+			hash *= FNV1A_PRIME;
+		}
+		return hash;
+	}
+
+	/// <summary>
+	/// Open addressing hash index (linear probing) : 64 bits hash -> slot index.
+	/// The hash collisions are solved by the match function given to Find.
+	/// </summary>
+	class ResourceIndex
+	{
+		static constexpr std::uint32_t EMPTY = 0xFFFFFFFF;
+		static constexpr std::uint32_t TOMBSTONE = 0xFFFFFFFE;
+
+		struct Entry
+		{
+			std::uint64_t hash = 0;
+			std::uint32_t slot = EMPTY;
+		};
+
+		std::vector<Entry> m_vEntries;		//power of 2 size, at most half full (with the tombstones)
+		std::size_t m_used = 0;				//live entries and tombstones
+
+	public:
+		static constexpr std::uint32_t NONE = EMPTY;
+
+		//First slot with the hash accepted by match(slot), or NONE
+		template <typename Match>
+		std::uint32_t Find(std::uint64_t hash, Match && match) const
+		{
+			if (m_vEntries.empty())
+				return NONE;
+
+			const std::size_t mask = m_vEntries.size() - 1;
+			for (std::size_t i = hash & mask;; i = (i + 1) & mask)
+			{
+				const Entry & entry = m_vEntries[i];
+				if (entry.slot == EMPTY)
+					return NONE;
+				if (entry.slot != TOMBSTONE && entry.hash == hash && match(entry.slot))
+					return entry.slot;
+			}
+		}
+
+		void Insert(std::uint64_t hash, std::uint32_t slot)
+		{
+			if ((m_used + 1) * 2 > m_vEntries.size())
+				Rehash();
+
+			const std::size_t mask = m_vEntries.size() - 1;
+			std::size_t i = hash & mask;
+			while (m_vEntries[i].slot != EMPTY && m_vEntries[i].slot != TOMBSTONE)
+				i = (i + 1) & mask;
+
+			if (m_vEntries[i].slot == EMPTY)
+				m_used++;
+			m_vEntries[i] = { hash, slot };
+		}
+
+		bool Remove(std::uint64_t hash, std::uint32_t slot)
+		{
+			if (m_vEntries.empty())
+				return false;
+
+			const std::size_t mask = m_vEntries.size() - 1;
+			for (std::size_t i = hash & mask; m_vEntries[i].slot != EMPTY; i = (i + 1) & mask)
+			{
+				if (m_vEntries[i].slot == slot && m_vEntries[i].hash == hash)
+				{
+					m_vEntries[i].slot = TOMBSTONE;		//keeps the probe chains
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void Clear()
+		{
+			m_vEntries.clear();
+			m_used = 0;
+		}
+
+	private:
+
+		//Doubles the capacity if needed and drops the tombstones
+		void Rehash()
+		{
+			std::size_t live = 0;
+			for (const auto & entry : m_vEntries)
+				live += (entry.slot != EMPTY && entry.slot != TOMBSTONE);
+
+			std::size_t capacity = 16;
+			while (capacity < (live + 1) * 4)
+				capacity *= 2;
+
+			std::vector<Entry> vOldEntries(capacity);
+			vOldEntries.swap(m_vEntries);
+			m_used = 0;
+
+			const std::size_t mask = capacity - 1;
+			for (const auto & entry : vOldEntries)
+			{
+				if (entry.slot == EMPTY || entry.slot == TOMBSTONE)
+					continue;
+				std::size_t i = entry.hash & mask;
+				while (m_vEntries[i].slot != EMPTY)
+					i = (i + 1) & mask;
+				m_vEntries[i] = entry;
+				m_used++;
+			}
+		}
+	};
+}
+
+#endif //_BH3D_HASH_H_
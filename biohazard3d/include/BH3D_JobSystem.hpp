@@ -0,0 +1,176 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+#ifndef _BH3D_JOB_SYSTEM_H_
+#define _BH3D_JOB_SYSTEM_H_
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+
+namespace bh3d
+{
+	using Job = std::function<void()>;
+
+	class JobSystem;
+
+	/// <summary>
+	/// Counts the unfinished jobs of a group. A job can wait for a counter (see JobSystem::Run), and a thread can wait for it (see JobSystem::Wait).
+	/// The counter must outlive its jobs.
+	/// </summary>
+	class JobCounter
+	{
+	public:
+		JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		inline bool IsDone() const { return m_count.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<int> m_count = { 0 };
+		std::mutex m_mutex;					//! protects the continuation list and the decrement to zero
+		std::vector<Job> m_vContinuations;	//! jobs waiting for the counter (scheduled when it reaches zero)
+	};
+
+	/// <summary>
+	/// Work-stealing job scheduler.
+	/// Each worker owns a job deque : it pops its own jobs in LIFO order (cache friendly), and steals the oldest jobs of the others when it is idle.
+	/// The threads outside the system push their jobs in a shared queue, and help to execute the jobs while they wait (see Wait).
+	/// </summary>
+	class JobSystem
+	{
+	public:
+
+		/// <summary>
+		/// Starts the workers
+		/// </summary>
+		/// <param name="workerCount">Worker thread number (0 : the jobs are executed by the waiting threads only)</param>
+		explicit JobSystem(unsigned int workerCount = DefaultWorkerCount());
+
+		/// <summary>
+		/// Stops and joins the workers (the pending jobs are executed before)
+		/// </summary>
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		/// <summary>
+		/// Job system shared by the library (created at the first call)
+		/// </summary>
+		static JobSystem & Default();
+
+		/// <summary>
+		/// One worker per hardware thread, except the main one
+		/// </summary>
+		static unsigned int DefaultWorkerCount();
+
+		inline unsigned int GetWorkerCount() const { return (unsigned int)m_vWorkers.size(); }
+
+		/// <summary>
+		/// Schedules a job
+		/// </summary>
+		/// <param name="job">Function to execute</param>
+		/// <param name="counter">Counter incremented now and decremented when the job is done (can be nullptr)</param>
+		/// <param name="dependency">The job is scheduled only when this counter reaches zero (can be nullptr)</param>
+		void Run(Job job, JobCounter * counter = nullptr, JobCounter * dependency = nullptr);
+
+		/// <summary>
+		/// Waits until the counter reaches zero, executing the pending jobs meanwhile
+		/// </summary>
+		void Wait(JobCounter & counter);
+
+		/// <summary>
+		/// Calls fct(begin, end) on the sub ranges of [first, last[ in parallel, and returns when all of them are done.
+		/// </summary>
+		/// <param name="first">First index</param>
+		/// <param name="last">Last index (not included)</param>
+		/// <param name="grain">Minimal sub range size (0 : automatic)</param>
+		/// <param name="fct">Function called with each sub range</param>
+		template<typename Fct>
+		void ParallelFor(std::size_t first, std::size_t last, std::size_t grain, Fct && fct);
+
+	private:
+
+		struct WorkQueue
+		{
+			std::mutex m_mutex;
+			std::deque<Job> m_jobs;
+		};
+
+		void Push(Job job);
+		bool Pop(Job & job);
+		void Execute(Job & job);
+		void WorkerLoop(unsigned int index);
+		int CurrentWorker() const;
+
+		std::vector<std::thread> m_vWorkers;
+		std::vector<std::unique_ptr<WorkQueue>> m_vQueues;		//! one per worker, plus the shared queue of the external threads (last)
+
+		std::atomic<bool> m_running = { true };
+		std::atomic<int> m_pendingJobs = { 0 };
+		std::mutex m_wakeMutex;
+		std::condition_variable m_wakeCondition;
+	};
+
+	template<typename Fct>
+	void JobSystem::ParallelFor(std::size_t first, std::size_t last, std::size_t grain, Fct && fct)
+	{
+		if (first >= last)
+			return;
+
+		const std::size_t count = last - first;
+		const std::size_t threads = (std::size_t)GetWorkerCount() + 1;
+		if (grain == 0)
+			grain = std::max<std::size_t>(1, count / (threads * 4));
+
+		if (threads == 1 || count <= grain)
+		{
+			fct(first, last);
+			return;
+		}
+
+		JobCounter counter;
+		for (std::size_t begin = first; begin < last; begin += grain)
+		{
+			const std::size_t end = std::min(last, begin + grain);
+			Run([&fct, begin, end]() { fct(begin, end); }, &counter);
+		}
+		Wait(counter);
+	}
+
+}
+#endif //_BH3D_JOB_SYSTEM_H_
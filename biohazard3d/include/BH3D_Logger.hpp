@@ -49,6 +49,23 @@
 #define BH3D_LOG_WARNING(msg)			BH3D_LOG_WIDTH<<"<WARNING>: "<<msg<<BH3D_LOG_FILE_LINE_FUNC<<std::endl
 #define BH3D_LOG_ERROR(msg)				BH3D_LOG_WIDTH<<"<ERROR>: "<<msg<<BH3D_LOG_FILE_LINE_FUNC<<std::endl
 
+//The line is formatted first then written under the logger mutex : the lines logged by several threads (job system workers) don't interleave
+#define BH3D_LOG_LOCKED(stream, line)	{std::ostringstream a; a <<line; std::lock_guard<std::mutex> lock(bh3d::LoggerMutex()); stream<<a.str()<<std::flush;}
+
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace bh3d
+{
+	//Mutex of the log streams (see BH3D_LOG_LOCKED)
+	inline std::mutex & LoggerMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+}
+
 
 
 #ifdef BH3D_USE_SDL_LOGGER
@@ -60,16 +77,16 @@
 #elif defined(BH3D_USE_COUT_LOGGER)
 
 	#include<iostream>
-	#define BH3D_LOGGER(msg)			{std::cout<<BH3D_LOG_MSG(msg)		; }
-	#define BH3D_LOGGER_ERROR(msg)		{std::cout<<BH3D_LOG_ERROR(msg)		; }
-	#define BH3D_LOGGER_WARNING(msg)	{std::cout<<BH3D_LOG_WARNING(msg)	; }
+	#define BH3D_LOGGER(msg)			BH3D_LOG_LOCKED(std::cout, BH3D_LOG_MSG(msg))
+	#define BH3D_LOGGER_ERROR(msg)		BH3D_LOG_LOCKED(std::cout, BH3D_LOG_ERROR(msg))
+	#define BH3D_LOGGER_WARNING(msg)	BH3D_LOG_LOCKED(std::cout, BH3D_LOG_WARNING(msg))
 
 #elif defined(BH3D_USE_FILE_LOGGER)
 	
 	#define BH3D_LOGGER_INSTANCE				bh3d::Logger::Instance().getFileLogger()
-	#define BH3D_LOGGER(msg)					{BH3D_LOGGER_INSTANCE<<BH3D_LOG_MSG(msg);}
-	#define BH3D_LOGGER_ERROR(msg)				{BH3D_LOGGER_INSTANCE<<BH3D_LOG_ERROR(msg);}
-	#define BH3D_LOGGER_WARNING(msg)			{BH3D_LOGGER_INSTANCE<<BH3D_LOG_WARNING(msg);}
+	#define BH3D_LOGGER(msg)					BH3D_LOG_LOCKED(BH3D_LOGGER_INSTANCE, BH3D_LOG_MSG(msg))
+	#define BH3D_LOGGER_ERROR(msg)				BH3D_LOG_LOCKED(BH3D_LOGGER_INSTANCE, BH3D_LOG_ERROR(msg))
+	#define BH3D_LOGGER_WARNING(msg)			BH3D_LOG_LOCKED(BH3D_LOGGER_INSTANCE, BH3D_LOG_WARNING(msg))
 
 #include <filesystem>
 #include <iomanip>
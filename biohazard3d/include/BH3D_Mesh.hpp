@@ -30,8 +30,10 @@
 #define _BH3D_MESH_H_
 
 #include <optional>
+#include <cstdint>
 
 #include "BH3D_VBO.hpp"
+#include "BH3D_VertexFormat.hpp"
 #include "BH3D_TextureManager.hpp"
 #include "BH3D_Material.hpp"
 #include "BH3D_Face.hpp"
@@ -65,6 +67,23 @@ namespace bh3d
 
 		using UOptionalUInt = std::optional<unsigned int>;
 
+		//Vertex attribute organisation in the VBO built by ComputeMesh
+		enum class VertexLayout
+		{
+			SEPARATE,		//one block per attribute (positions, then normals, then texture coordinates...)
+			INTERLEAVED		//all the attributes of a vertex packed together (one stride based vertex)
+		};
+
+		//Packed vertex formats used by ComputeMesh (the CPU arrays stay in float). A packed attribute implies the interleaved layout.
+		struct VertexCompression
+		{
+			bool positions = false;		//normalized shorts relative to the bounding box : drawn by Drawable::Draw, else the matrix sent to the shader has to include GetDequantizationMatrix
+			bool normals = false;		//normals and tangents in GL_INT_2_10_10_10_REV
+			bool texCoords = false;		//normalized unsigned shorts if they are in [0, 1], half floats otherwise
+			bool colors = false;		//normalized unsigned bytes
+			bool indices = true;		//GL_UNSIGNED_SHORT indices when the vertex number allows it
+		};
+
 	public:
 
 		~Mesh();
@@ -177,6 +196,21 @@ namespace bh3d
 		*/
 		virtual void DrawSubMesh(unsigned int id) const;
 
+		/// <summary>
+		/// Draws the submeshes of a level of detail using the current shader (Draw draws the LOD 0).
+		/// </summary>
+		/// <param name="lod">LOD index, lower than GetLodCount()</param>
+		virtual void DrawLod(unsigned int lod) const;
+
+		/// <summary>
+		/// Adds a level of detail : one new submesh for each submesh of the LOD 0, using the same vertices.
+		/// The LODs are added after all the submeshes, the submesh i of the LOD l is the submesh l * GetLodSubMeshCount() + i.
+		/// </summary>
+		/// <param name="vLodFaces">Faces of each submesh of the LOD 0 (mesh vertex ids, inside the vertex range of the submesh)</param>
+		/// <returns>BH3D_OK or BH3D_ERROR if the face lists don't match the submeshes</returns>
+		/// <remarks>The mesh become invalid.</remarks>
+		bool AddLod(const std::vector<std::vector<Face>> & vLodFaces);
+
 
 		/**
 		*\~english
@@ -283,6 +317,15 @@ namespace bh3d
 			inline std::vector<Mesh::SubMesh>&  GetTabSubMeshes();
 			inline std::size_t GetSubMeshCount() const;
 
+			//Level of detail number (1 without any LOD, see AddLod) and submesh number of each LOD
+			inline unsigned int GetLodCount() const;
+			inline std::size_t GetLodSubMeshCount() const;
+
+			//Face number drawn by a LOD
+			inline std::size_t GetLodFaceCount(unsigned int lod) const;
+
+			inline const BoundingBox & GetBoundingBox() const;
+
 
 			//applique un meme et unique material � tous les submeshes
 			inline void SetMaterial(const Material & m);
@@ -315,12 +358,43 @@ namespace bh3d
 			//Only call glDrawElements a the specific submesh (without any VBO or Material binding)
 			inline void DrawSubMeshElements(unsigned int submeshid) const;
 
+			//Only call glDrawElementsInstancedBaseInstance on the specific submesh (without any VBO or Material binding)
+			//baseInstance is the first instance read in the instance buffer of the VBO
+			inline void DrawSubMeshElementsInstanced(unsigned int submeshid, GLsizei instanceCount, GLuint baseInstance = 0) const;
+
+			//Access to the vbo used by the mesh (ex: to add per instance data before the call of ComputeMesh)
+			inline VBO & GetVBO();
+			inline const VBO & GetVBO() const;
+
+			//Vertex layout used by the next call of ComputeMesh (SEPARATE by default)
+			inline void SetVertexLayout(VertexLayout layout);
+			inline VertexLayout GetVertexLayout() const;
+
+			//Packed formats used by the next call of ComputeMesh
+			inline void SetVertexCompression(const VertexCompression & compression);
+			inline const VertexCompression & GetVertexCompression() const;
+
+			//Matrix to apply on the positions read in the VBO (model * GetDequantizationMatrix()). Identity if the positions are not packed.
+			inline const glm::mat4 & GetDequantizationMatrix() const;
+
+			//Index type of the element buffer (GL_UNSIGNED_INT or GL_UNSIGNED_SHORT)
+			inline GLenum GetIndexType() const;
+
 		protected:
 
 			bool LoadSubMesh(std::size_t nFaces, const unsigned int *pvFaces, std::size_t nVertices, const float * pvPositions, const float * pvTexCoords = nullptr, char textureFormat = 2, const float * pvNormals = nullptr, const float *pvColors = nullptr, char colorFormat = 0, const Material *pMaterial = nullptr);
 
 			virtual BoundingBox& ComputeBoundingBox();
 
+			/// <summary>
+			/// Packs the active attributes (position, normal, texture coordinates, color, tangent) of each vertex in a single array and adds it to the VBO
+			/// </summary>
+			/// <param name="vInterleaved">Interleaved vertices, have to stay valid until the call of VBO::Create</param>
+			void AddInterleavedArrayBufferData(std::vector<std::uint8_t> & vInterleaved);
+
+			//Byte offset of the first index of a submesh in the element buffer
+			inline std::size_t GetIndexByteOffset(const SubMesh & subMesh) const;
+
 		protected:
 
 
@@ -344,6 +418,13 @@ namespace bh3d
 			char m_textureFormat = 2; //2 or 3
 			char m_colorFormat = 3;	//3 or 4
 
+			VertexLayout m_vertexLayout = VertexLayout::SEPARATE;
+			VertexCompression m_vertexCompression;
+			glm::mat4 m_dequantization = glm::mat4(1.0f);	//packed positions to mesh space
+			GLenum m_indexType = GL_UNSIGNED_INT;
+
+			std::size_t m_lodSubMeshCount = 0;		//submesh number of a LOD (0 : no LOD added)
+
 			BoundingBox m_boundingBox;
 
 	};
@@ -404,6 +485,27 @@ namespace bh3d
 		return m_vSubMeshes.size();
 	}
 
+	inline unsigned int Mesh::GetLodCount() const {
+		return m_lodSubMeshCount ? (unsigned int)(m_vSubMeshes.size() / m_lodSubMeshCount) : 1;
+	}
+
+	inline std::size_t Mesh::GetLodSubMeshCount() const {
+		return m_lodSubMeshCount ? m_lodSubMeshCount : m_vSubMeshes.size();
+	}
+
+	inline std::size_t Mesh::GetLodFaceCount(unsigned int lod) const {
+		assert(lod < GetLodCount());
+		const std::size_t count = GetLodSubMeshCount();
+		std::size_t nFaces = 0;
+		for (std::size_t i = lod * count; i < (lod + 1) * count; i++)
+			nFaces += m_vSubMeshes[i].nFaces;
+		return nFaces;
+	}
+
+	inline const BoundingBox & Mesh::GetBoundingBox() const {
+		return m_boundingBox;
+	}
+
 	inline void Mesh::ScaleMesh(float scale, UOptionalUInt submeshid)
 	{
 		assert(!m_vSubMeshes.empty());
@@ -511,12 +613,66 @@ namespace bh3d
 		m_vSubMeshes[submeshid].nMaterial.Bind();
 	}
 
+	inline VBO & Mesh::GetVBO()
+	{
+		return m_vbo;
+	}
+
+	inline const VBO & Mesh::GetVBO() const
+	{
+		return m_vbo;
+	}
+
+	inline void Mesh::SetVertexLayout(VertexLayout layout)
+	{
+		m_vertexLayout = layout;
+	}
+
+	inline Mesh::VertexLayout Mesh::GetVertexLayout() const
+	{
+		return m_vertexLayout;
+	}
+
+	inline void Mesh::SetVertexCompression(const VertexCompression & compression)
+	{
+		m_vertexCompression = compression;
+	}
+
+	inline const Mesh::VertexCompression & Mesh::GetVertexCompression() const
+	{
+		return m_vertexCompression;
+	}
+
+	inline const glm::mat4 & Mesh::GetDequantizationMatrix() const
+	{
+		return m_dequantization;
+	}
+
+	inline GLenum Mesh::GetIndexType() const
+	{
+		return m_indexType;
+	}
+
+	inline std::size_t Mesh::GetIndexByteOffset(const SubMesh & subMesh) const
+	{
+		return subMesh.faceOffset * 3 * (m_indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(unsigned int));
+	}
+
 #define BH3D_BUFFER_OFFSET(i) ((void*)(i))
 	void Mesh::DrawSubMeshElements(unsigned int id) const
 	{
 		assert(id < m_vSubMeshes.size());
 		assert(IsValid() && "No valid Mesh, can't draw it");
-		glDrawElements(GL_TRIANGLES, (GLsizei)m_vSubMeshes[id].nFaces * 3, GL_UNSIGNED_INT, BH3D_BUFFER_OFFSET(m_vSubMeshes[id].faceOffset * 3 * sizeof(unsigned int)));
+		glDrawElements(GL_TRIANGLES, (GLsizei)m_vSubMeshes[id].nFaces * 3, m_indexType, BH3D_BUFFER_OFFSET(GetIndexByteOffset(m_vSubMeshes[id])));
+	}
+
+	void Mesh::DrawSubMeshElementsInstanced(unsigned int id, GLsizei instanceCount, GLuint baseInstance) const
+	{
+		assert(id < m_vSubMeshes.size());
+		assert(IsValid() && "No valid Mesh, can't draw it");
+		if (instanceCount <= 0)
+			return;
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, (GLsizei)m_vSubMeshes[id].nFaces * 3, m_indexType, BH3D_BUFFER_OFFSET(GetIndexByteOffset(m_vSubMeshes[id])), instanceCount, baseInstance);
 	}
 #undef BH3D_BUFFER_OFFSET
 
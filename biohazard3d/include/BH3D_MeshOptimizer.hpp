@@ -0,0 +1,117 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef _BH3D_MESH_OPTIMIZER_H_
+#define _BH3D_MESH_OPTIMIZER_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "BH3D_Mesh.hpp"
+
+namespace bh3d
+{
+
+	/// <summary>
+	/// Reordering of the triangles and vertices of a mesh for the GPU (CPU only, to call before Mesh::ComputeMesh) :
+	/// - post transform vertex cache : Forsyth triangle order
+	/// - overdraw : clusters of the cache order sorted from the outside to the inside of the mesh
+	/// - vertex fetch : vertices in the order of their first use
+	/// The index functions work on triangle lists with indices local to the vertex array.
+	/// </summary>
+	class MeshOptimizer
+	{
+	public:
+
+		/// <summary>
+		/// Size of the FIFO cache used to measure the ACMR (typical post transform cache)
+		/// </summary>
+		static constexpr unsigned int CACHE_SIZE = 16;
+
+		/// <summary>
+		/// Average cache miss ratio of the mesh, before and after Optimize
+		/// </summary>
+		struct Report
+		{
+			float acmrBefore = 0.0f;
+			float acmrAfter = 0.0f;
+		};
+
+		/// <summary>
+		/// Average cache miss ratio : transformed vertices by triangle with a FIFO cache (0.5 at best for a regular grid, 3 at worst)
+		/// </summary>
+		/// <param name="pIndices">triangle list</param>
+		/// <param name="nIndices">index number (3 by triangle)</param>
+		/// <param name="nVertices">vertex number (greater than all the indices)</param>
+		/// <param name="cacheSize">entries of the simulated FIFO cache</param>
+		static float ComputeACMR(const unsigned int * pIndices, std::size_t nIndices, std::size_t nVertices, unsigned int cacheSize = CACHE_SIZE);
+
+		/// <summary>
+		/// Reorders the triangles with the Forsyth algorithm : the next triangle is the best scored among the triangles of the vertices in a simulated LRU cache
+		/// </summary>
+		static void OptimizeVertexCache(unsigned int * pIndices, std::size_t nIndices, std::size_t nVertices);
+
+		/// <summary>
+		/// Splits the triangle order in clusters (cache restarts, then while the cluster ACMR stays under threshold times the original one)
+		/// and draws first the clusters facing the outside of the mesh, which hide the inner ones. To call after OptimizeVertexCache.
+		/// </summary>
+		/// <param name="pPositions">vertex positions</param>
+		/// <param name="threshold">ACMR degradation allowed to get smaller clusters (1.05 : 5%)</param>
+		static void OptimizeOverdraw(unsigned int * pIndices, std::size_t nIndices, const glm::vec3 * pPositions, std::size_t nVertices, float threshold = 1.05f);
+
+		/// <summary>
+		/// Renumbers the vertices in the order of their first use in the triangles (the unused vertices are moved at the end)
+		/// </summary>
+		/// <returns>Remap table : new index of each old vertex. The vertex streams have to be reordered with it (see RemapVertices).</returns>
+		static std::vector<unsigned int> OptimizeVertexFetch(unsigned int * pIndices, std::size_t nIndices, std::size_t nVertices);
+
+		/// <summary>
+		/// Moves the vertices of a stream to their new index : vVertices[remap[i]] = old vVertices[i]
+		/// </summary>
+		template<typename T>
+		static void RemapVertices(T * pVertices, const std::vector<unsigned int> & vRemap);
+
+		/// <summary>
+		/// Runs the three passes on each submesh of a mesh (its vertex streams are reordered too). The LODs sharing the vertices of a submesh follow its vertex order.
+		/// </summary>
+		/// <param name="mesh">not yet computed mesh (see Mesh::ComputeMesh)</param>
+		/// <param name="overdraw">runs the overdraw pass (needs the vertex cache order)</param>
+		/// <returns>ACMR of the whole mesh before and after</returns>
+		static Report Optimize(Mesh & mesh, bool overdraw = true);
+
+	};
+
+	template<typename T>
+	void MeshOptimizer::RemapVertices(T * pVertices, const std::vector<unsigned int> & vRemap)
+	{
+		std::vector<T> vSource(pVertices, pVertices + vRemap.size());
+		for (std::size_t i = 0; i < vRemap.size(); i++)
+			pVertices[vRemap[i]] = vSource[i];
+	}
+
+}
+#endif //_BH3D_MESH_OPTIMIZER_H_
@@ -0,0 +1,76 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef _BH3D_MESH_SIMPLIFIER_H_
+#define _BH3D_MESH_SIMPLIFIER_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "BH3D_Mesh.hpp"
+
+namespace bh3d
+{
+
+	/// <summary>
+	/// Mesh simplification by edge collapses ordered with quadric error metrics (Garland and Heckbert), to build levels of detail.
+	/// A collapse moves a vertex on one of its neighbours : the vertices are kept, only the triangle lists change, so the LODs share the vertex buffer.
+	/// The borders are kept by quadrics of planes orthogonal to the border faces, the attribute seams (several vertices at the same position) are locked,
+	/// and the collapses between vertices of different normals are penalized.
+	/// </summary>
+	class MeshSimplifier
+	{
+	public:
+
+		/// <summary>
+		/// Simplifies a triangle list until it has targetIndexCount indices or no collapse is possible anymore
+		/// </summary>
+		/// <param name="pIndices">triangle list (indices local to the vertex arrays)</param>
+		/// <param name="nIndices">index number (3 by triangle)</param>
+		/// <param name="pPositions">vertex positions</param>
+		/// <param name="pNormals">vertex normals, can be nullptr</param>
+		/// <param name="nVertices">vertex number</param>
+		/// <param name="targetIndexCount">wanted index number</param>
+		/// <param name="normalWeight">cost of a collapse between opposite normals, relative to the geometric error</param>
+		/// <returns>The simplified triangle list, using the same vertices</returns>
+		static std::vector<unsigned int> Simplify(const unsigned int * pIndices, std::size_t nIndices, const glm::vec3 * pPositions, const glm::vec3 * pNormals, std::size_t nVertices, std::size_t targetIndexCount, float normalWeight = 1.0f);
+
+		/// <summary>
+		/// Adds simplified LODs to a mesh (see Mesh::AddLod) : each LOD keeps ratio times the triangles of the previous one.
+		/// The generation stops when a LOD can't be simplified anymore.
+		/// </summary>
+		/// <param name="mesh">not yet computed mesh without LOD</param>
+		/// <param name="lodCount">wanted LOD number, the LOD 0 included</param>
+		/// <param name="ratio">triangle ratio between two LODs</param>
+		/// <param name="normalWeight">see Simplify</param>
+		/// <returns>The LOD number of the mesh</returns>
+		static unsigned int GenerateLods(Mesh & mesh, unsigned int lodCount, float ratio = 0.5f, float normalWeight = 1.0f);
+
+	};
+
+}
+#endif //_BH3D_MESH_SIMPLIFIER_H_
@@ -39,6 +39,8 @@ namespace bh3d
 	{
 	public:
 		std::filesystem::path m_filepath;
+		unsigned int m_lodCount = 1;		//! Number of LODs of the loaded mesh (the first one is the full mesh). 1 : no LOD generated, see MeshSimplifier::GenerateLods
+		float m_weldEpsilon = 0.0f;			//! Vertices welded on a grid of this cell size, 0 to only weld the identical positions
 		
 		bool LoadBinary(Mesh & mesh) const;
 
@@ -0,0 +1,259 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+#ifndef _BH3D_OCCUPANCY_GRID_H_
+#define _BH3D_OCCUPANCY_GRID_H_
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <limits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "BH3D_Ray.hpp"
+
+namespace bh3d
+{
+
+	/// <summary>
+	/// Result of a ray traversal of the grid
+	/// </summary>
+	struct GridHit
+	{
+		glm::ivec3 m_cell = { 0, 0, 0 };		//! First occupied cell crossed by the ray
+		glm::ivec3 m_normal = { 0, 0, 0 };		//! Normal of the entered cell face (null if the ray starts inside the cell)
+		int m_id = -1;							//! Id of the cell
+		float m_distance = 0.0f;				//! Distance along the ray to the entered face
+	};
+
+	/// <summary>
+	/// Spatial index over a dense 3D grid of cells.
+	/// Each cell stores an id (or NONE) and an occupancy bit. The occupancy bits are packed in bricks of 4x4x4 cells (one 64 bits mask per brick),
+	/// and a coarse level stores one bit per brick in nodes of 4x4x4 bricks, so the empty space is skipped by 4 or 16 cells at once.
+	/// All the updates are incremental (O(1)).
+	/// </summary>
+	class OccupancyGrid
+	{
+	public:
+
+		static constexpr int NONE = -1;			//! Id of a cell without object
+		static constexpr int BRICK_SIZE = 4;	//! Cells per brick on each axis (4x4x4 = 64 bits)
+		static constexpr int NODE_SIZE = 4;		//! Bricks per coarse node on each axis (4x4x4 = 64 bits)
+
+		/// <summary>
+		/// Resize the grid and clear all the cells
+		/// </summary>
+		/// <param name="dims">Cell number on each axis</param>
+		void Resize(const glm::ivec3 & dims);
+
+		/// <summary>
+		/// Clear all the cells (id NONE and not occupied)
+		/// </summary>
+		void Clear();
+
+		inline const glm::ivec3 & GetDims() const { return m_dims; }
+
+		inline bool IsInside(const glm::ivec3 & cell) const {
+			return cell.x >= 0 && cell.y >= 0 && cell.z >= 0 && cell.x < m_dims.x && cell.y < m_dims.y && cell.z < m_dims.z;
+		}
+
+		/// <summary>
+		/// Set the id and the occupancy of a cell
+		/// </summary>
+		void Set(const glm::ivec3 & cell, int id, bool occupied);
+
+		/// <summary>
+		/// Change only the occupancy of a cell
+		/// </summary>
+		void SetOccupied(const glm::ivec3 & cell, bool occupied);
+
+		/// <summary>
+		/// Id of the cell (NONE if the cell is outside the grid or without id)
+		/// </summary>
+		inline int GetId(const glm::ivec3 & cell) const {
+			return IsInside(cell) ? m_vIds[CellIndex(cell)] : NONE;
+		}
+
+		/// <summary>
+		/// Occupancy of a cell (false outside the grid)
+		/// </summary>
+		inline bool IsOccupied(const glm::ivec3 & cell) const {
+			if (!IsInside(cell))
+				return false;
+			return (m_vBrickMasks[BrickIndex(cell / BRICK_SIZE)] >> BrickBit(cell)) & 1u;
+		}
+
+		/// <summary>
+		/// If the brick containing the cell has no occupied cell (true outside the grid)
+		/// </summary>
+		inline bool IsBrickEmpty(const glm::ivec3 & cell) const {
+			if (!IsInside(cell))
+				return true;
+			return m_vBrickMasks[BrickIndex(cell / BRICK_SIZE)] == 0;
+		}
+
+		/// <summary>
+		/// If the coarse node containing the cell has no occupied cell (true outside the grid)
+		/// </summary>
+		inline bool IsNodeEmpty(const glm::ivec3 & cell) const {
+			if (!IsInside(cell))
+				return true;
+			return m_vNodeMasks[NodeIndex(cell / (BRICK_SIZE * NODE_SIZE))] == 0;
+		}
+
+		/// <summary>
+		/// Occupancy of the 6 neighbours of a cell as a bit mask : bit 0 (-x), 1 (+x), 2 (-y), 3 (+y), 4 (-z), 5 (+z)
+		/// </summary>
+		int GetNeighbours6(const glm::ivec3 & cell) const;
+
+		/// <summary>
+		/// Number of occupied cells
+		/// </summary>
+		inline std::size_t GetOccupiedCount() const { return m_occupiedCount; }
+
+		/// <summary>
+		/// Calls fct(cell, id) on each occupied cell inside the box [min, max] (inclusive).
+		/// The empty coarse nodes are skipped at once, then only the set bits of the node and brick masks are visited.
+		/// </summary>
+		template<typename Fct>
+		void ForEachOccupied(glm::ivec3 min, glm::ivec3 max, Fct && fct) const;
+
+		/// <summary>
+		/// 3D-DDA traversal (Amanatides-Woo) of the grid, returning the first occupied cell crossed by the ray.
+		/// The ray is expressed in cell space (the cell c covers [c, c+1[). The traversal steps over an empty coarse node or
+		/// an empty brick at once, and goes cell by cell only inside the non empty bricks.
+		/// </summary>
+		/// <param name="ray">Ray in cell space (the direction doesn't need to be normalized, the distance is then in direction units)</param>
+		/// <param name="hit">Filled with the hit cell when the function returns true</param>
+		/// <param name="maxDistance">Maximum distance along the ray</param>
+		/// <returns>true if an occupied cell is hit</returns>
+		bool Raycast(const Ray & ray, GridHit & hit, float maxDistance = std::numeric_limits<float>::max()) const;
+
+	private:
+
+		inline std::size_t CellIndex(const glm::ivec3 & c) const {
+			return (std::size_t)c.x + (std::size_t)m_dims.x * ((std::size_t)c.y + (std::size_t)m_dims.y * (std::size_t)c.z);
+		}
+		inline std::size_t BrickIndex(const glm::ivec3 & b) const {
+			return (std::size_t)b.x + (std::size_t)m_brickDims.x * ((std::size_t)b.y + (std::size_t)m_brickDims.y * (std::size_t)b.z);
+		}
+		inline std::size_t NodeIndex(const glm::ivec3 & n) const {
+			return (std::size_t)n.x + (std::size_t)m_nodeDims.x * ((std::size_t)n.y + (std::size_t)m_nodeDims.y * (std::size_t)n.z);
+		}
+		static inline unsigned int BrickBit(const glm::ivec3 & c) {
+			return (unsigned int)(c.x % BRICK_SIZE + BRICK_SIZE * (c.y % BRICK_SIZE + BRICK_SIZE * (c.z % BRICK_SIZE)));
+		}
+		static inline unsigned int NodeBit(const glm::ivec3 & b) {
+			return (unsigned int)(b.x % NODE_SIZE + NODE_SIZE * (b.y % NODE_SIZE + NODE_SIZE * (b.z % NODE_SIZE)));
+		}
+		static inline bool IsInBox(const glm::ivec3 & c, const glm::ivec3 & min, const glm::ivec3 & max) {
+			return c.x >= min.x && c.y >= min.y && c.z >= min.z && c.x <= max.x && c.y <= max.y && c.z <= max.z;
+		}
+		//Index of the lowest set bit of a non null mask
+		static inline unsigned int LowestBit(std::uint64_t mask) {
+			assert(mask != 0);
+#if defined(__GNUC__) || defined(__clang__)
+			return (unsigned int)__builtin_ctzll(mask);
+#elif defined(_MSC_VER) && defined(_M_X64)
+			unsigned long index;
+			_BitScanForward64(&index, mask);
+			return (unsigned int)index;
+#else
+			unsigned int index = 0;
+			while ((mask & 1u) == 0)
+			{
+				mask >>= 1;
+				index++;
+			}
+			return index;
+#endif
+		}
+
+		glm::ivec3 m_dims = { 0, 0, 0 };			//! cells
+		glm::ivec3 m_brickDims = { 0, 0, 0 };		//! bricks
+		glm::ivec3 m_nodeDims = { 0, 0, 0 };		//! coarse nodes
+
+		std::vector<std::int32_t> m_vIds;			//! id of each cell
+		std::vector<std::uint64_t> m_vBrickMasks;	//! occupancy bit of each cell of a brick
+		std::vector<std::uint64_t> m_vNodeMasks;	//! non empty bit of each brick of a node
+		std::size_t m_occupiedCount = 0;
+	};
+
+	template<typename Fct>
+	void OccupancyGrid::ForEachOccupied(glm::ivec3 min, glm::ivec3 max, Fct && fct) const
+	{
+		min = glm::max(min, glm::ivec3(0));
+		max = glm::min(max, m_dims - 1);
+		if (min.x > max.x || min.y > max.y || min.z > max.z)
+			return;
+
+		constexpr int NODE_CELLS = BRICK_SIZE * NODE_SIZE;
+		const glm::ivec3 bmin = min / BRICK_SIZE;
+		const glm::ivec3 bmax = max / BRICK_SIZE;
+		const glm::ivec3 nmin = min / NODE_CELLS;
+		const glm::ivec3 nmax = max / NODE_CELLS;
+
+		glm::ivec3 n;
+		for (n.z = nmin.z; n.z <= nmax.z; n.z++)
+		for (n.y = nmin.y; n.y <= nmax.y; n.y++)
+		for (n.x = nmin.x; n.x <= nmax.x; n.x++)
+		{
+			//Only the non empty bricks of a non empty node are visited
+			std::uint64_t nodeMask = m_vNodeMasks[NodeIndex(n)];
+			while (nodeMask != 0)
+			{
+				const unsigned int brickBit = LowestBit(nodeMask);
+				nodeMask &= nodeMask - 1;
+
+				const glm::ivec3 b = n * NODE_SIZE + glm::ivec3(brickBit % NODE_SIZE, (brickBit / NODE_SIZE) % NODE_SIZE, brickBit / (NODE_SIZE * NODE_SIZE));
+				if (!IsInBox(b, bmin, bmax))
+					continue;
+
+				//Only the occupied cells of the brick are visited
+				std::uint64_t brickMask = m_vBrickMasks[BrickIndex(b)];
+				while (brickMask != 0)
+				{
+					const unsigned int cellBit = LowestBit(brickMask);
+					brickMask &= brickMask - 1;
+
+					const glm::ivec3 c = b * BRICK_SIZE + glm::ivec3(cellBit % BRICK_SIZE, (cellBit / BRICK_SIZE) % BRICK_SIZE, cellBit / (BRICK_SIZE * BRICK_SIZE));
+					if (!IsInBox(c, min, max))
+						continue;
+
+					fct(c, m_vIds[CellIndex(c)]);
+				}
+			}
+		}
+	}
+
+}
+#endif //_BH3D_OCCUPANCY_GRID_H_
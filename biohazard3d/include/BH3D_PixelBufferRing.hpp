@@ -0,0 +1,109 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef _BH3D_PIXEL_BUFFER_RING_H_
+#define _BH3D_PIXEL_BUFFER_RING_H_
+
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace bh3d
+{
+	/// <summary>
+	/// Ring of pixel unpack buffers (PBO) to stream the texture uploads.
+	/// The pixels are copied in a mapped buffer and the texture is filled from the buffer (glTexSubImage* with an offset),
+	/// so the driver doesn't have to copy the client memory before glTexSubImage* returns.
+	/// Each buffer is protected by a fence : the CPU never writes in a buffer still read by a previous upload.
+	/// </summary>
+	class PixelBufferRing
+	{
+	public:
+
+		PixelBufferRing(GLuint bufferCount = 3) : m_bufferCount(bufferCount) {}
+		~PixelBufferRing();
+
+		PixelBufferRing(const PixelBufferRing &) = delete;
+		PixelBufferRing& operator=(const PixelBufferRing &) = delete;
+
+		/// <summary>
+		/// Fill a region of the level of the binded 2D texture from the next buffer of the ring (see glTexSubImage2D)
+		/// </summary>
+		/// <param name="target">Texture target (GL_TEXTURE_2D...)</param>
+		/// <param name="level">Mipmap level</param>
+		/// <param name="width">Image width</param>
+		/// <param name="height">Image height</param>
+		/// <param name="format">Opengl format (GL_RED, GL_RG, GL_BGR, GL_BGRA...)</param>
+		/// <param name="type">Opengl Type (GL_UNSIGNED_BYTE,...)</param>
+		/// <param name="pixels">Raw memory (laid out with the current GL_UNPACK_ALIGNMENT)</param>
+		/// <returns>false if the format is unknown or the buffer can't be mapped : the caller has to upload from the client memory</returns>
+		bool TexSubImage2D(GLenum target, GLint level, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+
+		/// <summary>
+		/// Fill one layer of the binded texture array from the next buffer of the ring (see glTexSubImage3D)
+		/// </summary>
+		/// <param name="layer">Layer index</param>
+		/// <returns>false if the format is unknown or the buffer can't be mapped : the caller has to upload from the client memory</returns>
+		bool TexSubImage3D(GLenum target, GLint level, GLint layer, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+
+		/// <summary>
+		/// Release the buffers and the fences (the OpenGL context has to be current)
+		/// </summary>
+		void Destroy();
+
+		/// <summary>
+		/// Byte size of an image in client memory, with the current GL_UNPACK_ALIGNMENT (0 if the format or the type is unknown)
+		/// </summary>
+		static std::size_t ImageByteSize(GLsizei width, GLsizei height, GLenum format, GLenum type);
+
+	private:
+
+		//Buffer of the ring
+		struct PixelBuffer
+		{
+			GLuint bufferID = 0;
+			std::size_t capacity = 0;
+			GLsync fence = nullptr;
+		};
+
+		/// <summary>
+		/// Wait the next buffer, copy the pixels in it and let it bound as GL_PIXEL_UNPACK_BUFFER
+		/// </summary>
+		/// <returns>the buffer, or nullptr if the upload has to be done from the client memory</returns>
+		PixelBuffer * Stage(const void *pixels, std::size_t byteSize);
+
+		/// <summary>
+		/// Fence the staged buffer once the glTexSubImage* call is submitted and unbind it
+		/// </summary>
+		void Release(PixelBuffer & buffer);
+
+		GLuint m_bufferCount = 3;
+		GLuint m_current = 0;
+		std::vector<PixelBuffer> m_vBuffers;
+	};
+}
+
+#endif //_BH3D_PIXEL_BUFFER_RING_H_
@@ -0,0 +1,86 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef _BH3D_PROGRAM_CACHE_H_
+#define _BH3D_PROGRAM_CACHE_H_
+
+#include <string>
+#include <filesystem>
+
+#include <glad/glad.h>
+
+namespace bh3d
+{
+	/// <summary>
+	/// Disk cache of linked shader programs (glGetProgramBinary / glProgramBinary).
+	/// A file is keyed by the program sources and by the driver (vendor, renderer, version) : a driver update links the programs again.
+	/// All the functions must be called from the OpenGL thread.
+	/// </summary>
+	class ProgramCache
+	{
+	public:
+
+		ProgramCache(const std::filesystem::path & directory) :
+			m_directory(directory)
+		{}
+
+		inline const std::filesystem::path & GetDirectory() const { return m_directory; }
+
+		/// <summary>
+		/// Create a program from its cached binary
+		/// </summary>
+		/// <param name="key">Program key (sources...)</param>
+		/// <returns>Linked program, or 0 if the cache is missing, out of date or rejected by the driver</returns>
+		GLuint Load(const std::string & key);
+
+		/// <summary>
+		/// Write the binary of a linked program in the cache
+		/// </summary>
+		/// <param name="key">Program key (sources...)</param>
+		/// <param name="program">Linked program (created with GL_PROGRAM_BINARY_RETRIEVABLE_HINT)</param>
+		/// <returns>if it's ok ?</returns>
+		bool Store(const std::string & key, GLuint program);
+
+		/// <summary>
+		/// Cache file of a program
+		/// </summary>
+		std::filesystem::path GetCachePath(const std::string & key);
+
+		//If the driver supports at least one program binary format
+		bool IsSupported();
+
+	private:
+
+		//Driver identification, queried at the first use
+		const std::string & GetDriver();
+
+		std::filesystem::path m_directory;
+		std::string m_driver;
+		int m_binaryFormats = -1;	//! number of program binary formats (-1 : not yet queried)
+	};
+}
+
+#endif //_BH3D_PROGRAM_CACHE_H_
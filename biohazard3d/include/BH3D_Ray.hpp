@@ -0,0 +1,51 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+#ifndef _BH3D_RAY_H_
+#define _BH3D_RAY_H_
+
+#include <glm/glm.hpp>
+
+namespace bh3d
+{
+
+	/// <summary>
+	/// Half line defined by an origin and a direction
+	/// </summary>
+	struct Ray
+	{
+		glm::vec3 m_origin = glm::vec3(0.0f);					//! Ray start point
+		glm::vec3 m_direction = { 0.0f, 0.0f, -1.0f };			//! Normalized ray direction
+
+		/// <summary>
+		/// Point of the ray at the distance t from the origin
+		/// </summary>
+		inline glm::vec3 At(float t) const { return m_origin + m_direction * t; }
+	};
+
+}
+#endif //_BH3D_RAY_H_
@@ -22,31 +22,160 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
-
 #pragma once
 #ifndef _BH3D_RESOURCE_MANAGER_H_
 #define _BH3D_RESOURCE_MANAGER_H_
 
+#include <cassert>
 #include <functional>
 #include <filesystem>
-#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <sstream>
 #include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
 
 #include "BH3D_Logger.hpp"
+#include "BH3D_Hash.hpp"
 #include "BH3D_Bindgleton.hpp"
 
 namespace bh3d
 {
+	/// <summary>
+	/// Stable reference to a resource of a ResourceManager.
+	/// The generation counter of the slot changes when the resource is erased : an old handle never gives the next resource of the slot.
+	/// </summary>
+	struct ResourceHandle
+	{
+		static constexpr std::uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+		std::uint32_t index = INVALID_INDEX;
+		std::uint32_t generation = 0;
+
+		inline bool IsValid() const { return index != INVALID_INDEX; }
+		inline explicit operator bool() const { return IsValid(); }
+		inline bool operator==(const ResourceHandle & h) const { return index == h.index && generation == h.generation; }
+		inline bool operator!=(const ResourceHandle & h) const { return !(*this == h); }
+	};
+
+	/// <summary>
+	/// Identification key of a resource value (ex: the OpenGL id of a texture), used to erase a resource by value in O(1).
+	/// Specialize it with a static function std::uint64_t Get(const ResT &). Without specialization, Erase(ResT*) scans the resources.
+	/// </summary>
+	template <typename ResT>
+	struct ResourceKey {};
+
+	template <typename T, typename ResT>
+	class ResourceManager;
+
+	/// <summary>
+	/// Reference counted handle of a resource (see ResourceManager::LoadShared, AddShared, Acquire).
+	/// A resource without reference goes to the LRU list of its manager and can be evicted to respect the memory budget.
+	/// The copies of the resource given by Get are only valid while a reference is kept. A reference must not outlive its manager.
+	/// </summary>
+	template <typename T, typename ResT>
+	class ResourceRef
+	{
+		friend class ResourceManager<T, ResT>;
+
+		ResourceManager<T, ResT> * m_manager = nullptr;
+		ResourceHandle m_handle;
+
+		//The reference is already counted by the manager
+		ResourceRef(ResourceManager<T, ResT> * manager, ResourceHandle handle) : m_manager(manager), m_handle(handle) {}
+
+	public:
+		ResourceRef() = default;
+		ResourceRef(const ResourceRef & ref) : m_manager(ref.m_manager), m_handle(ref.m_handle) {
+			if (m_manager)
+				m_manager->AddReference(m_handle);
+		}
+		ResourceRef(ResourceRef && ref) noexcept : m_manager(ref.m_manager), m_handle(ref.m_handle) {
+			ref.m_manager = nullptr;
+			ref.m_handle = {};
+		}
+		~ResourceRef() { Reset(); }
+
+		ResourceRef & operator=(const ResourceRef & ref) {
+			if (this != &ref) {
+				ResourceRef tmp(ref);
+				*this = std::move(tmp);
+			}
+			return *this;
+		}
+		ResourceRef & operator=(ResourceRef && ref) noexcept {
+			if (this != &ref) {
+				Reset();
+				std::swap(m_manager, ref.m_manager);
+				std::swap(m_handle, ref.m_handle);
+			}
+			return *this;
+		}
+
+		//Release the reference
+		void Reset() {
+			if (m_manager)
+				m_manager->ReleaseReference(m_handle);
+			m_manager = nullptr;
+			m_handle = {};
+		}
+
+		//Resource, or the default resource if it has been erased
+		ResT Get() const { return m_manager ? m_manager->Get(m_handle) : ResT(); }
+
+		inline ResourceHandle GetHandle() const { return m_handle; }
+		inline bool IsValid() const { return m_manager && m_manager->IsValid(m_handle); }
+		inline explicit operator bool() const { return IsValid(); }
+	};
+
+	/// <summary>
+	/// Named resource container (textures, ...).
+	/// The resources are stored in slots indexed by the hash of their name (see ResourceIndex) : the lookups are O(1) and don't allocate.
+	/// The lookups (Find, Get, Load of an existing resource) can be done from any thread, they share a read lock.
+	/// The resource creation (LoadResourceFromFile...) stays on the caller thread (OpenGL thread for the OpenGL resources).
+	/// Lifetime : the resources of Load/Add are resident until Erase/Clear. The resources of LoadShared/AddShared are reference counted
+	/// (see ResourceRef) : once unreferenced, they are evicted in LRU order when the memory budget is exceeded (see SetMemoryBudget),
+	/// then freed by the next FreeEvicted call on the OpenGL thread.
+	/// </summary>
 	template <typename T, typename ResT>
 	class ResourceManager : public Bindgleton< T >
 	{
 		//singleton
 		static auto GetDefaultName() {
-			thread_local static std::atomic<unsigned int> m_default_name_id = 0;
+			static std::atomic<unsigned int> m_default_name_id = 0;
 			return std::string("ResourceManager ") + std::to_string(m_default_name_id++);
 		}
 
+		template <typename R, typename = void>
+		struct HasResourceKey : std::false_type {};
+		template <typename R>
+		struct HasResourceKey<R, std::void_t<decltype(ResourceKey<R>::Get(std::declval<const R &>()))>> : std::true_type {};
+
+		//Resource storage
+		struct Slot
+		{
+			std::string name;				//interned resource name
+			std::uint64_t hash = 0;			//hash of the name
+			std::uint64_t key = 0;			//ResourceKey of the resource (if specialized)
+			ResT resource;
+			std::uint32_t generation = 0;	//changed by each erase
+			bool used = false;
+
+			bool pinned = false;			//resident until Erase/Clear (Load/Add)
+			std::uint32_t refCount = 0;		//ResourceRef count
+			std::size_t byteSize = 0;		//see GetResourceByteSize
+			std::uint32_t lruPrev = ResourceIndex::NONE;	//LRU list of the unreferenced resources
+			std::uint32_t lruNext = ResourceIndex::NONE;
+			bool inLru = false;
+		};
+
+		friend class ResourceRef<T, ResT>;
+
 	public:
 
 		ResourceManager(const std::string & name = {}, bool bind = true) : m_name(name.empty() ? GetDefaultName() : name)
@@ -71,12 +200,46 @@ namespace bh3d
 
 		ResT Load(const void * data, std::string resource_name);									//Load the resource from file and give a resouce name for identification
 
-		ResT Add(ResT && resource, std::string resource_name);										//Add a resource to the manager
+		ResT Add(ResT && resource, std::string resource_name);										//Add a resource to the manager (replace the resource with the same name)
+
+		using Ref = ResourceRef<T, ResT>;
+
+		//Reference counted versions of Load and Add : the resource can be evicted once unreferenced (an already resident resource stays resident)
+		Ref LoadShared(const std::filesystem::path & pathname, const std::string & resource_name = {});
+		Ref AddShared(ResT && resource, std::string resource_name);
+
+		//New reference to a named resource (invalid reference if unknown)
+		Ref Acquire(std::string_view resource_name);
 
+		//Find a resource by name (O(1), no allocation, thread safe)
+		bool Find(std::string_view resource_name, ResT & resource) const;
+
+		//Handle of a named resource (invalid handle if unknown)
+		ResourceHandle GetHandle(std::string_view resource_name) const;
+
+		//Resource of a handle, or the default resource if the handle is out of date
+		ResT Get(ResourceHandle handle);
+
+		//Check if the resource of the handle still exists
+		bool IsValid(ResourceHandle handle) const;
 
 		//Number of resources
 		std::size_t Size() const;
 
+		//Maximum byte size of the resources (0 : no limit). The unreferenced shared resources are evicted beyond it (least recently released first)
+		void SetMemoryBudget(std::size_t byteBudget);
+		inline std::size_t GetMemoryBudget() const { return m_memoryBudget; }
+
+		//Estimated byte size of the resources (see GetResourceByteSize)
+		std::size_t GetMemoryUsage() const;
+
+		//Number of unreferenced shared resources (evictable)
+		std::size_t GetEvictableCount() const;
+
+		//Free the resources evicted by the memory budget and return their number. The eviction can be triggered by any thread releasing
+		//the last reference (ex: a decoding worker) : the evicted resources are only freed here, to call from the OpenGL thread (once per frame)
+		std::size_t FreeEvicted();
+
 		//Get the resource list in a string
 		void GetResourceList(std::string & list, const std::string & splitter = "\n") const;
 
@@ -84,7 +247,10 @@ namespace bh3d
 		bool Erase(const std::string & resource_name);
 		inline bool Erase(const std::filesystem::path & pathname) { return this->Erase(pathname.generic_string()); }
 
-		//Delete a resource by adresse
+		//Delete a resource by handle
+		bool Erase(ResourceHandle handle);
+
+		//Delete a resource by adresse (O(1) if ResourceKey<ResT> is specialized)
 		bool Erase(ResT * resource);
 		inline bool Erase(ResT & resource) { return Erase(&resource); }
 
@@ -114,16 +280,88 @@ namespace bh3d
 
 		void FreeResource(ResT & resource);
 
+		//Estimated byte size of a resource, used by the memory budget (0 by default)
+		virtual std::size_t GetResourceByteSize(const ResT & /*resource*/) const { return 0; }
+
 	protected:
+
+		//Slot of a name, or ResourceIndex::NONE (to call with the lock)
+		std::uint32_t FindSlot(std::string_view resource_name) const;
+
+		//Remove the resource of a slot, freed or not (to call with the exclusive lock)
+		void EraseSlot(std::uint32_t slot, bool free = true);
+
+		//Call fct(resource_name) with the generic name of a path, without allocation if the native format is already generic
+		template <typename Func>
+		static auto WithPathName(const std::filesystem::path & pathname, Func && fct);
+
+		//Estimate again the byte size of a resource changed in place (ex: texture uploaded later)
+		void UpdateResourceByteSize(std::string_view resource_name);
+
 		std::string m_name = "default";						//! Manager Name/ID
-		std::map<std::string, ResT> m_mapResources;
 		ResT m_defaultResource;
 		SFreeResourceCallBack m_freeResourceCallBack;
+
+	private:
+		mutable std::shared_mutex m_mutex;			//! shared : lookups, exclusive : add/erase
+		std::vector<Slot> m_vSlots;
+		std::vector<std::uint32_t> m_vFreeSlots;
+		ResourceIndex m_nameIndex;					//! name hash -> slot
+		ResourceIndex m_keyIndex;					//! ResourceKey -> slot (if specialized)
+		std::size_t m_size = 0;
+
+		std::size_t m_memoryBudget = 0;
+		std::size_t m_memoryUsage = 0;
+		std::uint32_t m_lruHead = ResourceIndex::NONE;	//! most recently released
+		std::uint32_t m_lruTail = ResourceIndex::NONE;	//! least recently released (next evicted)
+		std::size_t m_lruCount = 0;
+		std::vector<ResT> m_vEvicted;				//! evicted resources waiting for FreeEvicted
+
+		//Add or replace a named resource (to call with the exclusive lock)
+		std::uint32_t AddSlot(ResT && resource, std::string && resource_name, bool pinned);
+
+		//Reference counting (see ResourceRef)
+		void AddReference(ResourceHandle handle);
+		void ReleaseReference(ResourceHandle handle);
+
+		//LRU list of the unreferenced resources (to call with the exclusive lock)
+		void LinkLru(std::uint32_t slot);
+		void UnlinkLru(std::uint32_t slot);
+
+		//Evict the least recently released resources while the budget is exceeded (to call with the exclusive lock)
+		void EvictOverBudget();
+
+		inline bool IsValidHandle(ResourceHandle handle) const {
+			return handle.index < m_vSlots.size() && m_vSlots[handle.index].used && m_vSlots[handle.index].generation == handle.generation;
+		}
 	};
 
 	//Declaration des fonctions
 	//-------------------------------------------------------
 
+	template <typename T, typename ResT>
+	template <typename Func>
+	auto ResourceManager<T, ResT>::WithPathName(const std::filesystem::path & pathname, Func && fct)
+	{
+		if constexpr (std::is_same_v<std::filesystem::path::value_type, char> && std::filesystem::path::preferred_separator == '/')
+		{
+			return fct(std::string_view(pathname.native()));
+		}
+		else
+		{
+			const std::string name = pathname.generic_string();
+			return fct(std::string_view(name));
+		}
+	}
+
+	template <typename T, typename ResT>
+	std::uint32_t ResourceManager<T, ResT>::FindSlot(std::string_view resource_name) const
+	{
+		return m_nameIndex.Find(HashFNV1a(resource_name), [this, resource_name](std::uint32_t slot) {
+			return m_vSlots[slot].name == resource_name;
+		});
+	}
+
 	template <typename T, typename ResT>
 	ResT ResourceManager<T, ResT>::Load(const std::filesystem::path & pathname, const std::string & resource_name)
 	{
@@ -133,28 +371,52 @@ namespace bh3d
 			return GetDefaultResouce();
 		}
 
+		//Check if the resource already exist (a shared resource becomes resident : its copy is not counted)
+		ResT resource;
+		auto findResident = [this, &resource](std::string_view name) {
+			bool pinned = false;
+			{
+				std::shared_lock<std::shared_mutex> lock(m_mutex);
+				const std::uint32_t slot = FindSlot(name);
+				if (slot == ResourceIndex::NONE)
+					return false;
+				resource = m_vSlots[slot].resource;
+				pinned = m_vSlots[slot].pinned;
+			}
+			if (!pinned)
+			{
+				std::unique_lock<std::shared_mutex> lock(m_mutex);
+				if (const std::uint32_t slot = FindSlot(name); slot != ResourceIndex::NONE)
+				{
+					m_vSlots[slot].pinned = true;
+					UnlinkLru(slot);
+				}
+			}
+			return true;
+		};
+		const bool found = resource_name.empty() ?
+			WithPathName(pathname, findResident) :
+			findResident(resource_name);
+		if (found)
+			return resource;
+
 		//Add the resource to the map
 		auto valid_resource_name = resource_name.empty() ?
 			pathname.generic_string() :
 			resource_name;
 
-		//Check if the resource already exist
-		if (auto it = m_mapResources.find(valid_resource_name); it != m_mapResources.end())
-			return it->second;
-
 		//load the resource (with a virtual fonction)
-		ResT resource;
 		if (!LoadResourceFromFile(pathname, resource))
 		{
 			BH3D_LOGGER_WARNING("Can't load the file resource : " << pathname);
 			return GetDefaultResouce();
 		}
 		
-		auto & ref = m_mapResources[valid_resource_name] = std::move(resource);
+		resource = Add(std::move(resource), valid_resource_name);
 
 		BH3D_LOGGER("Resource ok : " << pathname << " (" << m_name << ")");
 
-		return ref;
+		return resource;
 	}
 
 	template <typename T, typename ResT>
@@ -174,11 +436,11 @@ namespace bh3d
 		}
 
 		//Check if the source doesn't already exist
-		if (auto it = m_mapResources.find(resource_name); it != m_mapResources.end())
-			return it->second;
+		ResT resource;
+		if (Find(resource_name, resource))
+			return resource;
 
 		//Load the source
-		ResT resource;
 		if (!LoadResourceFromRaw(data, resource))
 		{
 			BH3D_LOGGER_WARNING("Can't load the raw resource : " << resource_name);
@@ -186,11 +448,11 @@ namespace bh3d
 		}
 
 		//Add the source to the map
-		auto & ref = m_mapResources[resource_name] = std::move(resource);
+		resource = Add(std::move(resource), resource_name);
 
 		BH3D_LOGGER("Raw Resource ok : " << resource_name << " (" << m_name << ")");
 
-		return ref;
+		return resource;
 
 	}
 
@@ -204,52 +466,396 @@ namespace bh3d
 			resource_name = ss.str();
 		}
 
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+		const std::uint32_t slot = AddSlot(std::move(resource), std::move(resource_name), true);
+		EvictOverBudget();
+
+		return m_vSlots[slot].resource;
+	}
+
+	template <typename T, typename ResT>
+	std::uint32_t ResourceManager<T, ResT>::AddSlot(ResT && resource, std::string && resource_name, bool pinned)
+	{
+		//A resource with the same name is replaced in its slot (the previous resource is not freed, its copies stay valid)
+		if (std::uint32_t slot = FindSlot(resource_name); slot != ResourceIndex::NONE)
+		{
 #ifdef _DEBUG
-		//Check if the source doesn't already exist
-		if (auto it = m_mapResources.find(resource_name); it != m_mapResources.end()) {
 			BH3D_LOGGER_WARNING("A resource with the same name already exists: " << resource_name);
-		}
 #endif
+			Slot & ref = m_vSlots[slot];
+			ref.resource = std::move(resource);
+			if constexpr (HasResourceKey<ResT>::value)
+			{
+				m_keyIndex.Remove(ref.key, slot);
+				ref.key = ResourceKey<ResT>::Get(ref.resource);
+				m_keyIndex.Insert(ref.key, slot);
+			}
 
-		//Add the source to the map
-		auto & ref = m_mapResources[resource_name] = std::move(resource);
+			m_memoryUsage -= ref.byteSize;
+			ref.byteSize = GetResourceByteSize(ref.resource);
+			m_memoryUsage += ref.byteSize;
+
+			if (pinned)
+			{
+				ref.pinned = true;
+				UnlinkLru(slot);
+			}
+
+			BH3D_LOGGER("Resource Add : " << ref.name << " (" << m_name << ")");
+
+			return slot;
+		}
+
+		std::uint32_t slot = 0;
+		if (!m_vFreeSlots.empty())
+		{
+			slot = m_vFreeSlots.back();
+			m_vFreeSlots.pop_back();
+		}
+		else
+		{
+			slot = (std::uint32_t)m_vSlots.size();
+			m_vSlots.emplace_back();
+		}
+
+		Slot & ref = m_vSlots[slot];
+		ref.hash = HashFNV1a(resource_name);
+		ref.name = std::move(resource_name);
+		ref.resource = std::move(resource);
+		ref.used = true;
+		ref.pinned = pinned;
+		ref.refCount = 0;
+		ref.byteSize = GetResourceByteSize(ref.resource);
+		m_nameIndex.Insert(ref.hash, slot);
+
+		if constexpr (HasResourceKey<ResT>::value)
+		{
+			ref.key = ResourceKey<ResT>::Get(ref.resource);
+			m_keyIndex.Insert(ref.key, slot);
+		}
+
+		m_size++;
+		m_memoryUsage += ref.byteSize;
+
+		BH3D_LOGGER("Resource Add : " << ref.name << " (" << m_name << ")");
+
+		return slot;
+	}
+
+	template <typename T, typename ResT>
+	typename ResourceManager<T, ResT>::Ref ResourceManager<T, ResT>::LoadShared(const std::filesystem::path & pathname, const std::string & resource_name)
+	{
+		if (pathname.empty())
+		{
+			assert(!pathname.empty() && "Empty path");
+			return {};
+		}
+
+		//Check if the resource already exist
+		Ref ref = resource_name.empty() ?
+			WithPathName(pathname, [this](std::string_view name) { return Acquire(name); }) :
+			Acquire(resource_name);
+		if (ref.m_manager)
+			return ref;
+
+		//load the resource (with a virtual fonction)
+		ResT resource;
+		if (!LoadResourceFromFile(pathname, resource))
+		{
+			BH3D_LOGGER_WARNING("Can't load the file resource : " << pathname);
+			return {};
+		}
 
-		BH3D_LOGGER("Resource Add : " << resource_name << " (" << m_name << ")");
+		ref = AddShared(std::move(resource), resource_name.empty() ? pathname.generic_string() : resource_name);
+
+		BH3D_LOGGER("Resource ok : " << pathname << " (" << m_name << ")");
 
 		return ref;
 	}
 
+	template <typename T, typename ResT>
+	typename ResourceManager<T, ResT>::Ref ResourceManager<T, ResT>::AddShared(ResT && resource, std::string resource_name)
+	{
+		//if resource_name is empty use the adresse as id
+		if (resource_name.empty()) {
+			std::stringstream ss;
+			ss << (void*)(&resource);
+			resource_name = ss.str();
+		}
+
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+		const std::uint32_t slot = AddSlot(std::move(resource), std::move(resource_name), false);
+		Slot & ref = m_vSlots[slot];
+		ref.refCount++;
+		UnlinkLru(slot);
+
+		const ResourceHandle handle = { slot, ref.generation };
+		EvictOverBudget();
+
+		return Ref(this, handle);
+	}
+
+	template <typename T, typename ResT>
+	typename ResourceManager<T, ResT>::Ref ResourceManager<T, ResT>::Acquire(std::string_view resource_name)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+		const std::uint32_t slot = FindSlot(resource_name);
+		if (slot == ResourceIndex::NONE)
+			return {};
+
+		Slot & ref = m_vSlots[slot];
+		ref.refCount++;
+		UnlinkLru(slot);
+
+		return Ref(this, { slot, ref.generation });
+	}
+
+	template <typename T, typename ResT>
+	void ResourceManager<T, ResT>::AddReference(ResourceHandle handle)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+		if (!IsValidHandle(handle))
+			return;
 
+		Slot & ref = m_vSlots[handle.index];
+		ref.refCount++;
+		UnlinkLru(handle.index);
+	}
+
+	template <typename T, typename ResT>
+	void ResourceManager<T, ResT>::ReleaseReference(ResourceHandle handle)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+		//The resource may have been erased
+		if (!IsValidHandle(handle))
+			return;
+
+		Slot & ref = m_vSlots[handle.index];
+		assert(ref.refCount > 0);
+		if (--ref.refCount == 0 && !ref.pinned)
+		{
+			LinkLru(handle.index);
+			EvictOverBudget();
+		}
+	}
+
+	template <typename T, typename ResT>
+	void ResourceManager<T, ResT>::LinkLru(std::uint32_t slot)
+	{
+		Slot & ref = m_vSlots[slot];
+		if (ref.inLru)
+			return;
+
+		ref.inLru = true;
+		ref.lruPrev = ResourceIndex::NONE;
+		ref.lruNext = m_lruHead;
+		if (m_lruHead != ResourceIndex::NONE)
+			m_vSlots[m_lruHead].lruPrev = slot;
+		m_lruHead = slot;
+		if (m_lruTail == ResourceIndex::NONE)
+			m_lruTail = slot;
+		m_lruCount++;
+	}
+
+	template <typename T, typename ResT>
+	void ResourceManager<T, ResT>::UnlinkLru(std::uint32_t slot)
+	{
+		Slot & ref = m_vSlots[slot];
+		if (!ref.inLru)
+			return;
+
+		if (ref.lruPrev != ResourceIndex::NONE)
+			m_vSlots[ref.lruPrev].lruNext = ref.lruNext;
+		else
+			m_lruHead = ref.lruNext;
+
+		if (ref.lruNext != ResourceIndex::NONE)
+			m_vSlots[ref.lruNext].lruPrev = ref.lruPrev;
+		else
+			m_lruTail = ref.lruPrev;
+
+		ref.inLru = false;
+		ref.lruPrev = ResourceIndex::NONE;
+		ref.lruNext = ResourceIndex::NONE;
+		m_lruCount--;
+	}
+
+	template <typename T, typename ResT>
+	void ResourceManager<T, ResT>::EvictOverBudget()
+	{
+		if (m_memoryBudget == 0)
+			return;
+
+		while (m_memoryUsage > m_memoryBudget && m_lruTail != ResourceIndex::NONE)
+		{
+			const std::uint32_t slot = m_lruTail;
+			BH3D_LOGGER("Resource evicted : " << m_vSlots[slot].name << " (" << m_vSlots[slot].byteSize << " bytes, " << m_name << ")");
+			m_vEvicted.push_back(std::move(m_vSlots[slot].resource));	//freed by FreeEvicted on the OpenGL thread
+			EraseSlot(slot, false);
+		}
+	}
+
+	template <typename T, typename ResT>
+	std::size_t ResourceManager<T, ResT>::FreeEvicted()
+	{
+		std::vector<ResT> vEvicted;
+		{
+			std::unique_lock<std::shared_mutex> lock(m_mutex);
+			if (m_vEvicted.empty())
+				return 0;
+			vEvicted.swap(m_vEvicted);
+		}
+
+		for (auto & resource : vEvicted)
+			FreeResource(resource);
+		return vEvicted.size();
+	}
+
+	template <typename T, typename ResT>
+	void ResourceManager<T, ResT>::SetMemoryBudget(std::size_t byteBudget)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+		m_memoryBudget = byteBudget;
+		EvictOverBudget();
+	}
+
+	template <typename T, typename ResT>
+	std::size_t ResourceManager<T, ResT>::GetMemoryUsage() const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		return m_memoryUsage;
+	}
+
+	template <typename T, typename ResT>
+	std::size_t ResourceManager<T, ResT>::GetEvictableCount() const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		return m_lruCount;
+	}
+
+	template <typename T, typename ResT>
+	void ResourceManager<T, ResT>::UpdateResourceByteSize(std::string_view resource_name)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+		const std::uint32_t slot = FindSlot(resource_name);
+		if (slot == ResourceIndex::NONE)
+			return;
+
+		Slot & ref = m_vSlots[slot];
+		m_memoryUsage -= ref.byteSize;
+		ref.byteSize = GetResourceByteSize(ref.resource);
+		m_memoryUsage += ref.byteSize;
+
+		EvictOverBudget();
+	}
+
+	template <typename T, typename ResT>
+	bool ResourceManager<T, ResT>::Find(std::string_view resource_name, ResT & resource) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+		const std::uint32_t slot = FindSlot(resource_name);
+		if (slot == ResourceIndex::NONE)
+			return false;
+
+		resource = m_vSlots[slot].resource;
+		return true;
+	}
+
+	template <typename T, typename ResT>
+	ResourceHandle ResourceManager<T, ResT>::GetHandle(std::string_view resource_name) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+		const std::uint32_t slot = FindSlot(resource_name);
+		if (slot == ResourceIndex::NONE)
+			return {};
+
+		return { slot, m_vSlots[slot].generation };
+	}
+
+	template <typename T, typename ResT>
+	ResT ResourceManager<T, ResT>::Get(ResourceHandle handle)
+	{
+		{
+			std::shared_lock<std::shared_mutex> lock(m_mutex);
+			if (IsValidHandle(handle))
+				return m_vSlots[handle.index].resource;
+		}
+		return GetDefaultResouce();
+	}
+
+	template <typename T, typename ResT>
+	bool ResourceManager<T, ResT>::IsValid(ResourceHandle handle) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		return IsValidHandle(handle);
+	}
 
 	template <typename T, typename ResT>
 	inline std::size_t ResourceManager<T, ResT>::Size() const
 	{
-		return m_mapResources.size();
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		return m_size;
 	}
 
 	template <typename T, typename ResT>
 	void ResourceManager<T, ResT>::GetResourceList(std::string & list, const std::string & splitter) const
 	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+
 		std::size_t fullsize = 0;
-		for (auto & res : m_mapResources) {
-			fullsize += res.first.size();
+		for (auto & slot : m_vSlots) {
+			if (slot.used)
+				fullsize += slot.name.size() + splitter.size();
 		}
-		fullsize += splitter.size() * m_mapResources.size();
 
 		list.reserve(fullsize);
-		for (auto & res : m_mapResources) {
-			list += splitter + res.first;
+		for (auto & slot : m_vSlots) {
+			if (slot.used)
+				list += splitter + slot.name;
 		}
 	}
 
+	template <typename T, typename ResT>
+	void ResourceManager<T, ResT>::EraseSlot(std::uint32_t slot, bool free)
+	{
+		Slot & ref = m_vSlots[slot];
+		assert(ref.used);
+
+		if (free)
+			FreeResource(ref.resource);
+		UnlinkLru(slot);
+		m_memoryUsage -= ref.byteSize;
+		ref.byteSize = 0;
+		ref.refCount = 0;
+		ref.pinned = false;
+		m_nameIndex.Remove(ref.hash, slot);
+		if constexpr (HasResourceKey<ResT>::value)
+			m_keyIndex.Remove(ref.key, slot);
+
+		ref.used = false;
+		ref.generation++;		//the handles of the slot are out of date
+		ref.name.clear();
+		ref.resource = ResT();
+		m_vFreeSlots.push_back(slot);
+		m_size--;
+	}
+
 	template <typename T, typename ResT>
 	bool ResourceManager<T, ResT>::Erase(const std::string & resource_name)
 	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
 
-		if (auto it = m_mapResources.find(resource_name); it != m_mapResources.end())
+		if (std::uint32_t slot = FindSlot(resource_name); slot != ResourceIndex::NONE)
 		{
-			FreeResource(it->second);
-			m_mapResources.erase(it);
+			EraseSlot(slot);
 			BH3D_LOGGER("Resource deleted : " << resource_name);
 			return true;
 		}
@@ -258,22 +864,50 @@ namespace bh3d
 		return false;
 	}
 
+	template <typename T, typename ResT>
+	bool ResourceManager<T, ResT>::Erase(ResourceHandle handle)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+		if (IsValidHandle(handle))
+		{
+			BH3D_LOGGER("Resource deleted : " << m_vSlots[handle.index].name);
+			EraseSlot(handle.index);
+			return true;
+		}
+
+		BH3D_LOGGER_WARNING("Can't delete the resource of an out of date handle");
+		return false;
+	}
+
 	template <typename T, typename ResT>
 	bool ResourceManager<T, ResT>::Erase(ResT * resource)
 	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
 
-		for (auto & res : m_mapResources)
+		std::uint32_t slot = ResourceIndex::NONE;
+		if constexpr (HasResourceKey<ResT>::value)
+		{
+			slot = m_keyIndex.Find(ResourceKey<ResT>::Get(*resource), [](std::uint32_t) { return true; });
+		}
+		else
 		{
-			if (res.second == *resource)
+			for (std::uint32_t i = 0; i < (std::uint32_t)m_vSlots.size() && slot == ResourceIndex::NONE; i++)
 			{
-				std::string file = res.first;
-				FreeResource(*resource);
-				m_mapResources.erase(res.first);
-				BH3D_LOGGER("Resource deleted : " << file);
-				return true;
+				if (m_vSlots[i].used && m_vSlots[i].resource == *resource)
+					slot = i;
 			}
 		}
 
+		if (slot != ResourceIndex::NONE)
+		{
+			std::string file = m_vSlots[slot].name;
+			FreeResource(*resource);
+			EraseSlot(slot, false);		//already freed by its copy
+			BH3D_LOGGER("Resource deleted : " << file);
+			return true;
+		}
+
 		BH3D_LOGGER_WARNING("Can't delete the unknown resource (by ptr/ref) : " << resource);
 
 		return false;
@@ -288,12 +922,42 @@ namespace bh3d
 	template <typename T, typename ResT>
 	void ResourceManager<T, ResT>::Clear()
 	{
-		for (auto & res : m_mapResources)
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+		for (auto & slot : m_vSlots)
 		{
-			FreeResource(res.second);
-			BH3D_LOGGER("Resource deleted : " << res.first);
+			if (!slot.used)
+				continue;
+			FreeResource(slot.resource);
+			BH3D_LOGGER("Resource deleted : " << slot.name);
+			slot.used = false;
+			slot.generation++;
+			slot.pinned = false;
+			slot.refCount = 0;
+			slot.byteSize = 0;
+			slot.inLru = false;
+			slot.lruPrev = slot.lruNext = ResourceIndex::NONE;
 		}
-		m_mapResources.clear();
+
+		//The slots are kept for the generation counters
+		m_vFreeSlots.clear();
+		for (std::uint32_t i = (std::uint32_t)m_vSlots.size(); i > 0; i--)
+		{
+			m_vSlots[i - 1].name.clear();
+			m_vSlots[i - 1].resource = ResT();
+			m_vFreeSlots.push_back(i - 1);
+		}
+
+		m_nameIndex.Clear();
+		m_keyIndex.Clear();
+		m_size = 0;
+		m_memoryUsage = 0;
+		m_lruHead = m_lruTail = ResourceIndex::NONE;
+		m_lruCount = 0;
+
+		for (auto & resource : m_vEvicted)
+			FreeResource(resource);
+		m_vEvicted.clear();
 	}
 
 	static std::string AutoName() {
@@ -5,11 +5,16 @@
 
 #include <any>
 #include <type_traits>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 #include "BH3D_Camera.hpp"
 #include "BH3D_Event.hpp"
 #include "BH3D_SDLTextureManager.hpp"
 #include "BH3D_TinyEngine.hpp"
+#include "BH3D_Fps.hpp"
+#include "BH3D_UniformBuffer.hpp"
 
 //Redefine some SDL opengl
 struct SDL_Window;
@@ -34,6 +39,18 @@ namespace bh3d
 		int glMultiSamples = 4;
 	};
 
+	/// <summary>
+	/// Timing of the main loop (see SDLEngine::Run)
+	/// </summary>
+	struct SchedulerInfo
+	{
+		double simulationStep = 1.0 / 60.0;		//! Fixed duration in second of a simulation tick
+		int maxSimulationSteps = 8;				//! Maximum ticks for one frame (the late time is dropped beyond, to avoid a spiral of death)
+		bool uncappedRendering = false;			//! If true, the vsync is disabled and the frames are displayed as fast as possible
+		bool threadedSimulation = false;		//! If true, Simulate is called by a dedicated thread while the GL thread displays the frames
+		std::size_t textureUploadBudget = 4 << 20;	//! Bytes of asynchronously loaded textures uploaded per frame (see TextureManager::LoadAsync)
+	};
+
 	class SDL_Windows_GL_Context
 	{
 	public:
@@ -56,6 +73,7 @@ namespace bh3d
 		using FProcessEvent = std::function<int(const SDL_Event*)>;
 
 		WindowInfo m_windowInfo;
+		SchedulerInfo m_schedulerInfo;
 
 	public:
 
@@ -72,9 +90,39 @@ namespace bh3d
 		// Window events managed by SDL (windows resize, mouse, keyboard....)
 		int PollEvents();
 
-		//Main loop of the opengl application
+		//Main loop of the opengl application.
+		//The simulation is updated with fixed ticks (see Simulate) from an accumulator of the frame times,
+		//and each frame is displayed once with the interpolation factor between the two last ticks (see GetInterpolation)
+		//With SchedulerInfo::threadedSimulation, the ticks run on a simulation thread at their own pace : the simulation
+		//has to hand its state to Display through a lock-free snapshot (see TripleBuffer) and never call OpenGL.
 		virtual void Run();
 
+		//Fixed step simulation tick, called 0 to maxSimulationSteps times per frame by Run (or by the simulation thread)
+		virtual void Simulate(float /*step*/) {}
+
+		//Time in second of the tick computed by Simulate (to call from Simulate, and to store in the published snapshot)
+		inline double GetSimulationTime() const { return m_simulationTime; }
+
+		//Position of the displayed frame between the two last simulation ticks, in [0, 1[ (single thread mode)
+		inline float GetInterpolation() const { return m_interpolation; }
+
+		//Interpolation factor between a snapshot computed at tickTime (see GetSimulationTime) and the next one, in [0, 1]
+		inline float GetInterpolation(double tickTime) const {
+			return (float)std::clamp((m_renderTime - tickTime) / m_schedulerInfo.simulationStep, 0.0, 1.0);
+		}
+
+		//Number of simulation ticks done during the last frame
+		inline int GetSimulationSteps() const { return m_simulationSteps; }
+
+		//Frame timing (frame per second and duration of the last frame)
+		inline const Fps & GetFps() const { return m_fps; }
+
+		//Camera and time of the displayed frame, uploaded in the frame uniform block by UpdateFrameUniforms (see BH3D_FRAME_UNIFORM_BLOCK_GLSL)
+		inline const FrameUniforms & GetFrameUniforms() const { return m_frameUniforms; }
+
+		//Disable the vsync to measure the render throughput, the simulation keeps its fixed step
+		void SetUncappedRendering(bool uncapped);
+
 		// Call when the windows is resized
 		virtual void Resize();
 
@@ -114,11 +162,29 @@ namespace bh3d
 
 	protected:
 
+		//Upload the camera matrices and the time of the frame in the frame uniform buffer.
+		//To call in Display once the camera is updated, before drawing the shaders declaring the frame uniform block
+		void UpdateFrameUniforms();
+
 		Mouse m_mouse;
+		Fps m_fps;
+		float m_interpolation = 0.0f;
+		int m_simulationSteps = 0;
+		double m_simulationTime = 0.0;		//! Time of the last tick (simulation side)
+		double m_renderTime = 0.0;			//! Time of the displayed frame (display side)
 		FProcessEvent m_FProcessEvent; 	//! if valid, the function is called inside the internal loop of PollEvent. Break the event loop in the PollEvents function if the return value of the function differs from BH3D_OK
 
 	private:
 
+		//Main loop with a simulation thread
+		void RunThreaded();
+
+		FrameUniforms m_frameUniforms;
+		UniformBuffer m_frameUniformBuffer;		//! shared by all the programs declaring the frame uniform block
+
+		std::atomic<bool> m_simulationRunning = { false };
+		std::atomic<int> m_simulationTicks = { 0 };		//! Ticks done by the simulation thread since the last frame
+
 		SDL_Windows_GL_Context m_SDL_Windows_GL_Context;
 		SDLTextureManager m_textureManager;
 
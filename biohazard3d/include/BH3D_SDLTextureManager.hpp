@@ -55,6 +55,17 @@ namespace bh3d
 				return TextureManager::Load(pathname, resource_name);
 			}
 
+			/// <summary>
+			/// Load several images in a texture array using SDL to read the images.
+			/// The layers are rescaled to the size of the first image.
+			/// </summary>
+			/// <param name="vPathnames">Image path names (one per layer)</param>
+			/// <param name="resource_name">resouce name. If empty, the concatenation of the image paths is used as resource name</param>
+			/// <returns>OpenGL Texture (GL_TEXTURE_2D_ARRAY)</returns>
+			Texture LoadArray(const std::vector<std::filesystem::path> & vPathnames, const std::string & resource_name = {}) {
+				return TextureManager::LoadArray(vPathnames, resource_name);
+			}
+
 	private:
 
 		/// <summary>
@@ -65,6 +76,30 @@ namespace bh3d
 		/// <returns>if it's ok ?</returns>
 		bool LoadResourceFromFile(const std::filesystem::path & pathname, Texture& texture) override;
 
+		/// <summary>
+		/// Load a Texture array from a list of path names using SDL to read the images (used by TextureManager::LoadArray(vPathnames, resource_name));
+		/// </summary>
+		/// <param name="vPathnames">Image paths</param>
+		/// <param name="texture"> Texture reference to fill </param>
+		/// <returns>if it's ok ?</returns>
+		bool LoadArrayResourceFromFiles(const std::vector<std::filesystem::path> & vPathnames, Texture& texture) override;
+
+		/// <summary>
+		/// Decode an image file in CPU memory using SDL (used by the asynchronous loads, thread safe)
+		/// </summary>
+		/// <param name="pathname">Image path</param>
+		/// <param name="image">RGBA image to fill</param>
+		/// <returns>if it's ok ?</returns>
+		bool DecodeResourceFromFile(const std::filesystem::path & pathname, TextureImage & image) override;
+
+		/// <summary>
+		/// Decode several image files in the layers of a CPU image using SDL, rescaled to the first image size (thread safe)
+		/// </summary>
+		/// <param name="vPathnames">Image paths</param>
+		/// <param name="image">RGBA image to fill (one layer per path)</param>
+		/// <returns>if it's ok ?</returns>
+		bool DecodeArrayResourceFromFiles(const std::vector<std::filesystem::path> & vPathnames, TextureImage & image) override;
+
 
 	};
 
@@ -30,6 +30,8 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <memory>
+#include <string_view>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -38,6 +40,8 @@
 
 #include "BH3D_Common.hpp"
 #include "BH3D_File.hpp"
+#include "BH3D_ProgramCache.hpp"
+#include "BH3D_Hash.hpp"
 
 namespace bh3d
 {
@@ -56,6 +60,15 @@ namespace bh3d
 		N_NUMBER
 	};
 
+	//Biohazard3d default attribute index used for per instance data (with glVertexAttribDivisor), placed after the ATTRIB_INDEX range
+	enum class INSTANCE_ATTRIB_INDEX : GLuint
+	{
+		TRANSFORM = (GLuint)ATTRIB_INDEX::N_NUMBER,	//9 (mat4 : 9, 10, 11, 12)
+		DATA0 = TRANSFORM + 4,						//13
+		POSITION,									//14 (translation only instance)
+		N_NUMBER
+	};
+
 	//Biohazard3d default attribute names used in shader
 	#define BH3D_ATTRIB_NAME_LIST	\
 		"in_Position"				\
@@ -148,6 +161,28 @@ namespace bh3d
 		/// <returns></returns>
 		int LoadRaw(const void * vertexRaw, const void * fragmentRaw);
 
+		/// <summary>
+		/// Compile again the files of Load and relink the program in place (hot reload) : the program id doesn't change.
+		/// If the new sources don't compile or link, the current program is kept.
+		/// </summary>
+		/// <returns>It's ok ?</returns>
+		int Reload();
+
+		/// <summary>
+		/// If the shader is loaded from this file (see Load)
+		/// </summary>
+		/// <param name="pathname">Source file path</param>
+		/// <returns>True if the file is the vertex or fragment source</returns>
+		bool UsesFile(const std::filesystem::path & pathname) const;
+
+		/// <summary>
+		/// Reload in place every shader using this source file (see UsesFile and Reload), e.g. from a FileWatcher callback.
+		/// A shader whose first load failed is loaded again. To call on the OpenGL thread.
+		/// </summary>
+		/// <param name="pathname">Changed source file</param>
+		/// <returns>Number of shaders reloaded</returns>
+		static std::size_t ReloadFile(const std::filesystem::path & pathname);
+
 		/// <summary>
 		/// Bind the shader
 		/// </summary>
@@ -167,6 +202,27 @@ namespace bh3d
 
 		virtual void DefaultUniformLocation();
 
+		/// <summary>
+		/// Active uniform of the program (reflected once after the link, see GetUniformLocation)
+		/// </summary>
+		struct Uniform
+		{
+			std::string name;		//without the [0] of the arrays
+			GLint location = -1;
+			GLenum type = 0;
+			GLint size = 0;			//array size
+		};
+
+		/// <summary>
+		/// Location of an active uniform, from the reflected uniform table (no OpenGL call, except for an array element other than [0])
+		/// </summary>
+		/// <param name="name">Uniform name</param>
+		/// <returns>Uniform location, -1 if the uniform isn't active</returns>
+		GLint GetUniformLocation(std::string_view name) const;
+
+		//Active uniforms of the program (the members of the uniform blocks are not listed)
+		inline const std::vector<Uniform> & GetUniforms() const { return m_vUniforms; }
+
 		/// <summary>
 		/// If the shader is valid
 		/// </summary>
@@ -187,6 +243,7 @@ namespace bh3d
 
 
 		//Fonction d'envoie uniform
+		//The names are resolved with the reflected uniform table (see GetUniformLocation), the location versions skip the lookup
 		//-----------------------------------------------------------------------------
 		// Matrice sp�cifique
 		//----------------------------------------------------------------------------
@@ -199,56 +256,71 @@ namespace bh3d
 		// Send1i/Send1f
 		//-----------------------------------------------------------------------------
 		inline void Send1i(const GLchar* name, int a) const;
+		inline void Send1i(GLint location, int a) const;
 		inline void Send1f(const GLchar* name, float a) const;
+		inline void Send1f(GLint location, float a) const;
 
 		//-----------------------------------------------------------------------------
 		// Send2i/Send2f
 		//-----------------------------------------------------------------------------
 		inline void Send2i(const GLchar* name, int a, int b) const;
+		inline void Send2i(GLint location, int a, int b) const;
 		inline void Send2f(const GLchar* name, float a, float b) const;
+		inline void Send2f(GLint location, float a, float b) const;
 
 		//-----------------------------------------------------------------------------
 		// Send3i/Send3f
 		//-----------------------------------------------------------------------------
 		inline void Send3i(const GLchar* name, int a, int b, int c) const;
+		inline void Send3i(GLint location, int a, int b, int c) const;
 		inline void Send3f(const GLchar* name, float a, float b, float c) const;
+		inline void Send3f(GLint location, float a, float b, float c) const;
 
 		//-----------------------------------------------------------------------------
 		// Send4i/Send4f
 		//-----------------------------------------------------------------------------
 		inline void Send4i(const GLchar* name, int a, int b, int c, int d) const;
+		inline void Send4i(GLint location, int a, int b, int c, int d) const;
 		inline void Send4f(const GLchar* name, float a, float b, float c, float d) const;
-
+		inline void Send4f(GLint location, float a, float b, float c, float d) const;
 
 		//-----------------------------------------------------------------------------
-		// Sendmat4i/Sendmat4i
+		// SendMat4f
 		//-----------------------------------------------------------------------------
 		inline void SendMat4f(const GLchar* name, GLboolean transpose, const GLfloat *value) const;
-
+		inline void SendMat4f(GLint location, GLboolean transpose, const GLfloat *value) const;
 
 		//-----------------------------------------------------------------------------
 		// Send2i/Send2f
 		//-----------------------------------------------------------------------------
 		inline void Send2i(const GLchar* name, const glm::ivec2 &v) const;
+		inline void Send2i(GLint location, const glm::ivec2 &v) const;
 		inline void Send2f(const GLchar* name, const glm::vec2 &v) const;
+		inline void Send2f(GLint location, const glm::vec2 &v) const;
 
 		//-----------------------------------------------------------------------------
 		// Send3i/Send3f
 		//-----------------------------------------------------------------------------
 		inline void Send3i(const GLchar* name, const glm::ivec3 &v) const;
+		inline void Send3i(GLint location, const glm::ivec3 &v) const;
 		inline void Send3f(const GLchar* name, const glm::vec3 &v) const;
+		inline void Send3f(GLint location, const glm::vec3 &v) const;
 
 		//-----------------------------------------------------------------------------
 		// Send4i/Send4f
 		//-----------------------------------------------------------------------------
 		inline void Send4i(const GLchar* name, const glm::ivec4 &v) const;
+		inline void Send4i(GLint location, const glm::ivec4 &v) const;
 		inline void Send4f(const GLchar* name, const glm::vec4 &v) const;
+		inline void Send4f(GLint location, const glm::vec4 &v) const;
 
 		//-----------------------------------------------------------------------------
 		// SendMat4f
 		//-----------------------------------------------------------------------------
 		inline void SendMat4f(const GLchar* name, GLboolean transpose, const glm::mat4& m) const;
+		inline void SendMat4f(GLint location, GLboolean transpose, const glm::mat4& m) const;
 		inline void SendMat4f(const GLchar* name, GLboolean transpose, const std::vector<glm::mat4> & m) const;
+		inline void SendMat4f(GLint location, GLboolean transpose, const std::vector<glm::mat4> & m) const;
 
 
 	public:
@@ -277,16 +349,26 @@ namespace bh3d
 			SendTransform(transform);
 		}
 
-	private:
+		/// <summary>
+		/// Disk cache of the linked programs used by the next loads (nullptr to disable it, see ProgramCache)
+		/// </summary>
+		static inline void SetProgramCache(std::shared_ptr<ProgramCache> cache) { s_programCache = std::move(cache); }
+		static inline const std::shared_ptr<ProgramCache> & GetProgramCache() { return s_programCache; }
 
-		int LoadTypeShader(GLuint &shader, GLenum type, const File & source);
+	private:
 
 		int LoadTypeShader(GLuint &shader, GLenum type, const void* raw);
 
 		int LinkProgramShader();
 
-		template <typename T>
-		inline int LoadT(T vertex, T fragment);
+		//Program from the vertex and fragment sources (program binary cache, else compilation and link)
+		int LoadSources(const GLchar * vertexSource, const GLchar * fragmentSource);
+
+		//Key of the program in the program cache (sources and attribute bindings)
+		std::string GetProgramKey(const GLchar * vertexSource, const GLchar * fragmentSource) const;
+
+		//Fill the uniform table of the linked program and bind the frame uniform block (see FrameUniforms)
+		void ReflectUniforms();
 
 		void Destroy();
 
@@ -300,33 +382,25 @@ namespace bh3d
 		GLuint m_vertexID = 0;
 		GLuint m_fragmentID = 0;
 
+		//Source files (empty for raw sources), see Reload
+		File m_vertexFile;
+		File m_fragmentFile;
+
+		//Reflected uniforms : flat hash of the names -> m_vUniforms
+		std::vector<Uniform> m_vUniforms;
+		ResourceIndex m_uniformIndex;
+
+		//Add the shader to the shaders loaded from files if it has source files, else remove it (see ReloadFile)
+		void TrackSourceFiles(bool track);
+
 		inline static const Shader *s_bindedShader = nullptr;
+		inline static std::shared_ptr<ProgramCache> s_programCache;
+		inline static std::vector<Shader *> s_vFileShaders;		//shaders loaded from files, see ReloadFile
 
 	};
 
 	//inline fonction
 	//--------------------------------------
-	template <typename T>
-	inline int Shader::LoadT(T vertexSource, T fragmentSource)
-	{
-
-		this->Destroy();
-		
-		if (LoadTypeShader(m_vertexID, GL_VERTEX_SHADER, vertexSource) == BH3D_ERROR) {
-			return BH3D_ERROR;
-		}
-
-		if (LoadTypeShader(m_fragmentID, GL_FRAGMENT_SHADER, fragmentSource) == BH3D_ERROR) {
-			return BH3D_ERROR;
-		}
-
-		LinkProgramShader();
-
-		DefaultUniformLocation();
-
-		return BH3D_OK;
-	}
-
 	inline void Shader::Enable() const
 	{
 		assert(m_programID > 0 && "Can't Enable the shader (invalid ID)");
@@ -418,7 +492,7 @@ namespace bh3d
 
 #undef assert_default_uniform
 
-#define assert_uniform_location() assert(glGetUniformLocation(m_programID, name) != -1 && "Call DefaultUniformLocation function before sending data to the shader")
+#define assert_uniform_location() assert(GetUniformLocation(name) != -1 && "Unknown uniform (not active in the program)")
 
 	//-----------------------------------------------------------------------------
 	// Send1i/Send1f
@@ -426,12 +500,20 @@ namespace bh3d
 	inline void Shader::Send1i(const GLchar* name, int a) const
 	{
 		assert_uniform_location();
-		glUniform1i(glGetUniformLocation(m_programID, name), a);
+		Send1i(GetUniformLocation(name), a);
+	}
+	inline void Shader::Send1i(GLint location, int a) const
+	{
+		glUniform1i(location, a);
 	}
 	inline void Shader::Send1f(const GLchar* name, float a) const
 	{
 		assert_uniform_location();
-		glUniform1f(glGetUniformLocation(m_programID, name), a);
+		Send1f(GetUniformLocation(name), a);
+	}
+	inline void Shader::Send1f(GLint location, float a) const
+	{
+		glUniform1f(location, a);
 	}
 
 	//-----------------------------------------------------------------------------
@@ -440,27 +522,42 @@ namespace bh3d
 	inline void Shader::Send2i(const GLchar* name, int a, int b) const
 	{
 		assert_uniform_location();
-		glUniform2i(glGetUniformLocation(m_programID, name), a, b);
+		Send2i(GetUniformLocation(name), a, b);
+	}
+	inline void Shader::Send2i(GLint location, int a, int b) const
+	{
+		glUniform2i(location, a, b);
 	}
 	inline void Shader::Send2f(const GLchar* name, float a, float b) const
 	{
 		assert_uniform_location();
-		glUniform2f(glGetUniformLocation(m_programID, name), a, b);
+		Send2f(GetUniformLocation(name), a, b);
+	}
+	inline void Shader::Send2f(GLint location, float a, float b) const
+	{
+		glUniform2f(location, a, b);
 	}
 
 	//-----------------------------------------------------------------------------
 	// Send3i/Send3f
 	//-----------------------------------------------------------------------------
-	inline void Shader::Send3i(const GLchar*name, int a, int b, int c) const
+	inline void Shader::Send3i(const GLchar* name, int a, int b, int c) const
 	{
 		assert_uniform_location();
-		glUniform3i(glGetUniformLocation(m_programID, name), a, b, c);
+		Send3i(GetUniformLocation(name), a, b, c);
+	}
+	inline void Shader::Send3i(GLint location, int a, int b, int c) const
+	{
+		glUniform3i(location, a, b, c);
 	}
-
 	inline void Shader::Send3f(const GLchar* name, float a, float b, float c) const
 	{
 		assert_uniform_location();
-		glUniform3f(glGetUniformLocation(m_programID, name), a, b, c);
+		Send3f(GetUniformLocation(name), a, b, c);
+	}
+	inline void Shader::Send3f(GLint location, float a, float b, float c) const
+	{
+		glUniform3f(location, a, b, c);
 	}
 
 	//-----------------------------------------------------------------------------
@@ -469,29 +566,34 @@ namespace bh3d
 	inline void Shader::Send4i(const GLchar* name, int a, int b, int c, int d) const
 	{
 		assert_uniform_location();
-		glUniform4i(glGetUniformLocation(m_programID, name), a, b, c, d);
+		Send4i(GetUniformLocation(name), a, b, c, d);
+	}
+	inline void Shader::Send4i(GLint location, int a, int b, int c, int d) const
+	{
+		glUniform4i(location, a, b, c, d);
 	}
 	inline void Shader::Send4f(const GLchar* name, float a, float b, float c, float d) const
 	{
 		assert_uniform_location();
-		glUniform4f(glGetUniformLocation(m_programID, name), a, b, c, d);
+		Send4f(GetUniformLocation(name), a, b, c, d);
+	}
+	inline void Shader::Send4f(GLint location, float a, float b, float c, float d) const
+	{
+		glUniform4f(location, a, b, c, d);
 	}
+
 	//-----------------------------------------------------------------------------
 	// SendMat4f
 	//-----------------------------------------------------------------------------
 	inline void Shader::SendMat4f(const GLchar* name, GLboolean transpose, const GLfloat *value) const
 	{
 		assert_uniform_location();
-		glUniformMatrix4fv
-			(
-				glGetUniformLocation(m_programID, name),
-				1,
-				transpose,
-				value
-				);
-
+		SendMat4f(GetUniformLocation(name), transpose, value);
+	}
+	inline void Shader::SendMat4f(GLint location, GLboolean transpose, const GLfloat *value) const
+	{
+		glUniformMatrix4fv(location, 1, transpose, value);
 	}
-
 
 	//-----------------------------------------------------------------------------
 	// Send2i/Send2f
@@ -499,12 +601,20 @@ namespace bh3d
 	inline void Shader::Send2i(const GLchar* name, const glm::ivec2 &v) const
 	{
 		assert_uniform_location();
-		glUniform2iv(glGetUniformLocation(m_programID, name), 1, &v[0]);
+		Send2i(GetUniformLocation(name), v);
+	}
+	inline void Shader::Send2i(GLint location, const glm::ivec2 &v) const
+	{
+		glUniform2iv(location, 1, &v[0]);
 	}
 	inline void Shader::Send2f(const GLchar* name, const glm::vec2 &v) const
 	{
 		assert_uniform_location();
-		glUniform2fv(glGetUniformLocation(m_programID, name), 1, &v[0]);
+		Send2f(GetUniformLocation(name), v);
+	}
+	inline void Shader::Send2f(GLint location, const glm::vec2 &v) const
+	{
+		glUniform2fv(location, 1, &v[0]);
 	}
 
 	//-----------------------------------------------------------------------------
@@ -513,12 +623,20 @@ namespace bh3d
 	inline void Shader::Send3i(const GLchar* name, const glm::ivec3 &v) const
 	{
 		assert_uniform_location();
-		glUniform3iv(glGetUniformLocation(m_programID, name), 1, &v[0]);
+		Send3i(GetUniformLocation(name), v);
+	}
+	inline void Shader::Send3i(GLint location, const glm::ivec3 &v) const
+	{
+		glUniform3iv(location, 1, &v[0]);
 	}
 	inline void Shader::Send3f(const GLchar* name, const glm::vec3 &v) const
 	{
 		assert_uniform_location();
-		glUniform3fv(glGetUniformLocation(m_programID, name), 1, &v[0]);
+		Send3f(GetUniformLocation(name), v);
+	}
+	inline void Shader::Send3f(GLint location, const glm::vec3 &v) const
+	{
+		glUniform3fv(location, 1, &v[0]);
 	}
 
 	//-----------------------------------------------------------------------------
@@ -527,12 +645,20 @@ namespace bh3d
 	inline void Shader::Send4i(const GLchar* name, const glm::ivec4 &v) const
 	{
 		assert_uniform_location();
-		glUniform4iv(glGetUniformLocation(m_programID, name), 1, &v[0]);
+		Send4i(GetUniformLocation(name), v);
+	}
+	inline void Shader::Send4i(GLint location, const glm::ivec4 &v) const
+	{
+		glUniform4iv(location, 1, &v[0]);
 	}
 	inline void Shader::Send4f(const GLchar* name, const glm::vec4 &v) const
 	{
 		assert_uniform_location();
-		glUniform4fv(glGetUniformLocation(m_programID, name), 1, &v[0]);
+		Send4f(GetUniformLocation(name), v);
+	}
+	inline void Shader::Send4f(GLint location, const glm::vec4 &v) const
+	{
+		glUniform4fv(location, 1, &v[0]);
 	}
 
 	//-----------------------------------------------------------------------------
@@ -541,23 +667,20 @@ namespace bh3d
 	inline void Shader::SendMat4f(const GLchar* name, GLboolean transpose, const glm::mat4& m) const
 	{
 		assert_uniform_location();
-		glUniformMatrix4fv
-			(
-				glGetUniformLocation(m_programID, name),
-				1,
-				transpose,
-				glm::value_ptr(m)
-				);
-
+		SendMat4f(GetUniformLocation(name), transpose, m);
+	}
+	inline void Shader::SendMat4f(GLint location, GLboolean transpose, const glm::mat4& m) const
+	{
+		glUniformMatrix4fv(location, 1, transpose, glm::value_ptr(m));
 	}
-	//-----------------------------------------------------------------------------
-	// SendMat4fv
-	//----------------------------------------------------------------------------
 	inline void Shader::SendMat4f(const GLchar* name, GLboolean transpose, const std::vector<glm::mat4> & m) const
 	{
 		assert_uniform_location();
-		int id = glGetUniformLocation(m_programID, name);
-		glUniformMatrix4fv(id, (GLsizei) m.size(), transpose, glm::value_ptr(m[0]));
+		SendMat4f(GetUniformLocation(name), transpose, m);
+	}
+	inline void Shader::SendMat4f(GLint location, GLboolean transpose, const std::vector<glm::mat4> & m) const
+	{
+		glUniformMatrix4fv(location, (GLsizei) m.size(), transpose, glm::value_ptr(m[0]));
 	}
 
 #undef assert_uniform_location
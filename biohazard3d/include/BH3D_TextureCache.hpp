@@ -0,0 +1,133 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef _BH3D_TEXTURE_CACHE_H_
+#define _BH3D_TEXTURE_CACHE_H_
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <filesystem>
+
+#include <glad/glad.h>
+
+#include "BH3D_Texture.hpp"
+
+namespace bh3d
+{
+	/// <summary>
+	/// Format of the mip chain stored in the cache
+	/// </summary>
+	enum class TextureCacheFormat
+	{
+		RGBA8,		//uncompressed
+		BPTC		//GL_COMPRESSED_RGBA_BPTC_UNORM (BC7), compressed by the driver at the first load
+	};
+
+	/// <summary>
+	/// Mip chain of a texture, ready to be uploaded level by level (without decoding nor mipmap generation)
+	/// </summary>
+	struct CachedTexture
+	{
+		struct Level
+		{
+			GLsizei width = 0;
+			GLsizei height = 0;
+			const unsigned char * data = nullptr;		//all the layers of the level
+			std::size_t byteSize = 0;
+		};
+
+		GLsizei width = 0;
+		GLsizei height = 0;
+		GLsizei layers = 0;					//0 : GL_TEXTURE_2D, else GL_TEXTURE_2D_ARRAY
+		GLenum internalFormat = GL_RGBA8;
+		GLenum format = GL_RGBA;			//0 if compressed
+		GLenum type = GL_UNSIGNED_BYTE;		//0 if compressed
+		std::vector<Level> levels;
+		std::shared_ptr<const void> storage;	//keeps the level memory alive (file mapping or read back buffer)
+
+		inline bool IsCompressed() const { return type == 0; }
+		inline GLenum GetTarget() const { return layers > 0 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D; }
+	};
+
+	/// <summary>
+	/// Disk cache of texture mip chains stored in KTX 1.1 files.
+	/// A file is keyed by the paths, the modification times and the sizes of the source images : an edited image is decoded again.
+	/// The cached files are memory mapped and their levels are uploaded directly.
+	/// </summary>
+	class TextureCache
+	{
+	public:
+
+		TextureCache(const std::filesystem::path & directory, TextureCacheFormat format = TextureCacheFormat::RGBA8) :
+			m_directory(directory),
+			m_format(format)
+		{}
+
+		inline const std::filesystem::path & GetDirectory() const { return m_directory; }
+		inline TextureCacheFormat GetFormat() const { return m_format; }
+
+		/// <summary>
+		/// Map the cached mip chain of the source images (no OpenGL call, thread safe)
+		/// </summary>
+		/// <param name="vSources">Source image paths (one per layer for a texture array)</param>
+		/// <param name="cached">Mip chain to fill</param>
+		/// <returns>false if the cache is missing or out of date</returns>
+		bool Load(const std::vector<std::filesystem::path> & vSources, CachedTexture & cached) const;
+
+		/// <summary>
+		/// Write a mip chain in the cache (no OpenGL call, thread safe)
+		/// </summary>
+		/// <param name="vSources">Source image paths</param>
+		/// <param name="cached">Mip chain to store</param>
+		/// <returns>if it's ok ?</returns>
+		bool Store(const std::vector<std::filesystem::path> & vSources, const CachedTexture & cached) const;
+
+		/// <summary>
+		/// Read back the mip chain of a texture in the cache format (OpenGL thread). 
+		/// With a compressed format, the levels are compressed by the driver in a temporary texture.
+		/// </summary>
+		/// <param name="texture">Texture (GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY) with its mipmaps</param>
+		/// <param name="cached">Mip chain to fill</param>
+		/// <returns>if it's ok ?</returns>
+		bool Capture(const Texture & texture, CachedTexture & cached) const;
+
+		/// <summary>
+		/// Cache file of the source images
+		/// </summary>
+		std::filesystem::path GetCachePath(const std::vector<std::filesystem::path> & vSources) const;
+
+	private:
+
+		//Identification of the source images (paths, modification times and sizes) and of the cache format
+		std::string GetSourceKey(const std::vector<std::filesystem::path> & vSources) const;
+
+		std::filesystem::path m_directory;
+		TextureCacheFormat m_format = TextureCacheFormat::RGBA8;
+	};
+}
+
+#endif //_BH3D_TEXTURE_CACHE_H_
@@ -27,16 +27,55 @@
 #ifndef _BH3D_TEXTURE_MANAGER_H_
 #define _BH3D_TEXTURE_MANAGER_H_
 
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <memory>
+
 #include "BH3D_ResourceManager.hpp"
 #include "BH3D_Texture.hpp"
+#include "BH3D_JobSystem.hpp"
+#include "BH3D_PixelBufferRing.hpp"
+#include "BH3D_TextureCache.hpp"
 
 #define BH3D_TextureManagerBind(bind) bh3d::TextureManager::Bind(bind)
 #define BH3D_TextureManager() bh3d::TextureManager::Instance()
 #define BH3D_LoadTexture(msg) bh3d::TextureManager::Instance().Load(msg)
+#define BH3D_LoadTextureArray(msg) bh3d::TextureManager::Instance().LoadArray(msg)
+#define BH3D_LoadTextureAsync(msg) bh3d::TextureManager::Instance().LoadAsync(msg)
+#define BH3D_LoadTextureArrayAsync(msg) bh3d::TextureManager::Instance().LoadArrayAsync(msg)
 
 namespace bh3d
 {
 
+	/// <summary>
+	/// Image decoded in CPU memory, ready to be uploaded in a texture (the layers of an array are consecutive)
+	/// </summary>
+	struct TextureImage
+	{
+		GLsizei width = 0;
+		GLsizei height = 0;
+		GLsizei layers = 1;
+		GLenum format = GL_RGBA;
+		GLenum type = GL_UNSIGNED_BYTE;
+		std::vector<unsigned char> pixels;
+
+		inline std::size_t LayerByteSize() const { return layers > 0 ? pixels.size() / layers : 0; }
+		inline const void * LayerPixels(GLsizei layer) const { return pixels.data() + layer * LayerByteSize(); }
+	};
+
+	/// <summary>
+	/// A texture is identified by its OpenGL id (O(1) Erase by texture)
+	/// </summary>
+	template <>
+	struct ResourceKey<Texture>
+	{
+		static std::uint64_t Get(const Texture & texture) { return texture.GetGLTexture(); }
+	};
+
 	class TextureManager : public ResourceManager<TextureManager ,Texture>
 	{
 		public:
@@ -51,6 +90,8 @@ namespace bh3d
 			TextureManager(bool bind = true) : TextureManager({}, bind) {}
 
 			~TextureManager() override {
+				//The decoding jobs use the manager
+				JobSystem::Default().Wait(m_asyncJobs);
 				Clear();
 			};
 
@@ -60,6 +101,13 @@ namespace bh3d
 			//GL_TEXTURE_2D, GL_TEXTURE_ARRAY_2D, ...
 			inline void SetTextureTarget(GLenum target) { m_textureTarget = target;	};
 
+			//If true (default), the pixels are uploaded through a ring of pixel buffers (see PixelBufferRing), else from the client memory
+			inline void SetPixelBufferUpload(bool enable) { m_usePixelBuffer = enable; };
+
+			//Disk cache of the mip chains of the loaded image files (nullptr to disable it, see TextureCache)
+			inline void SetTextureCache(std::shared_ptr<TextureCache> cache) { m_textureCache = std::move(cache); };
+			inline const std::shared_ptr<TextureCache> & GetTextureCache() const { return m_textureCache; };
+
 			TextureManager(const TextureManager & r) = delete;
 			TextureManager& operator=(const TextureManager & r) = delete;
 
@@ -78,17 +126,161 @@ namespace bh3d
 				return Add(std::move(tex), texture_name);
 			}
 
+			/// <summary>
+			/// Add a texture array (GL_TEXTURE_2D_ARRAY) from raw data. All the layers have the same size and format.
+			/// </summary>
+			/// <param name="width">Layer width</param>
+			/// <param name="height">Layer height</param>
+			/// <param name="format">Opengl format (GL_RED, GL_RG, GL_BGR, GL_BGRA...)</param>
+			/// <param name="type">Opengl Type (GL_UNSIGNED_BYTE,...)</param>
+			/// <param name="vLayerPixels">Raw memory of each layer</param>
+			/// <param name="texture_name">Texture name of identification in the Texturemanager</param>
+			/// <returns>Texture object</returns>
+			Texture AddTextureArrayRGBA(GLsizei width, GLsizei height, GLenum format, GLenum type, const std::vector<const void*> & vLayerPixels, const std::string & texture_name) {
+				Texture tex = CreateTextureArrayRGBA(width, height, format, type, vLayerPixels);
+				return Add(std::move(tex), texture_name);
+			}
+
+			/// <summary>
+			/// Load several images in a texture array (GL_TEXTURE_2D_ARRAY), the layer i is the image vPathnames[i].
+			/// </summary>
+			/// <param name="vPathnames">Image path names</param>
+			/// <param name="resource_name">resouce name. If empty, the concatenation of the image paths is used as resource name</param>
+			/// <returns>OpenGL Texture</returns>
+			Texture LoadArray(const std::vector<std::filesystem::path> & vPathnames, const std::string & resource_name = {});
+
+			/// <summary>
+			/// Replace the pixels of an existing texture without reallocation (streamed images : video frames...).
+			/// The image must have the size of the texture. The mipmaps are regenerated.
+			/// </summary>
+			/// <param name="texture">Texture to update (GL_TEXTURE_2D)</param>
+			/// <param name="width">Image width (texture width)</param>
+			/// <param name="height">Image height (texture height)</param>
+			/// <param name="format">Opengl format (GL_RED, GL_RG, GL_BGR, GL_BGRA...)</param>
+			/// <param name="type">Opengl Type (GL_UNSIGNED_BYTE,...)</param>
+			/// <param name="pixels">Raw memory</param>
+			void UploadTextureRGBA(const Texture & texture, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+
+			/// <summary>
+			/// Asynchronous version of Load. The texture is returned at once with a 1x1 placeholder image (see SetPlaceholderColor),
+			/// the file is decoded by the job system workers, and the image is uploaded in the same OpenGL texture by UploadAsyncTextures.
+			/// All the copies of the returned texture show the image once uploaded.
+			/// </summary>
+			/// <param name="pathname">Image path name</param>
+			/// <param name="resource_name">resouce name. If empty the image path is used as resource name</param>
+			/// <returns>OpenGL Texture (placeholder until the upload)</returns>
+			Texture LoadAsync(const std::filesystem::path & pathname, const std::string & resource_name = {});
+
+			/// <summary>
+			/// Asynchronous version of LoadArray (see LoadAsync). The placeholder has one layer per image.
+			/// </summary>
+			/// <param name="vPathnames">Image path names</param>
+			/// <param name="resource_name">resouce name. If empty, the concatenation of the image paths is used as resource name</param>
+			/// <returns>OpenGL Texture (GL_TEXTURE_2D_ARRAY placeholder until the upload)</returns>
+			Texture LoadArrayAsync(const std::vector<std::filesystem::path> & vPathnames, const std::string & resource_name = {});
+
+			/// <summary>
+			/// Uploads the decoded images of the asynchronous loads (to call from the OpenGL thread, once per frame).
+			/// At least one image is uploaded per call, then the next ones while the budget allows it.
+			/// The textures evicted by the memory budget since the last call are deleted first (see FreeEvicted).
+			/// </summary>
+			/// <param name="byteBudget">Maximum byte size to upload</param>
+			/// <returns>Number of asynchronous loads not yet uploaded</returns>
+			std::size_t UploadAsyncTextures(std::size_t byteBudget);
+
+			/// <summary>
+			/// Reload the textures made from an image file (hot reload, see FileWatcher). The textures keep their OpenGL id :
+			/// the file is decoded by the job system workers and uploaded in place by UploadAsyncTextures.
+			/// </summary>
+			/// <param name="pathname">Changed image file</param>
+			/// <returns>Number of textures to reload</returns>
+			std::size_t Reload(const std::filesystem::path & pathname);
+
+			//Number of asynchronous loads not yet uploaded
+			inline std::size_t GetAsyncPendingCount() const { return m_asyncPending.load(std::memory_order_relaxed); }
+
+			//Color of the placeholder image of the asynchronous loads
+			inline void SetPlaceholderColor(const std::array<GLubyte, 4> & color) { m_placeholderColor = color; }
+
 		protected:
 			bool LoadResourceFromFile(const std::filesystem::path & /*pathname*/, Texture & /*texture*/) override { assert(0 && "Not yet implemented"); return false; };
 			bool LoadResourceFromRaw(const void * /*data*/, Texture & /*texture*/) override { assert(0 && "not yet implemented"); return false; };
 
+			//Load several image files in a texture array (used by LoadArray)
+			virtual bool LoadArrayResourceFromFiles(const std::vector<std::filesystem::path> & /*vPathnames*/, Texture & /*texture*/) { assert(0 && "Not yet implemented"); return false; };
+
+			//Decode an image file in CPU memory (used by LoadAsync, called by the job system workers : no OpenGL call)
+			virtual bool DecodeResourceFromFile(const std::filesystem::path & /*pathname*/, TextureImage & /*image*/) { assert(0 && "Not yet implemented"); return false; };
+
+			//Decode several image files of the same size in CPU memory (used by LoadArrayAsync, called by the job system workers : no OpenGL call)
+			virtual bool DecodeArrayResourceFromFiles(const std::vector<std::filesystem::path> & /*vPathnames*/, TextureImage & /*image*/) { assert(0 && "Not yet implemented"); return false; };
+
 			//OpenGL Texture is allocated
 			Texture CreateTextureRGBA(GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
 
+			//OpenGL Texture array is allocated (one layer per pixels pointer)
+			Texture CreateTextureArrayRGBA(GLsizei width, GLsizei height, GLenum format, GLenum type, const std::vector<const void*> & vLayerPixels);
+
+			//The image of an existing OpenGL Texture is replaced
+			void UpdateTextureRGBA(const Texture & texture, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+
+			//The layers of an existing OpenGL Texture array are replaced
+			void UpdateTextureArrayRGBA(const Texture & texture, GLsizei width, GLsizei height, GLenum format, GLenum type, const std::vector<const void*> & vLayerPixels);
+
+			//Create the texture from the cached mip chain of the source images, if the cache is enabled and up to date
+			bool LoadCachedTexture(const std::vector<std::filesystem::path> & vSources, GLenum target, Texture & texture);
+
+			//Write the mip chain of a texture loaded from the source images in the cache (if enabled).
+			//With a compressed cache format, the texture is replaced by the compressed levels.
+			void StoreCachedTexture(const std::vector<std::filesystem::path> & vSources, const Texture & texture);
+
+			//The levels of an existing OpenGL Texture are replaced by a cached mip chain (no mipmap generation)
+			void UpdateTextureFromCache(const Texture & texture, const CachedTexture & cached);
+
 			static void FreeResource(Texture& ressource);
 
+			//Byte size of the texture levels in video memory (queried from OpenGL, used by the memory budget)
+			std::size_t GetResourceByteSize(const Texture & texture) const override;
+
 			bool m_useMipmap = true;
 			GLenum m_textureTarget = GL_TEXTURE_2D;
+			bool m_usePixelBuffer = true;
+			std::shared_ptr<TextureCache> m_textureCache;
+
+		private:
+
+			//Copy of the pixels in the binded texture (through the pixel buffers if enabled)
+			void TexSubImage2D(GLenum target, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+			void TexSubImage3D(GLenum target, GLint layer, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+
+			PixelBufferRing m_pixelBuffers;		//! streaming of the uploads
+
+			//Image decoded (or mip chain read from the cache) by a worker, waiting for its upload
+			struct AsyncUpload
+			{
+				std::string resource_name;
+				std::vector<std::filesystem::path> vSources;
+				Texture texture;
+				TextureImage image;
+				CachedTexture cached;		//levels read from the cache (empty if decoded)
+				bool decoded = false;
+
+				std::size_t ByteSize() const;
+			};
+
+			//Placeholder texture and decoding job of an asynchronous load
+			Texture LoadAsync(const std::string & resource_name, const std::vector<std::filesystem::path> & vSources, GLsizei layers, std::function<bool(TextureImage &)> && decode);
+
+			//Decoding job of the sources of a texture, uploaded in place by UploadAsyncTextures
+			void DecodeAsync(const std::string & resource_name, const std::vector<std::filesystem::path> & vSources, const Texture & texture, std::function<bool(TextureImage &)> && decode);
+
+			std::unordered_map<std::string, std::vector<std::filesystem::path>> m_resourceSources;	//! image files of the texture arrays and asynchronous loads (see Reload)
+
+			std::array<GLubyte, 4> m_placeholderColor = { 255, 255, 255, 255 };
+			JobCounter m_asyncJobs;						//! decoding jobs
+			std::mutex m_asyncMutex;					//! protects m_asyncUploads
+			std::deque<AsyncUpload> m_asyncUploads;		//! decoded images waiting for the upload
+			std::atomic<std::size_t> m_asyncPending = { 0 };
 	};
 
 }
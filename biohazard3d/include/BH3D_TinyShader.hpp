@@ -125,6 +125,92 @@ namespace bh3d
 			";
 		}
 
+		inline constexpr const char * TEXTURE_INSTANCED_VERTEX() {
+			return
+				"																																		\n \
+				#version 330 core\n																														\n \
+																																						\n \
+				layout(location = 0) in vec3 in_Position;		// the position variable has attribute position 0										\n \
+				layout(location = 2) in vec2 in_Coord0;			// the texture variable has attribute position 2										\n \
+				layout(location = 9) in mat4 in_Instance;		// per instance transform matrix (attribute position 9 to 12, divisor 1)				\n \
+																																						\n \
+				out vec2  vert_texcoord;						// specify a color output to the fragment shader										\n \
+																																						\n \
+				uniform mat4 proj_view_transform;				//Projection * modelview matrix															\n \
+				uniform mat4 transform;							//transform matrix shared by all the instances (applied before the instance matrix)		\n \
+																																						\n \
+				void main()																																\n \
+				{																																		\n \
+					gl_Position = proj_view_transform * in_Instance * transform * vec4(in_Position, 1.0);	// vertex projection on the screen			\n \
+					vert_texcoord = in_Coord0;													// forward texture vertex								\n \
+				}																																		\n \
+			";
+		}
+
+		inline constexpr const char * TEXTURE_ARRAY_INSTANCED_VERTEX() {
+			return
+				"																																		\n \
+				#version 330 core\n																														\n \
+																																						\n \
+				layout(location = 0) in vec3 in_Position;		// the position variable has attribute position 0										\n \
+				layout(location = 2) in vec2 in_Coord0;			// the texture variable has attribute position 2										\n \
+				layout(location = 13) in int in_Layer;			// per instance texture array layer (attribute position 13, divisor 1)					\n \
+				layout(location = 14) in vec3 in_Offset;		// per instance translation (attribute position 14, divisor 1)							\n \
+																																						\n \
+				out vec2  vert_texcoord;						// specify a color output to the fragment shader										\n \
+				flat out int vert_layer;						// texture array layer to the fragment shader											\n \
+																																						\n \
+				uniform mat4 proj_view_transform;				//Projection * modelview matrix															\n \
+				uniform mat4 transform;							//transform matrix shared by all the instances (applied before the instance offset)		\n \
+				uniform int force_layer = -1;					//if positive, layer used by all the instances instead of in_Layer						\n \
+																																						\n \
+				void main()																																\n \
+				{																																		\n \
+					vec4 position = transform * vec4(in_Position, 1.0);							// shared transform then instance translation			\n \
+					gl_Position = proj_view_transform * vec4(position.xyz + in_Offset * position.w, position.w);	// vertex projection on the screen	\n \
+					vert_texcoord = in_Coord0;													// forward texture vertex								\n \
+					vert_layer = (force_layer < 0) ? in_Layer : force_layer;					// forward texture layer								\n \
+				}																																		\n \
+			";
+		}
+
+		inline constexpr const char * TEXTURE_ARRAY_VERTEX() {
+			return
+				"																																		\n \
+				#version 330 core\n																														\n \
+																																						\n \
+				layout(location = 0) in vec3 in_Position;		// the position variable has attribute position 0										\n \
+				layout(location = 2) in vec3 in_Coord0;			// the texture variable (u, v, layer) has attribute position 2							\n \
+																																						\n \
+				out vec2  vert_texcoord;						// specify a color output to the fragment shader										\n \
+				flat out int vert_layer;						// texture array layer to the fragment shader											\n \
+																																						\n \
+				uniform mat4 proj_view_transform;				//Projection * modelview * transform matrix												\n \
+																																						\n \
+				void main()																																\n \
+				{																																		\n \
+					gl_Position = proj_view_transform * vec4(in_Position, 1.0);					// vertex projection on the screen						\n \
+					vert_texcoord = in_Coord0.xy;												// forward texture vertex								\n \
+					vert_layer = int(in_Coord0.z + 0.5);										// forward texture layer								\n \
+				}																																		\n \
+			";
+		}
+
+		inline constexpr const char * TEXTURE_ARRAY_FRAGMENT() {
+			return
+				"																										\n \
+				#version 330 core 																						\n \
+				out vec4 FragColor;																						\n \
+				in vec2 vert_texcoord;																					\n \
+				flat in int vert_layer;																					\n \
+				uniform sampler2DArray textureSampler;																	\n \
+				void main()																								\n \
+				{																										\n \
+					FragColor = texture(textureSampler, vec3(vert_texcoord, float(vert_layer)));						\n \
+				}																										\n \
+			";
+		}
+
 		inline constexpr const char * TEXTURE_FRAGMENT() {
 			return
 				"																										\n \
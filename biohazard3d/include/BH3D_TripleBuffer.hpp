@@ -0,0 +1,88 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+#ifndef _BH3D_TRIPLE_BUFFER_H_
+#define _BH3D_TRIPLE_BUFFER_H_
+
+#include <atomic>
+
+namespace bh3d
+{
+
+	/// <summary>
+	/// Lock-free handoff of a value between one producer thread and one consumer thread.
+	/// The producer fills Write() and calls Publish(), the consumer calls Update() then reads Read().
+	/// Neither side ever waits : the consumer gets the latest published value, the intermediate ones are skipped.
+	/// </summary>
+	template<typename T>
+	class TripleBuffer
+	{
+	public:
+
+		/// <summary>
+		/// Buffer owned by the producer (its content is unspecified after a Publish : write the whole value)
+		/// </summary>
+		inline T & Write() { return m_buffers[m_write]; }
+
+		/// <summary>
+		/// Gives the written buffer to the consumer (producer thread)
+		/// </summary>
+		inline void Publish() {
+			unsigned int previous = m_middle.exchange(m_write | NEW_BIT, std::memory_order_acq_rel);
+			m_write = previous & INDEX_MASK;
+		}
+
+		/// <summary>
+		/// Takes the last published buffer if there is a new one (consumer thread)
+		/// </summary>
+		/// <returns>true if Read() changed</returns>
+		inline bool Update() {
+			if ((m_middle.load(std::memory_order_relaxed) & NEW_BIT) == 0)
+				return false;
+			unsigned int previous = m_middle.exchange(m_read, std::memory_order_acq_rel);
+			m_read = previous & INDEX_MASK;
+			return true;
+		}
+
+		/// <summary>
+		/// Buffer owned by the consumer
+		/// </summary>
+		inline const T & Read() const { return m_buffers[m_read]; }
+
+	private:
+
+		static constexpr unsigned int NEW_BIT = 0b100;
+		static constexpr unsigned int INDEX_MASK = 0b011;
+
+		T m_buffers[3];
+		unsigned int m_write = 0;						//! producer side
+		std::atomic<unsigned int> m_middle = { 1 };		//! shared buffer index, with NEW_BIT if not read yet
+		unsigned int m_read = 2;						//! consumer side
+	};
+
+}
+#endif //_BH3D_TRIPLE_BUFFER_H_
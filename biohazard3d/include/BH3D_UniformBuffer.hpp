@@ -0,0 +1,115 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef _BH3D_UNIFORM_BUFFER_H_
+#define _BH3D_UNIFORM_BUFFER_H_
+
+#include <utility>
+
+#include <glm/glm.hpp>
+
+#include <glad/glad.h>
+
+//Uniform block of the per frame data, bound by all the shaders declaring it (see Shader and FrameUniforms)
+#define BH3D_FRAME_UNIFORM_BLOCK	"FrameData"
+#define BH3D_FRAME_UNIFORM_BINDING	0
+
+//GLSL declaration of the frame uniform block (std140 layout of FrameUniforms)
+#define BH3D_FRAME_UNIFORM_BLOCK_GLSL				\
+	"layout(std140) uniform FrameData				\n"	\
+	"{												\n"	\
+	"	mat4 frame_projection;						\n"	\
+	"	mat4 frame_view;							\n"	\
+	"	mat4 frame_proj_view;						\n"	\
+	"	vec4 frame_camera_position;					\n"	\
+	"	vec4 frame_time;	//x : time, y : frame duration (s)	\n"	\
+	"};												\n"
+
+namespace bh3d
+{
+	/// <summary>
+	/// Per frame data shared by all the programs through the uniform block BH3D_FRAME_UNIFORM_BLOCK (std140 : only mat4/vec4 members)
+	/// </summary>
+	struct FrameUniforms
+	{
+		glm::mat4 projection = glm::mat4(1.0f);
+		glm::mat4 view = glm::mat4(1.0f);
+		glm::mat4 proj_view = glm::mat4(1.0f);
+		glm::vec4 camera_position = glm::vec4(0.0f);	//w unused
+		glm::vec4 time = glm::vec4(0.0f);				//x : time in second, y : frame duration in second
+	};
+	static_assert(sizeof(FrameUniforms) == 3 * 64 + 2 * 16, "FrameUniforms must follow the std140 layout");
+
+	/// <summary>
+	/// Uniform buffer object bound to a binding point (GL_UNIFORM_BUFFER)
+	/// </summary>
+	class UniformBuffer
+	{
+	public:
+		UniformBuffer() = default;
+		~UniformBuffer() { Destroy(); }
+
+		UniformBuffer(const UniformBuffer &) = delete;
+		UniformBuffer& operator=(const UniformBuffer &) = delete;
+
+		UniformBuffer(UniformBuffer && buffer) noexcept { *this = std::move(buffer); }
+		UniformBuffer& operator=(UniformBuffer && buffer) noexcept;
+
+		/// <summary>
+		/// Allocate the buffer and bind it to its binding point
+		/// </summary>
+		/// <param name="byteSize">Buffer size</param>
+		/// <param name="binding">Uniform buffer binding point</param>
+		/// <returns>if it's ok ?</returns>
+		bool Create(GLsizeiptr byteSize, GLuint binding);
+
+		/// <summary>
+		/// Replace the content of the buffer (the whole buffer is orphaned : no wait on the draws using the previous content)
+		/// </summary>
+		/// <param name="data">New content</param>
+		/// <param name="byteSize">Content size (at most the buffer size)</param>
+		void Update(const void * data, GLsizeiptr byteSize);
+
+		template <typename T>
+		inline void Update(const T & data) { Update(&data, (GLsizeiptr)sizeof(T)); }
+
+		//Bind the buffer to its binding point again (if another buffer took it)
+		void Bind() const;
+
+		void Destroy();
+
+		inline bool IsValid() const { return m_buffer != 0; }
+		inline GLuint GetGLBuffer() const { return m_buffer; }
+		inline GLuint GetBinding() const { return m_binding; }
+
+	private:
+		GLuint m_buffer = 0;
+		GLuint m_binding = 0;
+		GLsizeiptr m_byteSize = 0;
+	};
+}
+
+#endif //_BH3D_UNIFORM_BUFFER_H_
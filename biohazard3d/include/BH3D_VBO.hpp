@@ -28,6 +28,7 @@
 #define _BH3D_VBO_H_
 
 #include <vector>
+#include <utility>
 
 #include <glm/glm.hpp>
 
@@ -42,7 +43,8 @@ namespace bh3d
 	{
 		FLOAT,	//default using glVertexAttribPointer
 		INT,	//int type using glVertexAttribIPointer
-		DOUBLE  //double type using glVertexAttribLPointer
+		DOUBLE, //double type using glVertexAttribLPointer
+		NORMALIZED	//fixed point type read as float in [0, 1] or [-1, 1] (glVertexAttribPointer with normalized = GL_TRUE)
 	};
 
 	class VBO
@@ -81,6 +83,7 @@ namespace bh3d
 		inline GLuint GetArrayBufferID() const;
 		inline GLuint GetElementBufferID() const;
 		inline GLuint GetVertexArraysID() const;
+		inline GLuint GetInstanceBufferID() const;
 
 	
 		//Main functions to fill the VBO/VAO
@@ -107,10 +110,54 @@ namespace bh3d
 		void AddArrayBufferData(GLuint indexAttrib, const void *data, std::size_t byteSize, GLint vertexSize, GLenum dataType);
 		
 		
-		void AddStructArrayBufferData(GLuint nbAttrib, const GLuint *ptAttribIndex, const GLenum *ptAttribType, const GLuint *ptAttribSize, const GLuint *ptAttribOffsetSize, GLuint  stride, std::size_t size, const void *data, const AttribType * ptAttribInType = nullptr);
+		/// <summary>
+		/// Function to add a structure array as array buffer (several attributes interleaved with a stride)
+		/// The memory of data pointer have to stay valid until the call of the function Create
+		/// With a divisor greater than 0, the attributes are per instance data (see glVertexAttribDivisor) and are stored in a separate instance buffer (see UpdateInstanceBufferData)
+		/// </summary>
+		void AddStructArrayBufferData(GLuint nbAttrib, const GLuint *ptAttribIndex, const GLenum *ptAttribType, const GLuint *ptAttribSize, const GLuint *ptAttribOffsetSize, GLuint  stride, std::size_t size, const void *data, const AttribType * ptAttribInType = nullptr, GLuint divisor = 0);
 		
 		//surcharge element buffer
-		inline void AddStructArrayBufferData(GLuint nbAttrib, const std::vector<GLuint> &tAttribIndex, const std::vector<GLenum> &tAttribType, const std::vector<GLuint> &tAttribSize, const std::vector<GLuint> &tAttribOffsetSize, GLuint stride, std::size_t size, const void *data, const std::vector<AttribType> &tAttribInType = {});
+		inline void AddStructArrayBufferData(GLuint nbAttrib, const std::vector<GLuint> &tAttribIndex, const std::vector<GLenum> &tAttribType, const std::vector<GLuint> &tAttribSize, const std::vector<GLuint> &tAttribOffsetSize, GLuint stride, std::size_t size, const void *data, const std::vector<AttribType> &tAttribInType = {}, GLuint divisor = 0);
+
+		/// <summary>
+		/// Replace the content of the instance buffer (data added with a divisor greater than 0).
+		/// The buffer is orphaned then refilled, the VAO stays valid.
+		/// </summary>
+		/// <param name="data">data pointer</param>
+		/// <param name="byteSize">byte size of data array</param>
+		/// <param name="mod">Usage hint of the buffer (GL_DYNAMIC_DRAW, GL_STREAM_DRAW...)</param>
+		void UpdateInstanceBufferData(const void *data, std::size_t byteSize, GLenum mod = GL_DYNAMIC_DRAW);
+
+		/// <summary>
+		/// Turn the instance buffer into a ring of slots to stream per instance data frame after frame.
+		/// The buffer is persistently mapped if glBufferStorage is available (GL 4.4), else each slot is mapped unsynchronized.
+		/// Each slot is protected by a fence, so the CPU never writes in a slot still read by the GPU.
+		/// Only the ranges marked with MarkInstanceStreamDirty are copied in the slots.
+		/// </summary>
+		/// <param name="instanceCapacity">Maximal instance number in a slot</param>
+		/// <param name="instanceByteSize">Byte size of one instance (the stride of the instance structure)</param>
+		/// <param name="slotCount">Number of slots (3 : triple buffering)</param>
+		/// <returns>BH3D_OK or BH3D_ERROR</returns>
+		bool CreateInstanceStream(GLuint instanceCapacity, std::size_t instanceByteSize, GLuint slotCount = 3);
+
+		/// <summary>
+		/// Marks a range of instances as modified. The range will be copied in each slot the next time it is used.
+		/// </summary>
+		/// <param name="firstInstance">first modified instance</param>
+		/// <param name="instanceCount">number of modified instances</param>
+		void MarkInstanceStreamDirty(GLuint firstInstance, GLuint instanceCount = 1);
+
+		/// <summary>
+		/// Fences the previous slot, waits for the next one and copies its dirty ranges from the CPU instance array.
+		/// When no slot has a dirty range, the current slot is reused without any fence.
+		/// </summary>
+		/// <param name="data">CPU instance array (instanceCapacity elements at most)</param>
+		/// <returns>The base instance to use in the draw calls (glDrawElementsInstancedBaseInstance)</returns>
+		GLuint CommitInstanceStream(const void *data);
+
+		inline bool IsInstanceStream() const;
+		inline GLuint GetInstanceStreamCapacity() const;
 
 		//surcharge element buffer
 		inline void AddElementBufferData(const unsigned int* data, std::size_t size);
@@ -152,6 +199,7 @@ namespace bh3d
 		GLuint arrayBufferID = 0;   //VBO
 		GLuint elementBufferID = 0; //
 		GLuint vertexArraysID = 0;  //VAO
+		GLuint instanceBufferID = 0; //VBO of per instance data
 
 		/// <summary>
 		/// Mapping structure to fill the opengl VBO/VAO functions (glGenBuffers, glBufferData, glBufferSubData, glGenVertexArrays, glEnableVertexAttribArray...)
@@ -168,6 +216,7 @@ namespace bh3d
 			std::vector<GLuint> vAttribSize;			//1,2,3,4 (vecteur a 1,2,3 ou 4 coordonn�es)- tableau de la taille vAttribType[vAttribSize]
 			std::vector<GLuint> vAttribOffsetStart;		//offset en octet entre chaque element de la structure - tableau de la taille vAttribOffsetSize[vAttribSize]
 			std::vector<AttribType> vAttribInType;		// BH3D_ATTRIBUT_VEC, BH3D_ATTRIBUT_IVEC, BH3D_ATTRIBUT_LVEC
+			GLuint divisor = 0;							//0 : per vertex data, else per instance data (glVertexAttribDivisor)
 
 		}ArrayBuffer;
 
@@ -181,6 +230,35 @@ namespace bh3d
 
 		std::vector<ElementBuffer> vElementBuffers;
 		std::vector<ArrayBuffer> vArrayBuffers;
+		std::vector<ArrayBuffer> vInstanceBuffers;
+
+		/// <summary>
+		/// Ring of slots in the instance buffer (see CreateInstanceStream)
+		/// </summary>
+		typedef struct _InstanceStream
+		{
+			GLuint slotCount = 0;
+			GLuint instanceCapacity = 0;						//instance number in a slot
+			std::size_t instanceByteSize = 0;
+			std::size_t slotByteSize = 0;
+			GLuint currentSlot = 0;
+			bool committed = false;								//a slot has already been used
+			void *persistentPtr = nullptr;						//mapping address (glBufferStorage only)
+			std::vector<GLsync> vFences;						//one fence per slot
+			std::vector<std::vector<std::pair<GLuint, GLuint>>> vDirtyRanges;	//per slot, instance ranges [first, last[ to copy
+		}InstanceStream;
+
+		InstanceStream instanceStream;
+
+		/// <summary>
+		/// Release the fences and the mapping of the instance stream
+		/// </summary>
+		void DeleteInstanceStream();
+
+		/// <summary>
+		/// Set the attribute pointers of the array buffers in the binded VAO
+		/// </summary>
+		static void AttribPointers(const std::vector<ArrayBuffer> & vBuffers);
 
 	};
 
@@ -195,6 +273,10 @@ namespace bh3d
 	}
 
 	void VBO::DeleteBufferGPU() {
+		//Nothing created on the GPU : no OpenGL call (a CPU only mesh can be destroyed without context)
+		if (vertexArraysID == 0 && arrayBufferID == 0 && elementBufferID == 0 && instanceBufferID == 0)
+			return;
+
 		BH3D_GL_CHECK_ERROR;
 
 		glBindVertexArray(0);
@@ -216,11 +298,19 @@ namespace bh3d
 			elementBufferID = 0;
 		}
 
+		DeleteInstanceStream();
+
+		if (instanceBufferID != 0) {
+			glDeleteBuffers(1, &instanceBufferID);
+			instanceBufferID = 0;
+		}
+
 	}
 
 	void VBO::DeleteBufferCPU() {
 		vElementBuffers.clear();
 		vArrayBuffers.clear();
+		vInstanceBuffers.clear();
 	}
 
 	void VBO::Destroy()
@@ -243,6 +333,15 @@ namespace bh3d
 	inline GLuint VBO::GetVertexArraysID() const {
 		return vertexArraysID;
 	}
+	inline GLuint VBO::GetInstanceBufferID() const {
+		return instanceBufferID;
+	}
+	inline bool VBO::IsInstanceStream() const {
+		return instanceStream.slotCount > 0;
+	}
+	inline GLuint VBO::GetInstanceStreamCapacity() const {
+		return instanceStream.instanceCapacity;
+	}
 
 	inline bool VBO::IsValid() const
 	{
@@ -340,12 +439,12 @@ namespace bh3d
 
 	//Structure array buffer
 	//----------------------------------
-	inline void VBO::AddStructArrayBufferData(GLuint nbAttrib, const std::vector<GLuint> &tAttribIndex, const std::vector<GLenum> &tAttribType, const std::vector<GLuint> &tAttribSize, const std::vector<GLuint> &tAttribOffsetStart, GLuint stride, std::size_t size, const void *data, const std::vector<AttribType> &tAttribInType)
+	inline void VBO::AddStructArrayBufferData(GLuint nbAttrib, const std::vector<GLuint> &tAttribIndex, const std::vector<GLenum> &tAttribType, const std::vector<GLuint> &tAttribSize, const std::vector<GLuint> &tAttribOffsetStart, GLuint stride, std::size_t size, const void *data, const std::vector<AttribType> &tAttribInType, GLuint divisor)
 	{
 		const AttribType *ptAttribInType = nullptr;
 		if (tAttribInType.size())
 			ptAttribInType = &tAttribInType[0];
-		AddStructArrayBufferData(nbAttrib, &tAttribIndex[0], &tAttribType[0], &tAttribSize[0], &tAttribOffsetStart[0], stride, size, data, ptAttribInType);
+		AddStructArrayBufferData(nbAttrib, &tAttribIndex[0], &tAttribType[0], &tAttribSize[0], &tAttribOffsetStart[0], stride, size, data, ptAttribInType, divisor);
 	}
 }
 
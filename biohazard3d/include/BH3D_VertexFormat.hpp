@@ -0,0 +1,122 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef _BH3D_VERTEX_FORMAT_H_
+#define _BH3D_VERTEX_FORMAT_H_
+
+#include <array>
+#include <type_traits>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+#include "BH3D_VBO.hpp"
+
+namespace bh3d
+{
+	/// <summary>
+	/// OpenGL type of a vertex component (float, int...)
+	/// </summary>
+	template<typename T> struct VertexComponent;
+	template<> struct VertexComponent<float> { static constexpr GLenum type = GL_FLOAT; static constexpr AttribType inType = AttribType::FLOAT; };
+	template<> struct VertexComponent<double> { static constexpr GLenum type = GL_DOUBLE; static constexpr AttribType inType = AttribType::DOUBLE; };
+	template<> struct VertexComponent<int> { static constexpr GLenum type = GL_INT; static constexpr AttribType inType = AttribType::INT; };
+	template<> struct VertexComponent<unsigned int> { static constexpr GLenum type = GL_UNSIGNED_INT; static constexpr AttribType inType = AttribType::INT; };
+
+	//Component type of a scalar or a glm vector
+	template<typename T, typename = void> struct VertexComponentOf { using type = T; };
+	template<typename T> struct VertexComponentOf<T, std::enable_if_t<!std::is_arithmetic_v<T>>> { using type = std::decay_t<decltype(std::declval<T&>()[0])>; };
+
+	/// <summary>
+	/// Compile time description of one vertex attribute : attribute index (ATTRIB_INDEX or INSTANCE_ATTRIB_INDEX) and C++ type (scalar or glm vector)
+	/// ex : VertexElement<ATTRIB_INDEX::NORMAL, glm::vec3>
+	/// </summary>
+	template<auto Index, typename T>
+	struct VertexElement
+	{
+		using value_type = T;
+		using component_type = typename VertexComponentOf<T>::type;
+
+		static constexpr GLuint index = (GLuint)Index;
+		static constexpr GLuint size = (GLuint)(sizeof(T) / sizeof(component_type));	//1, 2, 3 or 4 components
+		static constexpr GLuint byteSize = (GLuint)sizeof(T);
+		static constexpr GLenum type = VertexComponent<component_type>::type;
+		static constexpr AttribType inType = VertexComponent<component_type>::inType;
+
+		static_assert(size >= 1 && size <= 4, "A vertex attribute has 1 to 4 components");
+	};
+
+	/// <summary>
+	/// Compile time description of an interleaved vertex : the elements are packed in the declaration order, without padding.
+	/// ex : using VertexPN = VertexFormat<VertexElement<ATTRIB_INDEX::POSITION, glm::vec3>, VertexElement<ATTRIB_INDEX::NORMAL, glm::vec3>>;
+	/// </summary>
+	template<typename... Elements>
+	struct VertexFormat
+	{
+		static constexpr GLuint count = (GLuint)sizeof...(Elements);
+		static constexpr GLuint stride = (Elements::byteSize + ...);
+
+		static constexpr std::array<GLuint, count> indices = { Elements::index... };
+		static constexpr std::array<GLenum, count> types = { Elements::type... };
+		static constexpr std::array<GLuint, count> sizes = { Elements::size... };
+		static constexpr std::array<AttribType, count> inTypes = { Elements::inType... };
+		static constexpr std::array<GLuint, count> offsets = []() {
+			std::array<GLuint, count> result = {};
+			const GLuint byteSizes[count] = { Elements::byteSize... };
+			GLuint offset = 0;
+			for (GLuint i = 0; i < count; i++)
+			{
+				result[i] = offset;
+				offset += byteSizes[i];
+			}
+			return result;
+		}();
+
+		/// <summary>
+		/// Adds an array of interleaved vertices to the VBO (see VBO::AddStructArrayBufferData)
+		/// The memory of data pointer have to stay valid until the call of the function VBO::Create
+		/// </summary>
+		/// <param name="vbo">VBO to fill</param>
+		/// <param name="data">vertex array, each vertex follows the format (stride bytes)</param>
+		/// <param name="vertexCount">number of vertices</param>
+		/// <param name="divisor">0 : per vertex data, else per instance data (glVertexAttribDivisor)</param>
+		static void AddArrayBufferData(VBO & vbo, const void * data, std::size_t vertexCount, GLuint divisor = 0)
+		{
+			vbo.AddStructArrayBufferData(count, indices.data(), types.data(), sizes.data(), offsets.data(), stride, vertexCount * stride, data, inTypes.data(), divisor);
+		}
+
+		//Checked with a structure of the same layout
+		template<typename Vertex>
+		static void AddArrayBufferData(VBO & vbo, const std::vector<Vertex> & vVertices, GLuint divisor = 0)
+		{
+			static_assert(sizeof(Vertex) == stride, "The vertex structure doesn't match the vertex format");
+			AddArrayBufferData(vbo, vVertices.empty() ? nullptr : vVertices.data(), vVertices.size(), divisor);
+		}
+	};
+
+}
+
+#endif //_BH3D_VERTEX_FORMAT_H_
@@ -118,6 +118,14 @@ namespace bh3d
 			return TextureManager::Load(pathname, resource_name);
 		}
 
+		/// <summary>
+		/// Replace the pixels of a texture created from a matrix of the same size (ex: video frames pushed every frame).
+		/// The frame is streamed through the pixel buffers without reallocation (see TextureManager::UploadTextureRGBA)
+		/// </summary>
+		/// <param name="texture">Texture to update</param>
+		/// <param name="img">New image (same size as the texture)</param>
+		void UpdateTexture(const Texture & texture, const cv::Mat & img);
+
 	protected:
 
 		/// <summary>
@@ -136,6 +144,14 @@ namespace bh3d
 		/// <returns>if it's ok ?</returns>
 		bool LoadResourceFromFile(const std::filesystem::path & pathname, Texture& texture) override;
 
+		/// <summary>
+		/// Decode an image file in CPU memory using OpenCV (used by the asynchronous loads and the reloads, thread safe)
+		/// </summary>
+		/// <param name="pathname">Image path</param>
+		/// <param name="image">Decoded image</param>
+		/// <returns>if it's ok ?</returns>
+		bool DecodeResourceFromFile(const std::filesystem::path & pathname, TextureImage & image) override;
+
 		/// <summary>
 		/// Override the generic raw function with a cv::Mat as input
 		/// </summary>
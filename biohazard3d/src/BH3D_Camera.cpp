@@ -85,6 +85,29 @@ namespace bh3d
 	
 	}
 
+	Ray CameraEngine::UnprojectRay(int x, int y) const
+	{
+		assert(IsValid());
+
+		//Pixel center in normalized device coordinates (the viewport y axis goes up)
+		const float ndc_x = 2.0f * ((float)(x - m_position_x) + 0.5f) / (float)m_width - 1.0f;
+		const float ndc_y = 1.0f - 2.0f * ((float)(y - m_position_y) + 0.5f) / (float)m_height;
+
+		const glm::mat4 inverse = glm::inverse(ProjViewTransform());
+		const glm::vec4 near_point = inverse * glm::vec4(ndc_x, ndc_y, -1.0f, 1.0f);
+		const glm::vec4 far_point = inverse * glm::vec4(ndc_x, ndc_y, 1.0f, 1.0f);
+
+		Ray ray;
+		ray.m_origin = glm::vec3(near_point) / near_point.w;
+		ray.m_direction = glm::normalize(glm::vec3(far_point) / far_point.w - ray.m_origin);
+		return ray;
+	}
+
+	Ray CameraEngine::UnprojectRay(const Mouse &m_mouse) const
+	{
+		return UnprojectRay(m_mouse.GetPosX(), m_mouse.GetPosY());
+	}
+
 	void CameraEngine::FreeFlight(const Mouse &m_mouse)
 	{
 
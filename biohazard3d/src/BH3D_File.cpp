@@ -25,12 +25,24 @@
 
 #include <algorithm>
 #include <fstream>
+#include <system_error>
 
 #include "BH3D_File.hpp"
 #include "BH3D_Logger.hpp"
 #include "BH3D_Common.hpp"
 
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #ifdef __ANDROID__
 #include <SDL.h>  //utilisation de la fonction SDL_RWFromFile pour ouvrir un fichier
 #include "SDLSmart.hpp"
@@ -118,4 +130,117 @@ namespace bh3d
 
 
 
+
+	bool WriteFileAtomic(const std::filesystem::path & path, const std::function<void(std::ostream &)> & write)
+	{
+		std::error_code ec;
+		auto tmpPath = path;
+		tmpPath += ".tmp";
+
+		std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!ofs.is_open())
+		{
+			BH3D_LOGGER_WARNING("Can't write the file : " << tmpPath);
+			return BH3D_ERROR;
+		}
+
+		write(ofs);
+		ofs.close();
+		if (!ofs)
+		{
+			BH3D_LOGGER_WARNING("Can't write the file : " << tmpPath);
+			std::filesystem::remove(tmpPath, ec);
+			return BH3D_ERROR;
+		}
+
+		std::filesystem::remove(path, ec);
+		std::filesystem::rename(tmpPath, path, ec);
+		if (ec)
+		{
+			BH3D_LOGGER_WARNING("Can't write the file : " << path << " " << ec.message());
+			std::filesystem::remove(tmpPath, ec);
+			return BH3D_ERROR;
+		}
+
+		return BH3D_OK;
+	}
+
+
+	bool MappedFile::Open(const std::filesystem::path & path)
+	{
+		Close();
+
+#ifdef _WIN32
+		HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return BH3D_ERROR;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return BH3D_ERROR;
+		}
+
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		const void * data = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (data == nullptr)
+		{
+			if (mapping != nullptr)
+				CloseHandle(mapping);
+			CloseHandle(file);
+			BH3D_LOGGER_ERROR("Can't map the file : " << path);
+			return BH3D_ERROR;
+		}
+
+		m_fileHandle = file;
+		m_mappingHandle = mapping;
+		m_data = static_cast<const unsigned char *>(data);
+		m_size = (std::size_t)size.QuadPart;
+#else
+		const int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return BH3D_ERROR;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0)
+		{
+			close(fd);
+			return BH3D_ERROR;
+		}
+
+		void * data = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);	//the mapping keeps the file
+		if (data == MAP_FAILED)
+		{
+			BH3D_LOGGER_ERROR("Can't map the file : " << path);
+			return BH3D_ERROR;
+		}
+
+		m_data = static_cast<const unsigned char *>(data);
+		m_size = (std::size_t)st.st_size;
+#endif
+
+		return BH3D_OK;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_data == nullptr)
+			return;
+
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mappingHandle);
+		CloseHandle(m_fileHandle);
+		m_mappingHandle = nullptr;
+		m_fileHandle = nullptr;
+#else
+		munmap(const_cast<unsigned char *>(m_data), m_size);
+#endif
+
+		m_data = nullptr;
+		m_size = 0;
+	}
+
 }
\ No newline at end of file
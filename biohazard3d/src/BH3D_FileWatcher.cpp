@@ -0,0 +1,264 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <system_error>
+#include <cassert>
+
+#include "BH3D_FileWatcher.hpp"
+#include "BH3D_Logger.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace bh3d
+{
+#ifdef __linux__
+	//Written or replaced files (editors often save in a temporary file renamed over the original)
+	static constexpr std::uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO;
+#endif
+
+	FileWatcher::FileWatcher(std::chrono::milliseconds pollInterval) :
+		m_pollInterval(pollInterval), m_lastScan(std::chrono::steady_clock::now())
+	{
+#ifdef __linux__
+		m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_inotify < 0)
+			BH3D_LOGGER_WARNING("inotify is not available, the watched files are polled");
+#endif
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+#ifdef __linux__
+		if (m_inotify >= 0)
+			close(m_inotify);
+#endif
+	}
+
+	int FileWatcher::Watch(const std::filesystem::path & pathname, Callback && callback)
+	{
+		assert(callback);
+
+		std::error_code error;
+		if (!std::filesystem::exists(pathname, error))
+		{
+			BH3D_LOGGER_WARNING("Can't watch a missing path : " << pathname);
+			return 0;
+		}
+
+		Entry entry;
+		entry.id = m_nextId++;
+		entry.pathname = pathname.lexically_normal();
+		entry.directory = std::filesystem::is_directory(pathname, error);
+		if (entry.directory && !entry.pathname.has_filename() && entry.pathname.has_relative_path())
+			entry.pathname = entry.pathname.parent_path();	//"dir/" -> "dir"
+		entry.callback = std::move(callback);
+
+#ifdef __linux__
+		if (m_inotify >= 0)
+		{
+			//A file is watched through its directory : its inode changes when it is replaced
+			std::filesystem::path directory = entry.directory ? entry.pathname : entry.pathname.parent_path();
+			if (directory.empty())
+				directory = ".";
+
+			entry.descriptor = inotify_add_watch(m_inotify, directory.c_str(), WATCH_MASK);
+			if (entry.descriptor < 0)
+			{
+				BH3D_LOGGER_WARNING("Can't watch the directory : " << directory);
+				return 0;
+			}
+			m_directories[entry.descriptor] = directory;
+		}
+#endif
+
+		//First snapshot of the modification times
+		if (!IsNative())
+		{
+			std::vector<std::filesystem::path> vIgnored;
+			Scan(entry, vIgnored);
+		}
+
+		BH3D_LOGGER("Watch : " << entry.pathname << (IsNative() ? "" : " (polling)"));
+
+		m_vEntries.push_back(std::move(entry));
+		return m_vEntries.back().id;
+	}
+
+	void FileWatcher::Unwatch(int id)
+	{
+		auto it = std::find_if(m_vEntries.begin(), m_vEntries.end(), [id](const Entry & entry) { return entry.id == id; });
+		if (it == m_vEntries.end())
+			return;
+
+		const int descriptor = it->descriptor;
+		m_vEntries.erase(it);
+
+#ifdef __linux__
+		//The directory watch is shared by the entries of the same directory
+		if (descriptor >= 0 && std::none_of(m_vEntries.begin(), m_vEntries.end(), [descriptor](const Entry & entry) { return entry.descriptor == descriptor; }))
+		{
+			inotify_rm_watch(m_inotify, descriptor);
+			m_directories.erase(descriptor);
+		}
+#endif
+	}
+
+	std::size_t FileWatcher::Poll()
+	{
+		if (m_vEntries.empty())
+			return 0;
+
+		std::vector<std::filesystem::path> vChanged;
+		if (IsNative())
+			ReadEvents(vChanged);
+		else
+		{
+			const auto now = std::chrono::steady_clock::now();
+			if (now - m_lastScan < m_pollInterval)
+				return 0;
+			m_lastScan = now;
+
+			for (auto & entry : m_vEntries)
+				Scan(entry, vChanged);
+		}
+
+		//Once per file, even if several events are reported
+		std::sort(vChanged.begin(), vChanged.end());
+		vChanged.erase(std::unique(vChanged.begin(), vChanged.end()), vChanged.end());
+
+		//The callbacks may add or remove watches : the entries are copied
+		std::vector<std::pair<std::filesystem::path, Callback>> vCalls;
+		for (const auto & pathname : vChanged)
+		{
+			for (const auto & entry : m_vEntries)
+			{
+				if (Match(entry, pathname))
+					vCalls.emplace_back(pathname, entry.callback);
+			}
+		}
+
+		for (auto & [pathname, callback] : vCalls)
+		{
+			BH3D_LOGGER("File changed : " << pathname);
+			callback(pathname);
+		}
+
+		return vChanged.size();
+	}
+
+	bool FileWatcher::Match(const Entry & entry, const std::filesystem::path & pathname)
+	{
+		if (entry.directory)
+		{
+			const std::filesystem::path directory = pathname.parent_path();
+			return (directory.empty() ? std::filesystem::path(".") : directory) == entry.pathname;
+		}
+		return pathname == entry.pathname;
+	}
+
+	void FileWatcher::Scan(Entry & entry, std::vector<std::filesystem::path> & vChanged)
+	{
+		auto check = [&entry, &vChanged](const std::filesystem::path & pathname) {
+			std::error_code error;
+			FileStamp stamp;
+			stamp.time = std::filesystem::last_write_time(pathname, error);
+			if (error)
+				return;
+			stamp.size = std::filesystem::file_size(pathname, error);
+			if (error)
+				return;
+
+			auto it = entry.stamps.find(pathname.generic_string());
+			if (it == entry.stamps.end())
+				entry.stamps.emplace(pathname.generic_string(), stamp);
+			else if (!(it->second == stamp))
+				it->second = stamp;
+			else
+				return;
+			vChanged.push_back(pathname);
+		};
+
+		if (!entry.directory)
+		{
+			check(entry.pathname);
+			return;
+		}
+
+		std::error_code error;
+		for (const auto & file : std::filesystem::directory_iterator(entry.pathname, error))
+		{
+			if (file.is_regular_file(error))
+				check((entry.pathname / file.path().filename()).lexically_normal());
+		}
+	}
+
+	void FileWatcher::ReadEvents(std::vector<std::filesystem::path> & vChanged)
+	{
+#ifdef __linux__
+		alignas(inotify_event) char buffer[4096];
+		for (;;)
+		{
+			const ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+			if (length <= 0)
+			{
+				if (length < 0 && errno != EAGAIN && errno != EINTR)
+					BH3D_LOGGER_WARNING("inotify read error : " << errno);
+				break;
+			}
+
+			for (ssize_t offset = 0; offset < length; )
+			{
+				const inotify_event * event = reinterpret_cast<const inotify_event *>(buffer + offset);
+				offset += sizeof(inotify_event) + event->len;
+
+				if (event->mask & IN_Q_OVERFLOW)
+				{
+					BH3D_LOGGER_WARNING("inotify queue overflow : file changes are lost");
+					continue;
+				}
+				if (!(event->mask & WATCH_MASK) || event->len == 0)
+					continue;
+
+				auto it = m_directories.find(event->wd);
+				if (it == m_directories.end())
+					continue;
+
+				//A temporary file already renamed is ignored
+				std::error_code error;
+				auto pathname = (it->second / event->name).lexically_normal();
+				if (std::filesystem::exists(pathname, error))
+					vChanged.push_back(std::move(pathname));
+			}
+		}
+#else
+		(void)vChanged;
+#endif
+	}
+}
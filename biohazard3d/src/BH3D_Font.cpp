@@ -146,10 +146,11 @@ namespace bh3d
 	void Font::PrintTextOneLine(const std::string & text, std::size_t start, std::size_t end)
 	{
 		int offset = offsetx;
+		const GLint posLocation = pShader->GetUniformLocation(BH3D_FONT_POS_UNIFORM);
 		for (std::size_t i = start; i < end; i++)
 		{
 
-			pShader->Send2i(BH3D_FONT_POS_UNIFORM, offset, offsety);
+			pShader->Send2i(posLocation, offset, offsety);
 			unsigned int ptroffset = (unsigned int)6 * text[i];
 			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (unsigned int*)nullptr + ptroffset);
 			offset += tAdvance[text[i]] + border;
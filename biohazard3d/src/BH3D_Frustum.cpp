@@ -0,0 +1,153 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <cmath>
+#include <cassert>
+
+#include "BH3D_Frustum.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BH3D_FRUSTUM_SSE
+#include <emmintrin.h>
+#endif
+
+namespace bh3d
+{
+
+	void Frustum::Extract(const glm::mat4 & m)
+	{
+		//rows of the matrix (glm is column major : m[column][row])
+		const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		m_planes[PLANE_LEFT] = row3 + row0;
+		m_planes[PLANE_RIGHT] = row3 - row0;
+		m_planes[PLANE_BOTTOM] = row3 + row1;
+		m_planes[PLANE_TOP] = row3 - row1;
+		m_planes[PLANE_NEAR] = row3 + row2;
+		m_planes[PLANE_FAR] = row3 - row2;
+
+		for (auto & plane : m_planes)
+		{
+			float length = glm::length(glm::vec3(plane));
+			if (length > 0.0f)
+				plane /= length;
+		}
+	}
+
+	bool Frustum::IsVisible(const glm::vec3 & center, const glm::vec3 & halfSize) const
+	{
+		for (const auto & plane : m_planes)
+		{
+			//distance of the box center minus the projected radius of the box on the plane normal
+			float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			float radius = std::abs(plane.x) * halfSize.x + std::abs(plane.y) * halfSize.y + std::abs(plane.z) * halfSize.z;
+			if (distance + radius < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	bool Frustum::IsInside(const glm::vec3 & center, const glm::vec3 & halfSize) const
+	{
+		for (const auto & plane : m_planes)
+		{
+			//the whole box is on the inner side of the plane if its nearest corner is
+			float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			float radius = std::abs(plane.x) * halfSize.x + std::abs(plane.y) * halfSize.y + std::abs(plane.z) * halfSize.z;
+			if (distance - radius < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	std::size_t Frustum::CullBoxes(std::size_t count, const float * cx, const float * cy, const float * cz, const glm::vec3 & offset, const glm::vec3 & halfSize, std::uint8_t * visible) const
+	{
+		assert(visible != nullptr || count == 0);
+
+		//Same box size : the projected radius on each plane is a constant. The offset is merged in the plane distance.
+		float px[N_PLANES], py[N_PLANES], pz[N_PLANES], pw[N_PLANES];
+		for (int p = 0; p < N_PLANES; p++)
+		{
+			const auto & plane = m_planes[p];
+			px[p] = plane.x;
+			py[p] = plane.y;
+			pz[p] = plane.z;
+			pw[p] = plane.x * offset.x + plane.y * offset.y + plane.z * offset.z + plane.w
+				+ std::abs(plane.x) * halfSize.x + std::abs(plane.y) * halfSize.y + std::abs(plane.z) * halfSize.z;
+		}
+
+		std::size_t visibleCount = 0;
+		std::size_t i = 0;
+
+#ifdef BH3D_FRUSTUM_SSE
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 x = _mm_loadu_ps(cx + i);
+			const __m128 y = _mm_loadu_ps(cy + i);
+			const __m128 z = _mm_loadu_ps(cz + i);
+
+			__m128 outside = _mm_setzero_ps();
+			for (int p = 0; p < N_PLANES; p++)
+			{
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(px[p])), _mm_mul_ps(y, _mm_set1_ps(py[p]))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(pz[p])), _mm_set1_ps(pw[p]))
+				);
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+			}
+
+			const int outsideMask = _mm_movemask_ps(outside);
+			for (int k = 0; k < 4; k++)
+			{
+				const std::uint8_t v = (outsideMask & (1 << k)) ? 0 : 1;
+				visible[i + k] = v;
+				visibleCount += v;
+			}
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			std::uint8_t v = 1;
+			for (int p = 0; p < N_PLANES; p++)
+			{
+				if (px[p] * cx[i] + py[p] * cy[i] + pz[p] * cz[i] + pw[p] < 0.0f)
+				{
+					v = 0;
+					break;
+				}
+			}
+			visible[i] = v;
+			visibleCount += v;
+		}
+
+		return visibleCount;
+	}
+
+}
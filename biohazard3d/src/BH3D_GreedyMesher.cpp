@@ -0,0 +1,178 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <cassert>
+#include <cstdlib>
+
+#include "BH3D_Common.hpp"
+#include "BH3D_Logger.hpp"
+#include "BH3D_GreedyMesher.hpp"
+
+namespace bh3d
+{
+
+	bool GreedyMesher::AddSubMesh(Mesh & mesh, const glm::ivec3 & dims, const std::vector<int> & vVoxels, const glm::vec3 & voxelSize, const glm::vec3 & origin, const Material *pMaterial)
+	{
+		assert(dims.x > 0 && dims.y > 0 && dims.z > 0);
+		assert(vVoxels.size() == (std::size_t)dims.x * dims.y * dims.z);
+
+		std::vector<glm::vec3> vPositions;
+		std::vector<glm::vec3> vNormals;
+		std::vector<glm::vec3> vTexCoords;
+		std::vector<Face> vFaces;
+
+		auto voxel = [&](const glm::ivec3 & p) {
+			return vVoxels[VoxelIndex(dims, p.x, p.y, p.z)];
+		};
+
+		//Sweep the voxel grid along each axis d, the faces of a slice are merged in the (u,v) plane
+		for (int d = 0; d < 3; d++)
+		{
+			const int u = (d + 1) % 3;
+			const int v = (d + 2) % 3;
+
+			glm::ivec3 x(0);
+			glm::ivec3 q(0);
+			q[d] = 1;
+
+			//mask value : 0 no face, layer + 1 for a face toward +d, -(layer + 1) for a face toward -d
+			std::vector<int> vMask((std::size_t)dims[u] * dims[v]);
+
+			for (x[d] = -1; x[d] < dims[d];)
+			{
+				//Faces between the slices x[d] and x[d] + 1
+				std::size_t n = 0;
+				for (x[v] = 0; x[v] < dims[v]; x[v]++)
+				{
+					for (x[u] = 0; x[u] < dims[u]; x[u]++, n++)
+					{
+						const int a = (x[d] >= 0) ? voxel(x) : EMPTY;
+						const int b = (x[d] < dims[d] - 1) ? voxel(x + q) : EMPTY;
+
+						if ((a != EMPTY) == (b != EMPTY))
+							vMask[n] = 0;				//interior face or no face
+						else if (a != EMPTY)
+							vMask[n] = a + 1;
+						else
+							vMask[n] = -(b + 1);
+					}
+				}
+
+				x[d]++;
+
+				//Greedy merge of the mask in rectangles
+				n = 0;
+				for (int j = 0; j < dims[v]; j++)
+				{
+					for (int i = 0; i < dims[u];)
+					{
+						const int c = vMask[n];
+						if (c == 0)
+						{
+							i++;
+							n++;
+							continue;
+						}
+
+						//width along u
+						int w = 1;
+						while (i + w < dims[u] && vMask[n + w] == c)
+							w++;
+
+						//height along v
+						int h = 1;
+						for (; j + h < dims[v]; h++)
+						{
+							bool full_row = true;
+							for (int k = 0; k < w && full_row; k++)
+								full_row = (vMask[n + k + (std::size_t)h * dims[u]] == c);
+							if (!full_row)
+								break;
+						}
+
+						//Quad
+						glm::vec3 base(0.0f), du(0.0f), dv(0.0f);
+						base[d] = (float)x[d];
+						base[u] = (float)i;
+						base[v] = (float)j;
+						du[u] = (float)w;
+						dv[v] = (float)h;
+
+						const glm::vec3 corners[4] = { base, base + du, base + du + dv, base + dv };
+						const glm::vec2 coords[4] = { {0.0f, 0.0f}, {(float)w, 0.0f}, {(float)w, (float)h}, {0.0f, (float)h} };
+						const float layer = (float)(std::abs(c) - 1);
+
+						glm::vec3 normal(0.0f);
+						normal[d] = (c > 0) ? 1.0f : -1.0f;
+
+						const unsigned int first = (unsigned int)vPositions.size();
+						for (int k = 0; k < 4; k++)
+						{
+							vPositions.push_back(origin + corners[k] * voxelSize);
+							vNormals.push_back(normal);
+							vTexCoords.push_back({ coords[k], layer });
+						}
+
+						//counter clockwise seen from the normal side
+						if (c > 0)
+						{
+							vFaces.push_back({ first, first + 1, first + 2 });
+							vFaces.push_back({ first, first + 2, first + 3 });
+						}
+						else
+						{
+							vFaces.push_back({ first, first + 2, first + 1 });
+							vFaces.push_back({ first, first + 3, first + 2 });
+						}
+
+						//Clear the merged part of the mask
+						for (int l = 0; l < h; l++)
+							for (int k = 0; k < w; k++)
+								vMask[n + k + (std::size_t)l * dims[u]] = 0;
+
+						i += w;
+						n += w;
+					}
+				}
+			}
+		}
+
+		if (vFaces.empty())
+		{
+			BH3D_LOGGER_WARNING("No face to bake (empty voxel grid)");
+			return BH3D_ERROR;
+		}
+
+		return mesh.AddSubMesh(
+			vFaces.size(), vFaces[0].id,
+			vPositions.size(), &vPositions[0].x,
+			&vTexCoords[0].x, 3,
+			&vNormals[0].x,
+			nullptr, 0,
+			pMaterial
+		);
+	}
+
+}
@@ -0,0 +1,214 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <cassert>
+
+#include "BH3D_JobSystem.hpp"
+
+namespace bh3d
+{
+
+	namespace
+	{
+		//Worker index of the current thread in its job system
+		thread_local const JobSystem * t_jobSystem = nullptr;
+		thread_local int t_workerIndex = -1;
+	}
+
+	JobSystem::JobSystem(unsigned int workerCount)
+	{
+		for (unsigned int i = 0; i <= workerCount; i++)
+			m_vQueues.push_back(std::make_unique<WorkQueue>());
+
+		m_vWorkers.reserve(workerCount);
+		for (unsigned int i = 0; i < workerCount; i++)
+			m_vWorkers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_wakeMutex);
+			m_running = false;
+		}
+		m_wakeCondition.notify_all();
+
+		for (auto & worker : m_vWorkers)
+			worker.join();
+
+		//Jobs pushed without any worker
+		Job job;
+		while (Pop(job))
+			Execute(job);
+	}
+
+	JobSystem & JobSystem::Default()
+	{
+		static JobSystem jobSystem;
+		return jobSystem;
+	}
+
+	unsigned int JobSystem::DefaultWorkerCount()
+	{
+		const unsigned int hardware = std::thread::hardware_concurrency();
+		return (hardware > 1) ? hardware - 1 : 0;
+	}
+
+	int JobSystem::CurrentWorker() const
+	{
+		return (t_jobSystem == this) ? t_workerIndex : -1;
+	}
+
+	void JobSystem::Run(Job job, JobCounter * counter, JobCounter * dependency)
+	{
+		assert(job);
+
+		if (counter != nullptr)
+		{
+			counter->m_count.fetch_add(1, std::memory_order_relaxed);
+			job = [this, counter, fct = std::move(job)]() {
+				fct();
+
+				std::vector<Job> vContinuations;
+				{
+					std::lock_guard<std::mutex> lock(counter->m_mutex);
+					if (counter->m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+						vContinuations.swap(counter->m_vContinuations);
+				}
+				for (auto & continuation : vContinuations)
+					Push(std::move(continuation));
+			};
+		}
+
+		if (dependency != nullptr)
+		{
+			std::lock_guard<std::mutex> lock(dependency->m_mutex);
+			if (!dependency->IsDone())
+			{
+				dependency->m_vContinuations.push_back(std::move(job));
+				return;
+			}
+		}
+
+		Push(std::move(job));
+	}
+
+	void JobSystem::Wait(JobCounter & counter)
+	{
+		Job job;
+		while (!counter.IsDone())
+		{
+			if (Pop(job))
+				Execute(job);
+			else
+				std::this_thread::yield();
+		}
+
+		//The last job may still hold the counter mutex
+		std::lock_guard<std::mutex> lock(counter.m_mutex);
+	}
+
+	void JobSystem::Push(Job job)
+	{
+		const int worker = CurrentWorker();
+		WorkQueue & queue = *m_vQueues[(worker >= 0) ? worker : m_vQueues.size() - 1];
+		{
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			queue.m_jobs.push_back(std::move(job));
+		}
+
+		m_pendingJobs.fetch_add(1, std::memory_order_release);
+		{
+			std::lock_guard<std::mutex> lock(m_wakeMutex);
+		}
+		m_wakeCondition.notify_one();
+	}
+
+	bool JobSystem::Pop(Job & job)
+	{
+		if (m_pendingJobs.load(std::memory_order_acquire) <= 0)
+			return false;
+
+		//Own queue first (newest job), then steal the oldest job of the others
+		const int worker = CurrentWorker();
+		const std::size_t queueCount = m_vQueues.size();
+		const std::size_t own = (worker >= 0) ? (std::size_t)worker : queueCount - 1;
+
+		{
+			WorkQueue & queue = *m_vQueues[own];
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			if (!queue.m_jobs.empty())
+			{
+				job = std::move(queue.m_jobs.back());
+				queue.m_jobs.pop_back();
+				m_pendingJobs.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		for (std::size_t i = 1; i < queueCount; i++)
+		{
+			WorkQueue & queue = *m_vQueues[(own + i) % queueCount];
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			if (!queue.m_jobs.empty())
+			{
+				job = std::move(queue.m_jobs.front());
+				queue.m_jobs.pop_front();
+				m_pendingJobs.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void JobSystem::Execute(Job & job)
+	{
+		job();
+		job = nullptr;
+	}
+
+	void JobSystem::WorkerLoop(unsigned int index)
+	{
+		t_jobSystem = this;
+		t_workerIndex = (int)index;
+
+		Job job;
+		for (;;)
+		{
+			if (Pop(job))
+			{
+				Execute(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_wakeCondition.wait(lock, [this]() { return !m_running || m_pendingJobs.load(std::memory_order_acquire) > 0; });
+			if (!m_running && m_pendingJobs.load(std::memory_order_acquire) <= 0)
+				return;
+		}
+	}
+
+}
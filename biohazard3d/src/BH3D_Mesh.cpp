@@ -24,10 +24,16 @@
  */
 
 #include <algorithm>
+#include <cstring>
+#include <limits>
+#include <mutex>
+
+#include <glm/gtc/packing.hpp>
 
 #include "BH3D_Common.hpp"
 #include "BH3D_Logger.hpp"
 #include "BH3D_Mesh.hpp"
+#include "BH3D_JobSystem.hpp"
 
 #define BH3D_BUFFER_OFFSET(i) ((void*)(i))
 
@@ -35,9 +41,140 @@ namespace bh3d
 {
 
 	namespace {
+		constexpr std::size_t VERTEX_JOB_GRAIN = 16384;		//Minimal vertex number of a parallel job
+
 		auto BH3D_VertexPtr = [](const auto & v) {
 			return v.empty() ? nullptr : v.data();
 		};
+
+		//Storage of an attribute in the interleaved vertices
+		enum class VertexEncoding
+		{
+			FLOAT32,			//copy of the floats
+			SNORM16,			//normalized shorts of (value - center) * invExtent
+			UNORM16,			//normalized unsigned shorts
+			HALF,				//half floats
+			SNORM_2_10_10_10,	//3 normalized components of 10 bits (w = 0)
+			UNORM8				//4 normalized unsigned bytes (alpha = 1 for 3 components)
+		};
+
+		//Attribute stream of the mesh copied in the interleaved vertices
+		struct VertexStream
+		{
+			GLuint index = 0;
+			GLuint size = 0;				//float number by vertex
+			const float * data = nullptr;
+			std::size_t count = 0;			//vertex number
+			VertexEncoding encoding = VertexEncoding::FLOAT32;
+			glm::vec3 center = glm::vec3(0.0f);		//SNORM16 only
+			glm::vec3 invExtent = glm::vec3(1.0f);	//SNORM16 only
+
+			GLuint GetComponents() const {
+				return (encoding == VertexEncoding::SNORM_2_10_10_10 || encoding == VertexEncoding::UNORM8) ? 4 : size;
+			}
+
+			GLenum GetType() const {
+				switch (encoding)
+				{
+				case VertexEncoding::SNORM16: return GL_SHORT;
+				case VertexEncoding::UNORM16: return GL_UNSIGNED_SHORT;
+				case VertexEncoding::HALF: return GL_HALF_FLOAT;
+				case VertexEncoding::SNORM_2_10_10_10: return GL_INT_2_10_10_10_REV;
+				case VertexEncoding::UNORM8: return GL_UNSIGNED_BYTE;
+				default: return GL_FLOAT;
+				}
+			}
+
+			//Byte size in the interleaved vertex, each attribute stays aligned on 4 bytes
+			GLuint GetByteSize() const {
+				switch (encoding)
+				{
+				case VertexEncoding::SNORM16: case VertexEncoding::UNORM16: case VertexEncoding::HALF: return (size * 2 + 3) & ~3u;
+				case VertexEncoding::SNORM_2_10_10_10: case VertexEncoding::UNORM8: return 4;
+				default: return size * (GLuint)sizeof(float);
+				}
+			}
+
+			AttribType GetInType() const {
+				return (encoding == VertexEncoding::FLOAT32 || encoding == VertexEncoding::HALF) ? AttribType::FLOAT : AttribType::NORMALIZED;
+			}
+
+			//Writes the vertices [begin, end[ in the interleaved array
+			void Encode(std::size_t begin, std::size_t end, std::uint8_t * dst, std::size_t stride) const
+			{
+				const float * src = data + begin * size;
+				for (std::size_t i = begin; i < end; i++, dst += stride, src += size)
+				{
+					switch (encoding)
+					{
+					case VertexEncoding::FLOAT32:
+						std::memcpy(dst, src, size * sizeof(float));
+						break;
+					case VertexEncoding::SNORM16:
+						for (GLuint c = 0; c < size; c++)
+						{
+							const std::uint16_t v = glm::packSnorm1x16((src[c] - center[c]) * invExtent[c]);
+							std::memcpy(dst + c * 2, &v, 2);
+						}
+						break;
+					case VertexEncoding::UNORM16:
+						for (GLuint c = 0; c < size; c++)
+						{
+							const std::uint16_t v = glm::packUnorm1x16(src[c]);
+							std::memcpy(dst + c * 2, &v, 2);
+						}
+						break;
+					case VertexEncoding::HALF:
+						for (GLuint c = 0; c < size; c++)
+						{
+							const std::uint16_t v = glm::packHalf1x16(src[c]);
+							std::memcpy(dst + c * 2, &v, 2);
+						}
+						break;
+					case VertexEncoding::SNORM_2_10_10_10:
+					{
+						const std::uint32_t v = glm::packSnorm3x10_1x2(glm::vec4(src[0], src[1], src[2], 0.0f));
+						std::memcpy(dst, &v, 4);
+						break;
+					}
+					case VertexEncoding::UNORM8:
+					{
+						const std::uint32_t v = glm::packUnorm4x8(glm::vec4(src[0], src[1], src[2], size == 4 ? src[3] : 1.0f));
+						std::memcpy(dst, &v, 4);
+						break;
+					}
+					}
+				}
+			}
+		};
+
+		template<typename Element>
+		VertexStream MakeVertexStream(const std::vector<typename Element::value_type> & vData, VertexEncoding encoding = VertexEncoding::FLOAT32)
+		{
+			static_assert(Element::type == GL_FLOAT, "The mesh streams are float vectors");
+			VertexStream stream;
+			stream.index = Element::index;
+			stream.size = Element::size;
+			stream.data = (const float*)vData.data();
+			stream.count = vData.size();
+			stream.encoding = encoding;
+			return stream;
+		}
+
+		//UNORM16 if all the coordinates are in [0, 1] (no texture repeat), else half floats
+		template<typename T>
+		VertexEncoding TexCoordEncoding(const std::vector<T> & vTexCoords)
+		{
+			for (const auto & coord : vTexCoords)
+			{
+				for (int c = 0; c < T::length(); c++)
+				{
+					if (coord[c] < 0.0f || coord[c] > 1.0f)
+						return VertexEncoding::HALF;
+				}
+			}
+			return VertexEncoding::UNORM16;
+		}
 	}
 
 	Mesh::~Mesh()
@@ -166,25 +303,52 @@ namespace bh3d
 		//construction du vbo
 		//
 
-		m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::POSITION, m_vPositions);
+		std::vector<std::uint8_t> vInterleaved;	//have to stay valid until the VBO creation
+		m_dequantization = glm::mat4(1.0f);
 
-		if (m_vNormals.size())
-			m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::NORMAL, m_vNormals);
+		const bool packed = m_vertexCompression.positions || m_vertexCompression.normals || m_vertexCompression.texCoords || m_vertexCompression.colors;
+		if (m_vertexLayout == VertexLayout::INTERLEAVED || packed)
+		{
+			AddInterleavedArrayBufferData(vInterleaved);
+		}
+		else
+		{
+			m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::POSITION, m_vPositions);
 
-		if (m_vTexCoords2.size())
-			m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::COORD0, m_vTexCoords2);
-		else if (m_vTexCoords3.size())
-			m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::COORD0, m_vTexCoords3);
+			if (m_vNormals.size())
+				m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::NORMAL, m_vNormals);
 
-		if (m_vColors3.size())
-			m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::COLOR, m_vColors3);
-		else if (m_vColors4.size())
-			m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::COLOR, m_vColors4);
+			if (m_vTexCoords2.size())
+				m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::COORD0, m_vTexCoords2);
+			else if (m_vTexCoords3.size())
+				m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::COORD0, m_vTexCoords3);
 
-		if (m_vTangents.size())
-			m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::DATA0, m_vTangents);
+			if (m_vColors3.size())
+				m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::COLOR, m_vColors3);
+			else if (m_vColors4.size())
+				m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::COLOR, m_vColors4);
+
+			if (m_vTangents.size())
+				m_vbo.AddArrayBufferData((GLuint)bh3d::ATTRIB_INDEX::DATA0, m_vTangents);
+		}
 
-		m_vbo.AddElementBufferData(m_vFaces[0].id, m_vFaces.size() * 3);
+		//The indices are global to the mesh : 16 bits indices if the last vertex id fits in it
+		std::vector<std::uint16_t> vShortIndices;	//have to stay valid until the VBO creation
+		if (m_vertexCompression.indices && m_vPositions.size() <= std::numeric_limits<std::uint16_t>::max() + std::size_t(1))
+		{
+			vShortIndices.resize(m_vFaces.size() * 3);
+			const unsigned int * pIndices = m_vFaces[0].id;
+			for (std::size_t i = 0; i < vShortIndices.size(); i++)
+				vShortIndices[i] = (std::uint16_t)pIndices[i];
+
+			m_vbo.AddElementBufferData(vShortIndices.data(), vShortIndices.size() * sizeof(std::uint16_t), GL_UNSIGNED_SHORT);
+			m_indexType = GL_UNSIGNED_SHORT;
+		}
+		else
+		{
+			m_vbo.AddElementBufferData(m_vFaces[0].id, m_vFaces.size() * 3);
+			m_indexType = GL_UNSIGNED_INT;
+		}
 		
 		if (m_vbo.Create())
 		{
@@ -202,6 +366,82 @@ namespace bh3d
 
 
 
+	void Mesh::AddInterleavedArrayBufferData(std::vector<std::uint8_t> & vInterleaved)
+	{
+		const VertexCompression & compression = m_vertexCompression;
+		const VertexEncoding directionEncoding = compression.normals ? VertexEncoding::SNORM_2_10_10_10 : VertexEncoding::FLOAT32;
+
+		//Same attribute choice as the separate layout (2D texture coordinates and RGB colors first)
+		std::vector<VertexStream> vStreams;
+		vStreams.push_back(MakeVertexStream<VertexElement<ATTRIB_INDEX::POSITION, glm::vec3>>(m_vPositions));
+
+		if (compression.positions)
+		{
+			//Positions in [-1, 1] relative to the bounding box (ComputeMesh updated it), the dequantization matrix goes back to the mesh space
+			glm::vec3 extent = 0.5f * m_boundingBox.size;
+			for (int c = 0; c < 3; c++)
+			{
+				if (extent[c] <= 0.0f)
+					extent[c] = 1.0f;	//flat mesh on this axis
+			}
+
+			vStreams.back().encoding = VertexEncoding::SNORM16;
+			vStreams.back().center = m_boundingBox.position;
+			vStreams.back().invExtent = 1.0f / extent;
+
+			m_dequantization = glm::mat4(1.0f);
+			m_dequantization[0][0] = extent.x;
+			m_dequantization[1][1] = extent.y;
+			m_dequantization[2][2] = extent.z;
+			m_dequantization[3] = glm::vec4(m_boundingBox.position, 1.0f);
+		}
+
+		if (m_vNormals.size())
+			vStreams.push_back(MakeVertexStream<VertexElement<ATTRIB_INDEX::NORMAL, glm::vec3>>(m_vNormals, directionEncoding));
+
+		if (m_vTexCoords2.size())
+			vStreams.push_back(MakeVertexStream<VertexElement<ATTRIB_INDEX::COORD0, glm::vec2>>(m_vTexCoords2, compression.texCoords ? TexCoordEncoding(m_vTexCoords2) : VertexEncoding::FLOAT32));
+		else if (m_vTexCoords3.size())
+			vStreams.push_back(MakeVertexStream<VertexElement<ATTRIB_INDEX::COORD0, glm::vec3>>(m_vTexCoords3, compression.texCoords ? TexCoordEncoding(m_vTexCoords3) : VertexEncoding::FLOAT32));
+
+		const VertexEncoding colorEncoding = compression.colors ? VertexEncoding::UNORM8 : VertexEncoding::FLOAT32;
+		if (m_vColors3.size())
+			vStreams.push_back(MakeVertexStream<VertexElement<ATTRIB_INDEX::COLOR, glm::vec3>>(m_vColors3, colorEncoding));
+		else if (m_vColors4.size())
+			vStreams.push_back(MakeVertexStream<VertexElement<ATTRIB_INDEX::COLOR, glm::vec4>>(m_vColors4, colorEncoding));
+
+		if (m_vTangents.size())
+			vStreams.push_back(MakeVertexStream<VertexElement<ATTRIB_INDEX::DATA0, glm::vec3>>(m_vTangents, directionEncoding));
+
+		const std::size_t nStreams = vStreams.size();
+		std::vector<GLuint> vAttribIndex(nStreams), vAttribSize(nStreams), vAttribOffset(nStreams);
+		std::vector<GLenum> vAttribType(nStreams);
+		std::vector<AttribType> vAttribInType(nStreams);
+
+		GLuint stride = 0;	//byte size of an interleaved vertex
+		for (std::size_t k = 0; k < nStreams; k++)
+		{
+			assert(vStreams[k].count == m_vPositions.size() && "Each attribute stream needs one value per vertex");
+			vAttribIndex[k] = vStreams[k].index;
+			vAttribSize[k] = vStreams[k].GetComponents();
+			vAttribType[k] = vStreams[k].GetType();
+			vAttribInType[k] = vStreams[k].GetInType();
+			vAttribOffset[k] = stride;
+			stride += vStreams[k].GetByteSize();
+		}
+
+		const std::size_t nVertices = m_vPositions.size();
+		vInterleaved.assign(nVertices * stride, 0);
+
+		//The vertices are independent : the ranges are packed by the job system workers
+		JobSystem::Default().ParallelFor(0, nVertices, VERTEX_JOB_GRAIN, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t k = 0; k < nStreams; k++)
+				vStreams[k].Encode(begin, end, vInterleaved.data() + begin * stride + vAttribOffset[k], stride);
+		});
+
+		m_vbo.AddStructArrayBufferData((GLuint)nStreams, vAttribIndex, vAttribType, vAttribSize, vAttribOffset, stride, vInterleaved.size(), vInterleaved.data(), vAttribInType);
+	}
+
 	void Mesh::Destroy()
 	{
 
@@ -209,6 +449,9 @@ namespace bh3d
 
 		m_vSubMeshes.clear();
 		m_computed = 0;
+		m_dequantization = glm::mat4(1.0f);
+		m_indexType = GL_UNSIGNED_INT;
+		m_lodSubMeshCount = 0;
 
 		m_vPositions.clear();
 		m_vNormals.clear();
@@ -217,6 +460,7 @@ namespace bh3d
 		m_vColors3.clear();
 		m_vColors4.clear();
 		m_vTangents.clear();
+		m_vFaces.clear();
 
 		m_reserveFaceNumber = 0;
 		m_reserveVertexNumber = 0;
@@ -228,6 +472,12 @@ namespace bh3d
 
 	bool Mesh::LoadSubMesh(std::size_t nFaces, const unsigned int *pvFaces, std::size_t nVertices, const float * pvPositions, const float * pvTexCoords, char textureFormat, const float * pvNormals, const float *pvColors, char colorFormat, const Material *pMaterial)
 	{
+		if (m_lodSubMeshCount)
+		{
+			BH3D_LOGGER_ERROR("The submeshes have to be added before the LODs");
+			return BH3D_ERROR;
+		}
+
 		//les donn�es de chaque groupe doivent avoir le m�me format de vertex (4,3,2...)
 		if (m_vSubMeshes.size())
 		{
@@ -399,22 +649,62 @@ namespace bh3d
 		m_boundingBox.Reset();
 	}
 	void Mesh::Draw() const
+	{
+		DrawLod(0);
+	}
+
+	void Mesh::DrawLod(unsigned int lod) const
 	{
 		assert(IsValid() && "No valid Mesh, can't draw it");
+		assert(lod < GetLodCount());
+
+		const std::size_t count = GetLodSubMeshCount();
 		m_vbo.Enable();
-		for (const auto subMesh : m_vSubMeshes)
+		for (std::size_t i = lod * count; i < (lod + 1) * count; i++)
 		{
+			const auto & subMesh = m_vSubMeshes[i];
 
 			subMesh.nMaterial.Bind();
 
-			glDrawElements(GL_TRIANGLES, (GLsizei)subMesh.nFaces * 3, GL_UNSIGNED_INT, BH3D_BUFFER_OFFSET(subMesh.faceOffset * 3 * sizeof(unsigned int)));
-			
+			glDrawElements(GL_TRIANGLES, (GLsizei)subMesh.nFaces * 3, m_indexType, BH3D_BUFFER_OFFSET(GetIndexByteOffset(subMesh)));
 		}
 #ifndef NDEBUG
 		m_vbo.Disable();
 #endif
 	}
 
+	bool Mesh::AddLod(const std::vector<std::vector<Face>> & vLodFaces)
+	{
+		const std::size_t count = GetLodSubMeshCount();
+		if (count == 0 || vLodFaces.size() != count)
+		{
+			BH3D_LOGGER_ERROR("A LOD needs a face list for each submesh of the LOD 0");
+			return BH3D_ERROR;
+		}
+
+		m_computed = 0;
+		m_lodSubMeshCount = count;
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			Mesh::SubMesh subMesh = m_vSubMeshes[i];	//same material and vertices as the LOD 0
+			subMesh.faceOffset = m_vFaces.size();
+			subMesh.nFaces = vLodFaces[i].size();
+
+#ifndef NDEBUG
+			for (const auto & face : vLodFaces[i])
+			{
+				for (auto id : face.id)
+					assert(id >= subMesh.vertexOffset && id < subMesh.vertexOffset + subMesh.nVertices && "The LOD faces have to use the vertices of their submesh");
+			}
+#endif
+			m_vFaces.insert(m_vFaces.end(), vLodFaces[i].begin(), vLodFaces[i].end());
+			m_vSubMeshes.push_back(subMesh);
+		}
+
+		return BH3D_OK;
+	}
+
 	void Mesh::DrawSubMesh(unsigned int id) const
 	{
 
@@ -423,7 +713,7 @@ namespace bh3d
 		m_vbo.Enable();
 		m_vSubMeshes[id].nMaterial.Bind();
 
-		glDrawElements(GL_TRIANGLES, (GLsizei)m_vSubMeshes[id].nFaces * 3, GL_UNSIGNED_INT, BH3D_BUFFER_OFFSET( m_vSubMeshes[id].faceOffset * 3 * sizeof(unsigned int)) );
+		glDrawElements(GL_TRIANGLES, (GLsizei)m_vSubMeshes[id].nFaces * 3, m_indexType, BH3D_BUFFER_OFFSET(GetIndexByteOffset(m_vSubMeshes[id])));
 
 #ifndef NDEBUG
 		m_vbo.Disable();
@@ -443,7 +733,7 @@ namespace bh3d
 
 			m_vSubMeshes[i].nMaterial.Bind();
 
-			glDrawElements(GL_TRIANGLES, (GLsizei)m_vSubMeshes[i].nFaces * 3, GL_UNSIGNED_INT, BH3D_BUFFER_OFFSET(m_vSubMeshes[i].faceOffset * 3 * sizeof(unsigned int)));
+			glDrawElements(GL_TRIANGLES, (GLsizei)m_vSubMeshes[i].nFaces * 3, m_indexType, BH3D_BUFFER_OFFSET(GetIndexByteOffset(m_vSubMeshes[i])));
 
 		}
 #ifndef NDEBUG
@@ -459,16 +749,22 @@ namespace bh3d
 		if (m_boundingBox.IsValid()) 
 			return m_boundingBox;
 
+		//Min/max of each vertex range in parallel, then of the ranges
+		std::mutex mutex;
 		glm::vec3 vmin, vmax;
 		vmin = vmax = m_vPositions[0]; //initialisation
-		for (const auto & v : m_vPositions)
-		{
-			for (int j = 0; j < 3; j++) //pour chacune des composantes
+		JobSystem::Default().ParallelFor(0, m_vPositions.size(), VERTEX_JOB_GRAIN, [&](std::size_t begin, std::size_t end) {
+			glm::vec3 range_min, range_max;
+			range_min = range_max = m_vPositions[begin];
+			for (std::size_t i = begin; i < end; i++)
 			{
-				if (vmin[j] > v[j]) vmin[j] = v[j];
-				else if (vmax[j] < v[j]) vmax[j] = v[j];
+				range_min = glm::min(range_min, m_vPositions[i]);
+				range_max = glm::max(range_max, m_vPositions[i]);
 			}
-		}
+			std::lock_guard<std::mutex> lock(mutex);
+			vmin = glm::min(vmin, range_min);
+			vmax = glm::max(vmax, range_max);
+		});
 
 		m_boundingBox.size = (vmax - vmin);
 		m_boundingBox.position = 0.5f*(vmax + vmin);
@@ -538,7 +834,7 @@ namespace bh3d
 		m_computed = 0;
 		m_boundingBox.Reset();
 
-		std::size_t i, start = 0, end = m_vPositions.size();
+		std::size_t start = 0, end = m_vPositions.size();
 
 		if (submeshid.value_or(m_vSubMeshes.size()) < m_vSubMeshes.size())
 		{
@@ -546,20 +842,24 @@ namespace bh3d
 			end = start + m_vSubMeshes[submeshid.value()].nVertices;
 		}
 
-		for (i = start; i < end; i++)
-			m_vPositions[i] = glm::vec3(transform*glm::vec4(m_vPositions[i], 1));
+		//The vertices are independent : the ranges are transformed by the job system workers
+		JobSystem::Default().ParallelFor(start, end, VERTEX_JOB_GRAIN, [&](std::size_t range_begin, std::size_t range_end) {
+			std::size_t i;
+			for (i = range_begin; i < range_end; i++)
+				m_vPositions[i] = glm::vec3(transform*glm::vec4(m_vPositions[i], 1));
 
-		if (m_vNormals.size())
-		{
-			for (i = start; i < end; i++)
-				m_vNormals[i] = glm::vec3(transform*glm::vec4(m_vNormals[i], 0));
-		}
+			if (m_vNormals.size())
+			{
+				for (i = range_begin; i < range_end; i++)
+					m_vNormals[i] = glm::vec3(transform*glm::vec4(m_vNormals[i], 0));
+			}
 
-		if (m_vTangents.size())
-		{
-			for (i = start; i < end; i++)
-				m_vTangents[i] = glm::vec3(transform*glm::vec4(m_vTangents[i], 0));
-		}
+			if (m_vTangents.size())
+			{
+				for (i = range_begin; i < range_end; i++)
+					m_vTangents[i] = glm::vec3(transform*glm::vec4(m_vTangents[i], 0));
+			}
+		});
 	}
 
 	void Mesh::TranslateMesh(const glm::vec3 &translation, UOptionalUInt submeshid)
@@ -0,0 +1,459 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "BH3D_Common.hpp"
+#include "BH3D_Logger.hpp"
+#include "BH3D_MeshOptimizer.hpp"
+
+namespace bh3d
+{
+
+	namespace {
+		constexpr unsigned int NO_INDEX = std::numeric_limits<unsigned int>::max();
+		constexpr std::size_t NO_TRIANGLE = std::numeric_limits<std::size_t>::max();
+
+		//Forsyth score parameters (see "Linear-Speed Vertex Cache Optimisation", Tom Forsyth)
+		constexpr int FORSYTH_CACHE_SIZE = 32;
+		constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+		constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+		constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+		constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+		//Score of a vertex from its position in the LRU cache (-1 : outside) and its number of triangles not yet emitted
+		float ForsythVertexScore(int cachePosition, unsigned int remainingTriangles)
+		{
+			if (remainingTriangles == 0)
+				return -1.0f;		//no triangle left to use it
+
+			float score = 0.0f;
+			if (cachePosition >= 0)
+			{
+				if (cachePosition < 3)
+					score = FORSYTH_LAST_TRIANGLE_SCORE;	//vertices of the last triangle : fixed score to avoid strips
+				else
+					score = std::pow(1.0f - (float)(cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+			}
+
+			//Vertices with few triangles left are finished first
+			score += FORSYTH_VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+			return score;
+		}
+
+		//FIFO post transform cache simulated with timestamps
+		class FifoCache
+		{
+			std::vector<unsigned int> m_vTimestamps;
+			unsigned int m_cacheSize;
+			unsigned int m_time;
+
+		public:
+			FifoCache(std::size_t nVertices, unsigned int cacheSize) :
+				m_vTimestamps(nVertices, 0), m_cacheSize(cacheSize), m_time(cacheSize + 1)
+			{}
+
+			//Empties the cache
+			void Reset() { m_time += m_cacheSize + 1; }
+
+			//Number of vertices of the triangle transformed (0 to 3)
+			unsigned int Misses(const unsigned int * pTriangle)
+			{
+				unsigned int misses = 0;
+				for (int k = 0; k < 3; k++)
+				{
+					const unsigned int v = pTriangle[k];
+					if (m_time - m_vTimestamps[v] > m_cacheSize)
+					{
+						m_vTimestamps[v] = m_time++;
+						misses++;
+					}
+				}
+				return misses;
+			}
+		};
+
+		//Reorders a vertex stream of a submesh (only if the stream is used by all the vertices)
+		template<typename T>
+		void RemapStream(std::vector<T> & vStream, std::size_t vertexCount, std::size_t offset, const std::vector<unsigned int> & vRemap)
+		{
+			if (vStream.size() == vertexCount)
+				MeshOptimizer::RemapVertices(vStream.data() + offset, vRemap);
+		}
+	}
+
+	float MeshOptimizer::ComputeACMR(const unsigned int * pIndices, std::size_t nIndices, std::size_t nVertices, unsigned int cacheSize)
+	{
+		assert(nIndices % 3 == 0);
+		if (nIndices < 3)
+			return 0.0f;
+
+		FifoCache cache(nVertices, cacheSize);
+		std::size_t misses = 0;
+		for (std::size_t i = 0; i < nIndices; i += 3)
+			misses += cache.Misses(pIndices + i);
+
+		return (float)misses / (float)(nIndices / 3);
+	}
+
+	void MeshOptimizer::OptimizeVertexCache(unsigned int * pIndices, std::size_t nIndices, std::size_t nVertices)
+	{
+		assert(nIndices % 3 == 0);
+		const std::size_t nTriangles = nIndices / 3;
+		if (nTriangles == 0)
+			return;
+
+		//Triangles not yet emitted of each vertex v : vTriangles[vOffsets[v], vOffsets[v] + vRemaining[v][
+		std::vector<unsigned int> vRemaining(nVertices, 0);
+		for (std::size_t i = 0; i < nIndices; i++)
+		{
+			assert(pIndices[i] < nVertices);
+			vRemaining[pIndices[i]]++;
+		}
+
+		std::vector<std::size_t> vOffsets(nVertices + 1, 0);
+		for (std::size_t v = 0; v < nVertices; v++)
+			vOffsets[v + 1] = vOffsets[v] + vRemaining[v];
+
+		std::vector<std::size_t> vTriangles(nIndices);
+		{
+			std::vector<std::size_t> vFill(vOffsets.begin(), vOffsets.end() - 1);
+			for (std::size_t i = 0; i < nIndices; i++)
+				vTriangles[vFill[pIndices[i]]++] = i / 3;
+		}
+
+		std::vector<float> vVertexScore(nVertices);
+		for (std::size_t v = 0; v < nVertices; v++)
+			vVertexScore[v] = ForsythVertexScore(-1, vRemaining[v]);
+
+		std::vector<float> vTriangleScore(nTriangles);
+		std::vector<std::uint8_t> vEmitted(nTriangles, 0);
+		std::size_t best = 0;
+		for (std::size_t t = 0; t < nTriangles; t++)
+		{
+			vTriangleScore[t] = vVertexScore[pIndices[t * 3]] + vVertexScore[pIndices[t * 3 + 1]] + vVertexScore[pIndices[t * 3 + 2]];
+			if (vTriangleScore[t] > vTriangleScore[best])
+				best = t;
+		}
+
+		std::vector<unsigned int> vOutput;
+		vOutput.reserve(nIndices);
+
+		unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+		unsigned int newCache[FORSYTH_CACHE_SIZE + 3];
+		int cacheCount = 0;
+		std::size_t cursor = 0;		//all the triangles before are emitted
+
+		for (std::size_t count = 0; count < nTriangles; count++)
+		{
+			//No candidate in the cache : next triangle not yet emitted
+			if (best == NO_TRIANGLE)
+			{
+				while (vEmitted[cursor])
+					cursor++;
+				best = cursor;
+			}
+
+			const unsigned int * pTriangle = pIndices + best * 3;
+			vOutput.insert(vOutput.end(), pTriangle, pTriangle + 3);
+			vEmitted[best] = 1;
+
+			//The triangle leaves the adjacency of its vertices
+			for (int k = 0; k < 3; k++)
+			{
+				const unsigned int v = pTriangle[k];
+				auto begin = vTriangles.begin() + vOffsets[v];
+				auto end = begin + vRemaining[v];
+				auto it = std::find(begin, end, best);
+				assert(it != end);
+				std::iter_swap(it, end - 1);
+				vRemaining[v]--;
+			}
+
+			//LRU cache : the vertices of the triangle first, then the previous entries
+			int newCount = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				if (std::find(newCache, newCache + newCount, pTriangle[k]) == newCache + newCount)
+					newCache[newCount++] = pTriangle[k];
+			}
+			for (int c = 0; c < cacheCount; c++)
+			{
+				if (cache[c] != pTriangle[0] && cache[c] != pTriangle[1] && cache[c] != pTriangle[2])
+					newCache[newCount++] = cache[c];
+			}
+
+			//Score update of the cached and evicted vertices and of their triangles
+			for (int c = 0; c < newCount; c++)
+			{
+				const unsigned int v = newCache[c];
+				const int position = (c < FORSYTH_CACHE_SIZE) ? c : -1;
+
+				const float score = ForsythVertexScore(position, vRemaining[v]);
+				const float delta = score - vVertexScore[v];
+				vVertexScore[v] = score;
+
+				for (std::size_t j = vOffsets[v]; j < vOffsets[v] + vRemaining[v]; j++)
+					vTriangleScore[vTriangles[j]] += delta;
+			}
+
+			//Best triangle among the ones of the cached vertices
+			best = NO_TRIANGLE;
+			float bestScore = -std::numeric_limits<float>::max();
+			cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+			for (int c = 0; c < cacheCount; c++)
+			{
+				const unsigned int v = newCache[c];
+				cache[c] = v;
+				for (std::size_t j = vOffsets[v]; j < vOffsets[v] + vRemaining[v]; j++)
+				{
+					const std::size_t t = vTriangles[j];
+					if (vTriangleScore[t] > bestScore)
+					{
+						bestScore = vTriangleScore[t];
+						best = t;
+					}
+				}
+			}
+		}
+
+		std::copy(vOutput.begin(), vOutput.end(), pIndices);
+	}
+
+	void MeshOptimizer::OptimizeOverdraw(unsigned int * pIndices, std::size_t nIndices, const glm::vec3 * pPositions, std::size_t nVertices, float threshold)
+	{
+		assert(nIndices % 3 == 0);
+		assert(pPositions != nullptr);
+		const std::size_t nTriangles = nIndices / 3;
+		if (nTriangles < 2)
+			return;
+
+		FifoCache cache(nVertices, CACHE_SIZE);
+
+		//Hard boundaries : the triangles with 3 cache misses start a new cluster without any cache cost
+		std::vector<std::size_t> vHardBoundaries;
+		for (std::size_t t = 0; t < nTriangles; t++)
+		{
+			if (cache.Misses(pIndices + t * 3) == 3 || t == 0)
+				vHardBoundaries.push_back(t);
+		}
+
+		//Soft boundaries : a cluster is split as soon as its ACMR (with an empty cache) stays under threshold times the ACMR of the hard cluster
+		std::vector<std::size_t> vClusters;
+		for (std::size_t h = 0; h < vHardBoundaries.size(); h++)
+		{
+			const std::size_t start = vHardBoundaries[h];
+			const std::size_t end = (h + 1 < vHardBoundaries.size()) ? vHardBoundaries[h + 1] : nTriangles;
+
+			cache.Reset();
+			std::size_t misses = 0;
+			for (std::size_t t = start; t < end; t++)
+				misses += cache.Misses(pIndices + t * 3);
+			const float limit = threshold * (float)misses / (float)(end - start);
+
+			cache.Reset();
+			vClusters.push_back(start);
+			std::size_t clusterStart = start;
+			std::size_t clusterMisses = 0;
+			for (std::size_t t = start; t + 1 < end; t++)
+			{
+				clusterMisses += cache.Misses(pIndices + t * 3);
+				if ((float)clusterMisses / (float)(t + 1 - clusterStart) <= limit)
+				{
+					clusterStart = t + 1;
+					clusterMisses = 0;
+					cache.Reset();
+					vClusters.push_back(clusterStart);
+				}
+			}
+		}
+
+		//Clusters facing the outside first : sort key = distance of the cluster to the mesh center along the cluster normal
+		glm::vec3 meshCenter(0.0f);
+		for (std::size_t i = 0; i < nIndices; i++)
+			meshCenter += pPositions[pIndices[i]];
+		meshCenter /= (float)nIndices;
+
+		const std::size_t nClusters = vClusters.size();
+		std::vector<float> vSortKeys(nClusters);
+		for (std::size_t c = 0; c < nClusters; c++)
+		{
+			const std::size_t end = (c + 1 < nClusters) ? vClusters[c + 1] : nTriangles;
+
+			glm::vec3 center(0.0f), normal(0.0f);
+			float area = 0.0f;
+			for (std::size_t t = vClusters[c]; t < end; t++)
+			{
+				const glm::vec3 & p0 = pPositions[pIndices[t * 3]];
+				const glm::vec3 & p1 = pPositions[pIndices[t * 3 + 1]];
+				const glm::vec3 & p2 = pPositions[pIndices[t * 3 + 2]];
+				const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+				const float triangleArea = glm::length(n);
+
+				center += (p0 + p1 + p2) * (triangleArea / 3.0f);
+				normal += n;
+				area += triangleArea;
+			}
+
+			const float normalLength = glm::length(normal);
+			vSortKeys[c] = (area > 0.0f && normalLength > 0.0f) ? glm::dot(center / area - meshCenter, normal / normalLength) : 0.0f;
+		}
+
+		std::vector<std::size_t> vOrder(nClusters);
+		for (std::size_t c = 0; c < nClusters; c++)
+			vOrder[c] = c;
+		std::stable_sort(vOrder.begin(), vOrder.end(), [&vSortKeys](std::size_t a, std::size_t b) {
+			return vSortKeys[a] > vSortKeys[b];
+		});
+
+		std::vector<unsigned int> vOutput;
+		vOutput.reserve(nIndices);
+		for (auto c : vOrder)
+		{
+			const std::size_t end = (c + 1 < nClusters) ? vClusters[c + 1] : nTriangles;
+			vOutput.insert(vOutput.end(), pIndices + vClusters[c] * 3, pIndices + end * 3);
+		}
+
+		std::copy(vOutput.begin(), vOutput.end(), pIndices);
+	}
+
+	std::vector<unsigned int> MeshOptimizer::OptimizeVertexFetch(unsigned int * pIndices, std::size_t nIndices, std::size_t nVertices)
+	{
+		std::vector<unsigned int> vRemap(nVertices, NO_INDEX);
+		unsigned int next = 0;
+
+		for (std::size_t i = 0; i < nIndices; i++)
+		{
+			unsigned int & index = vRemap[pIndices[i]];
+			if (index == NO_INDEX)
+				index = next++;
+			pIndices[i] = index;
+		}
+
+		for (auto & index : vRemap)
+		{
+			if (index == NO_INDEX)
+				index = next++;
+		}
+
+		return vRemap;
+	}
+
+	MeshOptimizer::Report MeshOptimizer::Optimize(Mesh & mesh, bool overdraw)
+	{
+		Report report;
+
+		if (mesh.IsValid())
+		{
+			BH3D_LOGGER_WARNING("The mesh is already computed, optimize it before the call of ComputeMesh");
+			return report;
+		}
+
+		auto & vFaces = mesh.GetTabFace();
+		auto & vPositions = mesh.GetTabPosition();
+		if (vFaces.empty() || vPositions.empty())
+			return report;
+
+		const std::size_t vertexCount = vPositions.size();
+		//ACMR of the full mesh only : the LOD faces follow the faces of the base submeshes
+		const std::size_t lod0Faces = mesh.GetLodFaceCount(0);
+		report.acmrBefore = ComputeACMR(vFaces[0].id, lod0Faces * 3, vertexCount);
+
+		const auto & vSubMeshes = mesh.GetTabSubMeshes();
+
+		//Triangle order of each submesh (the LODs too) on indices local to the vertices of the submesh
+		for (const auto & subMesh : vSubMeshes)
+		{
+			if (subMesh.nFaces == 0 || subMesh.nVertices == 0)
+				continue;
+
+			unsigned int * pIndices = vFaces[subMesh.faceOffset].id;
+			const std::size_t nIndices = subMesh.nFaces * 3;
+			const unsigned int offset = (unsigned int)subMesh.vertexOffset;
+			for (std::size_t i = 0; i < nIndices; i++)
+			{
+				assert(pIndices[i] >= offset && pIndices[i] - offset < subMesh.nVertices);
+				pIndices[i] -= offset;
+			}
+
+			OptimizeVertexCache(pIndices, nIndices, subMesh.nVertices);
+			if (overdraw)
+				OptimizeOverdraw(pIndices, nIndices, vPositions.data() + offset, subMesh.nVertices);
+
+			for (std::size_t i = 0; i < nIndices; i++)
+				pIndices[i] += offset;
+		}
+
+		//Vertex order of the first submesh using a vertex range (the LOD 0), the other submeshes of the range (its LODs) are remapped with it
+		std::vector<std::uint8_t> vRemapped(vSubMeshes.size(), 0);
+		for (std::size_t s = 0; s < vSubMeshes.size(); s++)
+		{
+			const auto & subMesh = vSubMeshes[s];
+			if (vRemapped[s] || subMesh.nFaces == 0 || subMesh.nVertices == 0)
+				continue;
+
+			unsigned int * pIndices = vFaces[subMesh.faceOffset].id;
+			const std::size_t nIndices = subMesh.nFaces * 3;
+			const unsigned int offset = (unsigned int)subMesh.vertexOffset;
+			for (std::size_t i = 0; i < nIndices; i++)
+				pIndices[i] -= offset;
+
+			const std::vector<unsigned int> vRemap = OptimizeVertexFetch(pIndices, nIndices, subMesh.nVertices);
+			RemapStream(vPositions, vertexCount, offset, vRemap);
+			RemapStream(mesh.GetTabNormal(), vertexCount, offset, vRemap);
+			RemapStream(mesh.GetTabTexCoord2(), vertexCount, offset, vRemap);
+			RemapStream(mesh.GetTabTexCoord3(), vertexCount, offset, vRemap);
+			RemapStream(mesh.GetTabColor3(), vertexCount, offset, vRemap);
+			RemapStream(mesh.GetTabColor4(), vertexCount, offset, vRemap);
+			RemapStream(mesh.GetTabTangent(), vertexCount, offset, vRemap);
+
+			for (std::size_t i = 0; i < nIndices; i++)
+				pIndices[i] += offset;
+
+			for (std::size_t t = s + 1; t < vSubMeshes.size(); t++)
+			{
+				const auto & other = vSubMeshes[t];
+				if (other.vertexOffset != subMesh.vertexOffset || other.nFaces == 0)
+					continue;
+
+				assert(other.nVertices == subMesh.nVertices);
+				unsigned int * pOtherIndices = vFaces[other.faceOffset].id;
+				for (std::size_t i = 0; i < other.nFaces * 3; i++)
+					pOtherIndices[i] = vRemap[pOtherIndices[i] - offset] + offset;
+				vRemapped[t] = 1;
+			}
+		}
+
+		report.acmrAfter = ComputeACMR(vFaces[0].id, lod0Faces * 3, vertexCount);
+		BH3D_LOGGER("Mesh optimization - ACMR : " << report.acmrBefore << " -> " << report.acmrAfter);
+
+		return report;
+	}
+
+}
@@ -0,0 +1,403 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <sstream>
+
+#include "BH3D_Common.hpp"
+#include "BH3D_Logger.hpp"
+#include "BH3D_MeshSimplifier.hpp"
+
+namespace bh3d
+{
+
+	namespace {
+		constexpr double BORDER_WEIGHT = 10.0;		//Weight of the border planes relative to the face planes
+		constexpr float FLIP_COSINE = 0.25f;		//A collapse turning a triangle normal by more than acos(FLIP_COSINE) (~75 degrees) counts as a flip
+
+		//Symmetric 4x4 matrix summing the squared distances to a set of weighted planes
+		struct Quadric
+		{
+			double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+			double b2 = 0.0, bc = 0.0, bd = 0.0;
+			double c2 = 0.0, cd = 0.0;
+			double d2 = 0.0;
+
+			//Plane of a unit normal through a point
+			void AddPlane(const glm::vec3 & normal, const glm::vec3 & point, double weight)
+			{
+				const double a = normal.x, b = normal.y, c = normal.z;
+				const double d = -(a * point.x + b * point.y + c * point.z);
+				a2 += weight * a * a; ab += weight * a * b; ac += weight * a * c; ad += weight * a * d;
+				b2 += weight * b * b; bc += weight * b * c; bd += weight * b * d;
+				c2 += weight * c * c; cd += weight * c * d;
+				d2 += weight * d * d;
+			}
+
+			void Add(const Quadric & q)
+			{
+				a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+				b2 += q.b2; bc += q.bc; bd += q.bd;
+				c2 += q.c2; cd += q.cd;
+				d2 += q.d2;
+			}
+
+			//Weighted sum of the squared distances of a point to the planes
+			double Error(const glm::vec3 & p) const
+			{
+				const double x = p.x, y = p.y, z = p.z;
+				const double error = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+					+ b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+					+ c2 * z * z + 2.0 * cd * z
+					+ d2;
+				return error > 0.0 ? error : 0.0;
+			}
+		};
+
+		//Move of the vertex source on the vertex target
+		struct Collapse
+		{
+			unsigned int source = 0;
+			unsigned int target = 0;
+			double cost = 0.0;
+		};
+
+		//Key of an undirected edge
+		inline std::uint64_t EdgeKey(unsigned int a, unsigned int b)
+		{
+			if (a > b)
+				std::swap(a, b);
+			return ((std::uint64_t)a << 32) | b;
+		}
+	}
+
+	std::vector<unsigned int> MeshSimplifier::Simplify(const unsigned int * pIndices, std::size_t nIndices, const glm::vec3 * pPositions, const glm::vec3 * pNormals, std::size_t nVertices, std::size_t targetIndexCount, float normalWeight)
+	{
+		assert(nIndices % 3 == 0);
+		assert(pPositions != nullptr);
+
+		std::vector<unsigned int> vIndices(pIndices, pIndices + nIndices);
+		if (nIndices <= targetIndexCount || nVertices == 0)
+			return vIndices;
+
+		//Attribute seams : the vertices sharing their position are locked to keep the mesh closed
+		std::vector<std::uint8_t> vLocked(nVertices, 0);
+		{
+			std::vector<unsigned int> vSorted(nVertices);
+			std::iota(vSorted.begin(), vSorted.end(), 0u);
+			auto less = [pPositions](unsigned int a, unsigned int b) {
+				const glm::vec3 & pa = pPositions[a];
+				const glm::vec3 & pb = pPositions[b];
+				return pa.x < pb.x || (pa.x == pb.x && (pa.y < pb.y || (pa.y == pb.y && pa.z < pb.z)));
+			};
+			std::sort(vSorted.begin(), vSorted.end(), less);
+			for (std::size_t i = 1; i < nVertices; i++)
+			{
+				if (pPositions[vSorted[i]] == pPositions[vSorted[i - 1]])
+					vLocked[vSorted[i]] = vLocked[vSorted[i - 1]] = 1;
+			}
+		}
+
+		//Face planes weighted by the triangle area
+		std::vector<Quadric> vQuadrics(nVertices);
+		std::vector<double> vAreas(nVertices, 0.0);
+		for (std::size_t i = 0; i < nIndices; i += 3)
+		{
+			const glm::vec3 & p0 = pPositions[vIndices[i]];
+			const glm::vec3 n = glm::cross(pPositions[vIndices[i + 1]] - p0, pPositions[vIndices[i + 2]] - p0);
+			const float length = glm::length(n);
+			if (length <= 0.0f)
+				continue;
+
+			const double area = 0.5 * length;
+			for (int k = 0; k < 3; k++)
+			{
+				vQuadrics[vIndices[i + k]].AddPlane(n / length, p0, area);
+				vAreas[vIndices[i + k]] += area;
+			}
+		}
+
+		//Borders (edges of a single triangle) : plane through the edge, orthogonal to the face
+		{
+			std::vector<std::pair<std::uint64_t, std::size_t>> vEdges(nIndices);
+			for (std::size_t i = 0; i < nIndices; i++)
+			{
+				const std::size_t next = i - i % 3 + (i + 1) % 3;
+				vEdges[i] = { EdgeKey(vIndices[i], vIndices[next]), i };
+			}
+			std::sort(vEdges.begin(), vEdges.end());
+
+			for (std::size_t e = 0; e < nIndices; e++)
+			{
+				const bool shared = (e > 0 && vEdges[e - 1].first == vEdges[e].first) || (e + 1 < nIndices && vEdges[e + 1].first == vEdges[e].first);
+				if (shared)
+					continue;
+
+				const std::size_t i = vEdges[e].second;
+				const std::size_t first = i - i % 3;
+				const unsigned int a = vIndices[i];
+				const unsigned int b = vIndices[first + (i + 1) % 3];
+
+				const glm::vec3 & p0 = pPositions[vIndices[first]];
+				const glm::vec3 faceNormal = glm::cross(pPositions[vIndices[first + 1]] - p0, pPositions[vIndices[first + 2]] - p0);
+				const glm::vec3 edge = pPositions[b] - pPositions[a];
+				const glm::vec3 normal = glm::cross(edge, faceNormal);
+				const float length = glm::length(normal);
+				if (length <= 0.0f)
+					continue;
+
+				const double weight = BORDER_WEIGHT * glm::dot(edge, edge);
+				vQuadrics[a].AddPlane(normal / length, pPositions[a], weight);
+				vQuadrics[b].AddPlane(normal / length, pPositions[a], weight);
+			}
+		}
+
+		auto CollapseCost = [&](unsigned int source, unsigned int target) {
+			Quadric q = vQuadrics[source];
+			q.Add(vQuadrics[target]);
+			double cost = q.Error(pPositions[target]);
+			if (pNormals)
+			{
+				//Attribute error : the surface of the source takes the normal of the target
+				const glm::vec3 d = pPositions[target] - pPositions[source];
+				cost += normalWeight * (1.0 - glm::dot(pNormals[source], pNormals[target])) * glm::dot(d, d) * vAreas[source];
+			}
+			return cost;
+		};
+
+		std::vector<std::size_t> vOffsets(nVertices + 1);
+		std::vector<unsigned int> vVertexTriangles;
+		std::vector<std::uint64_t> vEdgeKeys;
+		std::vector<Collapse> vCollapses;
+		std::vector<std::uint8_t> vTouched(nVertices);
+		std::vector<unsigned int> vRemap(nVertices);
+
+		//Triangles of the source keep their orientation once the source is moved on the target
+		auto FlipsTriangles = [&](unsigned int source, unsigned int target) {
+			for (std::size_t j = vOffsets[source]; j < vOffsets[source + 1]; j++)
+			{
+				const std::size_t first = (std::size_t)vVertexTriangles[j] * 3;
+				unsigned int ids[3] = { vIndices[first], vIndices[first + 1], vIndices[first + 2] };
+				if (ids[0] == target || ids[1] == target || ids[2] == target)
+					continue;		//removed by the collapse
+
+				const glm::vec3 before = glm::cross(pPositions[ids[1]] - pPositions[ids[0]], pPositions[ids[2]] - pPositions[ids[0]]);
+				for (auto & id : ids)
+				{
+					if (id == source)
+						id = target;
+				}
+				const glm::vec3 after = glm::cross(pPositions[ids[1]] - pPositions[ids[0]], pPositions[ids[2]] - pPositions[ids[0]]);
+				if (glm::dot(before, after) <= FLIP_COSINE * glm::length(before) * glm::length(after))
+					return true;
+			}
+			return false;
+		};
+
+		//Each pass collapses the cheapest independent edges (no shared triangle) then rebuilds the triangle list
+		while (vIndices.size() > targetIndexCount)
+		{
+			std::fill(vOffsets.begin(), vOffsets.end(), 0);
+			for (auto v : vIndices)
+				vOffsets[v + 1]++;
+			for (std::size_t v = 0; v < nVertices; v++)
+				vOffsets[v + 1] += vOffsets[v];
+
+			vVertexTriangles.resize(vIndices.size());
+			{
+				std::vector<std::size_t> vFill(vOffsets.begin(), vOffsets.end() - 1);
+				for (std::size_t i = 0; i < vIndices.size(); i++)
+					vVertexTriangles[vFill[vIndices[i]]++] = (unsigned int)(i / 3);
+			}
+
+			vEdgeKeys.resize(vIndices.size());
+			for (std::size_t i = 0; i < vIndices.size(); i++)
+				vEdgeKeys[i] = EdgeKey(vIndices[i], vIndices[i - i % 3 + (i + 1) % 3]);
+			std::sort(vEdgeKeys.begin(), vEdgeKeys.end());
+			vEdgeKeys.erase(std::unique(vEdgeKeys.begin(), vEdgeKeys.end()), vEdgeKeys.end());
+
+			//Cheapest direction of each edge
+			vCollapses.clear();
+			for (auto key : vEdgeKeys)
+			{
+				const unsigned int a = (unsigned int)(key >> 32);
+				const unsigned int b = (unsigned int)(key & 0xffffffffu);
+
+				Collapse collapse;
+				collapse.cost = std::numeric_limits<double>::max();
+				if (!vLocked[a])
+					collapse = { a, b, CollapseCost(a, b) };
+				if (!vLocked[b])
+				{
+					const double cost = CollapseCost(b, a);
+					if (cost < collapse.cost)
+						collapse = { b, a, cost };
+				}
+				if (collapse.cost < std::numeric_limits<double>::max())
+					vCollapses.push_back(collapse);
+			}
+
+			std::sort(vCollapses.begin(), vCollapses.end(), [](const Collapse & c1, const Collapse & c2) {
+				return c1.cost < c2.cost;
+			});
+
+			std::fill(vTouched.begin(), vTouched.end(), 0);
+			std::iota(vRemap.begin(), vRemap.end(), 0u);
+
+			const std::size_t goal = vIndices.size() - targetIndexCount;
+			std::size_t removed = 0;
+			std::size_t collapseCount = 0;
+			for (const auto & collapse : vCollapses)
+			{
+				if (removed >= goal)
+					break;
+
+				if (vTouched[collapse.source] || vTouched[collapse.target] || FlipsTriangles(collapse.source, collapse.target))
+					continue;
+
+				//The triangles around the source change : their vertices wait for the next pass
+				for (std::size_t j = vOffsets[collapse.source]; j < vOffsets[collapse.source + 1]; j++)
+				{
+					const std::size_t first = (std::size_t)vVertexTriangles[j] * 3;
+					bool degenerate = false;
+					for (int k = 0; k < 3; k++)
+					{
+						vTouched[vIndices[first + k]] = 1;
+						degenerate |= (vIndices[first + k] == collapse.target);
+					}
+					if (degenerate)
+						removed += 3;
+				}
+
+				vRemap[collapse.source] = collapse.target;
+				vQuadrics[collapse.target].Add(vQuadrics[collapse.source]);
+				vAreas[collapse.target] += vAreas[collapse.source];
+				collapseCount++;
+			}
+
+			if (collapseCount == 0)
+				break;		//only locked vertices or flipping collapses left
+
+			std::size_t count = 0;
+			for (std::size_t i = 0; i < vIndices.size(); i += 3)
+			{
+				const unsigned int a = vRemap[vIndices[i]];
+				const unsigned int b = vRemap[vIndices[i + 1]];
+				const unsigned int c = vRemap[vIndices[i + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+				vIndices[count++] = a;
+				vIndices[count++] = b;
+				vIndices[count++] = c;
+			}
+			vIndices.resize(count);
+		}
+
+		return vIndices;
+	}
+
+	unsigned int MeshSimplifier::GenerateLods(Mesh & mesh, unsigned int lodCount, float ratio, float normalWeight)
+	{
+		assert(ratio > 0.0f && ratio < 1.0f);
+
+		if (mesh.IsValid())
+		{
+			BH3D_LOGGER_WARNING("The mesh is already computed, generate the LODs before the call of ComputeMesh");
+			return mesh.GetLodCount();
+		}
+
+		if (mesh.GetLodCount() > 1)
+		{
+			BH3D_LOGGER_WARNING("The mesh has already LODs");
+			return mesh.GetLodCount();
+		}
+
+		const std::vector<Mesh::SubMesh> vSubMeshes = mesh.GetTabSubMeshes();	//copy : AddLod adds submeshes
+		const auto & vPositions = mesh.GetTabPosition();
+		const auto & vNormals = mesh.GetTabNormal();
+		const bool hasNormals = !vNormals.empty() && vNormals.size() == vPositions.size();
+
+		//Triangles of the previous LOD, with indices local to the vertices of each submesh
+		std::vector<std::vector<unsigned int>> vPrevious(vSubMeshes.size());
+		{
+			const auto & vFaces = mesh.GetTabFace();
+			for (std::size_t s = 0; s < vSubMeshes.size(); s++)
+			{
+				const auto & subMesh = vSubMeshes[s];
+				vPrevious[s].reserve(subMesh.nFaces * 3);
+				for (std::size_t f = subMesh.faceOffset; f < subMesh.faceOffset + subMesh.nFaces; f++)
+				{
+					for (auto id : vFaces[f].id)
+						vPrevious[s].push_back(id - (unsigned int)subMesh.vertexOffset);
+				}
+			}
+		}
+
+		unsigned int lods = 1;
+		for (; lods < lodCount; lods++)
+		{
+			std::vector<std::vector<Face>> vLodFaces(vSubMeshes.size());
+			std::size_t before = 0, after = 0;
+
+			for (std::size_t s = 0; s < vSubMeshes.size(); s++)
+			{
+				const auto & subMesh = vSubMeshes[s];
+				auto & vIndices = vPrevious[s];
+				before += vIndices.size();
+
+				const std::size_t target = std::max<std::size_t>(3, (std::size_t)((float)(vIndices.size() / 3) * ratio) * 3);
+				if (vIndices.size() > target)
+				{
+					vIndices = Simplify(vIndices.data(), vIndices.size(), vPositions.data() + subMesh.vertexOffset, hasNormals ? vNormals.data() + subMesh.vertexOffset : nullptr,
+						subMesh.nVertices, target, normalWeight);
+				}
+				after += vIndices.size();
+
+				vLodFaces[s].resize(vIndices.size() / 3);
+				for (std::size_t i = 0; i < vIndices.size(); i++)
+					vLodFaces[s][i / 3].id[i % 3] = vIndices[i] + (unsigned int)subMesh.vertexOffset;
+			}
+
+			//Less than 10% of triangles removed : not worth a LOD
+			if (after * 10 > before * 9)
+				break;
+
+			if (!mesh.AddLod(vLodFaces))
+				break;
+		}
+
+		std::ostringstream faceCounts;
+		for (unsigned int lod = 0; lod < mesh.GetLodCount(); lod++)
+			faceCounts << (lod ? " / " : "") << mesh.GetLodFaceCount(lod);
+		BH3D_LOGGER("LOD generation - faces by LOD : " << faceCounts.str());
+
+		return mesh.GetLodCount();
+	}
+
+}
@@ -1,22 +1,18 @@
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <system_error>
 
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
 
 #include "BH3D_ObjectLoader.hpp"
-
-struct compare_vec3
-{
-	bool operator()(const glm::vec3 & v1, const glm::vec3 & v2) const 
-	{
-		for (int i = 0; i < glm::vec3::length(); i++) {
-			if (v1[i] < v2[i]) return true;
-			if (v1[i] > v2[i]) return false;
- 		}
-		return false;
-	}
-};
+#include "BH3D_MeshOptimizer.hpp"
+#include "BH3D_MeshSimplifier.hpp"
 
 namespace bh3d
 {
@@ -34,6 +30,105 @@ namespace bh3d
 	};
 #pragma pack(pop)
 
+	namespace {
+		/// <summary>
+		/// Flat open addressing table (linear probing) of the unique positions of a mesh.
+		/// The slots only store vertex ids : the keys are computed back from the welded positions.
+		/// </summary>
+		class VertexWelder
+		{
+			static constexpr unsigned int EMPTY = ~0u;
+
+			using Key = std::array<std::uint32_t, 3>;
+
+			std::vector<unsigned int> m_vSlots;
+			std::vector<glm::vec3> & m_vPositions;		//! Welded positions, the vertex id is the index
+			float m_invEpsilon = 0.0f;					//! 0 : exact positions, else inverse size of the welding cells
+
+			Key GetKey(const glm::vec3 & position) const
+			{
+				Key key;
+				for (int i = 0; i < 3; i++)
+				{
+					if (m_invEpsilon > 0.0f)
+					{
+						key[i] = (std::uint32_t)(std::int32_t)std::floor(position[i] * m_invEpsilon + 0.5f);
+					}
+					else
+					{
+						const float value = position[i] + 0.0f;		//-0 and +0 are the same position
+						std::memcpy(&key[i], &value, sizeof(float));
+					}
+				}
+				return key;
+			}
+
+			static std::size_t Hash(const Key & key)
+			{
+				std::uint64_t h = key[0];
+				h = h * 0x9E3779B97F4A7C15ull ^ key[1];
+				h = h * 0x9E3779B97F4A7C15ull ^ key[2];
+				h ^= h >> 32;
+				h *= 0xD6E8FEB86659FD93ull;
+				h ^= h >> 32;
+				return (std::size_t)h;
+			}
+
+			void Resize(std::size_t capacity)
+			{
+				std::size_t size = 1024;
+				while (size < capacity)
+					size *= 2;
+
+				m_vSlots.assign(size, EMPTY);
+				const std::size_t mask = size - 1;
+				for (unsigned int id = 0; id < (unsigned int)m_vPositions.size(); id++)
+				{
+					std::size_t slot = Hash(GetKey(m_vPositions[id])) & mask;
+					while (m_vSlots[slot] != EMPTY)
+						slot = (slot + 1) & mask;
+					m_vSlots[slot] = id;
+				}
+			}
+
+		public:
+			/// <param name="vPositions">Receives the unique positions</param>
+			/// <param name="expectedCount">Expected number of unique positions</param>
+			/// <param name="epsilon">Size of the welding cells, 0 to only weld the identical positions</param>
+			VertexWelder(std::vector<glm::vec3> & vPositions, std::size_t expectedCount, float epsilon) :
+				m_vPositions(vPositions),
+				m_invEpsilon(epsilon > 0.0f ? 1.0f / epsilon : 0.0f)
+			{
+				m_vPositions.reserve(expectedCount);
+				Resize(2 * expectedCount);
+			}
+
+			/// <summary>
+			/// Id of the vertex at a position, added if the position is new (load factor kept under 1/2)
+			/// </summary>
+			unsigned int Add(const glm::vec3 & position)
+			{
+				if (2 * (m_vPositions.size() + 1) > m_vSlots.size())
+					Resize(2 * m_vSlots.size());
+
+				const Key key = GetKey(position);
+				const std::size_t mask = m_vSlots.size() - 1;
+				for (std::size_t slot = Hash(key) & mask;; slot = (slot + 1) & mask)
+				{
+					const unsigned int id = m_vSlots[slot];
+					if (id == EMPTY)
+					{
+						m_vSlots[slot] = (unsigned int)m_vPositions.size();
+						m_vPositions.push_back(position);
+						return m_vSlots[slot];
+					}
+					if (GetKey(m_vPositions[id]) == key)
+						return id;
+				}
+			}
+		};
+	}
+
 
 
 	bool ObjectLoader::LoadBinary(Mesh & mesh) const
@@ -70,53 +165,75 @@ namespace bh3d
 		int triangleNumbers = 0;
 		file.read((char*)&(triangleNumbers), sizeof(int));
 	
-		std::map<glm::vec3, std::vector<unsigned int>, compare_vec3> mapSmartVertices;
-		using uint = unsigned int;
-		auto AddPositions = [&, jj = uint(0)]  (const glm::vec3 & pos) mutable {
-			auto & vertices = mapSmartVertices[pos];
-			vertices.push_back(jj++);
-		};
-
-		std::vector<glm::vec3> vTriNormals(triangleNumbers);
+		if (triangleNumbers <= 0 || !file) {
+			BH3D_LOGGER_WARNING("Unsupported STL format - " << m_filepath);
+			return false;
+		}
 
-		STLTriangleFormat triangle;
-		for (int i = 0; i < triangleNumbers; i++) 
-		{
-			file.read((char*)(&triangle), STLTriangleFormat::byte_size());
-			AddPositions(triangle.m_points[0]);
-			AddPositions(triangle.m_points[1]);
-			AddPositions(triangle.m_points[2]);
-			vTriNormals[i] = triangle.m_normal;
+		//The triangle count is checked against the file size before any allocation (corrupted header)
+		std::error_code ec;
+		const std::uintmax_t fileSize = std::filesystem::file_size(m_filepath, ec);
+		const std::uintmax_t expectedSize = 84 + (std::uintmax_t)STLTriangleFormat::byte_size() * (std::uintmax_t)triangleNumbers;
+		if (ec || fileSize != expectedSize) {
+			BH3D_LOGGER_WARNING("Invalid STL file size - " << m_filepath << " (" << triangleNumbers << " triangles, " << fileSize << " bytes)");
+			return false;
 		}
 
-		//fill a continuous vertex array and update the surface array with the vertex ids.
+		//Vertices welded while reading : the face indices and the smooth normals are written directly
 		std::vector<glm::vec3> vPositions;
 		std::vector<glm::vec3> vNormals;
-
 		std::vector<Face> vFaces(triangleNumbers);
-		vPositions.reserve(mapSmartVertices.size());
-		vNormals.reserve(mapSmartVertices.size());
-		int i = 0;
-		for (auto & pair : mapSmartVertices) 
+		VertexWelder welder(vPositions, (std::size_t)triangleNumbers / 2 + 3, m_weldEpsilon);	//closed meshes : about 2 triangles per vertex
+		vNormals.reserve(vPositions.capacity());
+
+		constexpr int BLOCK_SIZE = 4096;		//Triangles read at once
+		std::vector<STLTriangleFormat> vBlock(BLOCK_SIZE);
+		for (int first = 0; first < triangleNumbers; first += BLOCK_SIZE)
 		{
-			vPositions.emplace_back(pair.first); //fill a continuous vertex array
-			
-			glm::vec3 normal_smooth = { 0.0f, 0.0f, 0.0f };
-			//update each linked triangle
-			for (auto id : pair.second)
+			const int count = std::min(BLOCK_SIZE, triangleNumbers - first);
+			file.read((char*)vBlock.data(), (std::streamsize)count * STLTriangleFormat::byte_size());
+			if (!file) {
+				BH3D_LOGGER_WARNING("Truncated STL file - " << m_filepath);
+				return false;
+			}
+
+			for (int i = 0; i < count; i++)
 			{
-				auto face_id = id / 3;	//Linked triangle
-				auto sub_id = id % 3;	//order indice in the triangle
-				vFaces[face_id].id[sub_id] = i;
-				normal_smooth += vTriNormals[face_id];
+				const STLTriangleFormat & triangle = vBlock[i];
+				Face & face = vFaces[first + i];
+				for (int k = 0; k < 3; k++)
+				{
+					face.id[k] = welder.Add(triangle.m_points[k]);
+					if (face.id[k] == vNormals.size())
+						vNormals.emplace_back(0.0f);
+					vNormals[face.id[k]] += triangle.m_normal;
+				}
 			}
-			vNormals.emplace_back(glm::normalize(normal_smooth));
-			i++;
+		}
+
+		for (auto & normal : vNormals)
+		{
+			const float length = glm::length(normal);
+			if (length > 0.0f)
+				normal /= length;
 		}
 
 		mesh.AddSubMesh(vFaces, vPositions, {}, vNormals);
 		mesh.NormalizeData();
 		mesh.CenterDataToOrigin();
+		mesh.SetVertexLayout(Mesh::VertexLayout::INTERLEAVED);	//dense meshes : one fetch per vertex
+
+		//Packed positions and normals : the positions are drawn with the dequantization matrix of the mesh (see Drawable::Draw)
+		Mesh::VertexCompression compression = mesh.GetVertexCompression();
+		compression.positions = true;
+		compression.normals = true;
+		mesh.SetVertexCompression(compression);
+
+		if (m_lodCount > 1)
+			MeshSimplifier::GenerateLods(mesh, m_lodCount);
+
+		//Triangles in the read order : vertex cache, overdraw and vertex fetch reordering
+		MeshOptimizer::Optimize(mesh);
 		mesh.ComputeMesh();
 
 		return true;
@@ -0,0 +1,208 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "BH3D_OccupancyGrid.hpp"
+
+namespace bh3d
+{
+
+	void OccupancyGrid::Resize(const glm::ivec3 & dims)
+	{
+		assert(dims.x >= 0 && dims.y >= 0 && dims.z >= 0);
+
+		m_dims = dims;
+		m_brickDims = (dims + (BRICK_SIZE - 1)) / BRICK_SIZE;
+		m_nodeDims = (m_brickDims + (NODE_SIZE - 1)) / NODE_SIZE;
+
+		Clear();
+	}
+
+	void OccupancyGrid::Clear()
+	{
+		m_vIds.assign((std::size_t)m_dims.x * m_dims.y * m_dims.z, NONE);
+		m_vBrickMasks.assign((std::size_t)m_brickDims.x * m_brickDims.y * m_brickDims.z, 0);
+		m_vNodeMasks.assign((std::size_t)m_nodeDims.x * m_nodeDims.y * m_nodeDims.z, 0);
+		m_occupiedCount = 0;
+	}
+
+	void OccupancyGrid::Set(const glm::ivec3 & cell, int id, bool occupied)
+	{
+		assert(IsInside(cell));
+		m_vIds[CellIndex(cell)] = id;
+		SetOccupied(cell, occupied);
+	}
+
+	void OccupancyGrid::SetOccupied(const glm::ivec3 & cell, bool occupied)
+	{
+		assert(IsInside(cell));
+
+		const glm::ivec3 brick = cell / BRICK_SIZE;
+		std::uint64_t & brickMask = m_vBrickMasks[BrickIndex(brick)];
+		const std::uint64_t cellBit = std::uint64_t(1) << BrickBit(cell);
+
+		if (((brickMask & cellBit) != 0) == occupied)
+			return;
+
+		std::uint64_t & nodeMask = m_vNodeMasks[NodeIndex(brick / NODE_SIZE)];
+		const std::uint64_t brickBit = std::uint64_t(1) << NodeBit(brick);
+
+		if (occupied)
+		{
+			brickMask |= cellBit;
+			nodeMask |= brickBit;
+			m_occupiedCount++;
+		}
+		else
+		{
+			brickMask &= ~cellBit;
+			if (brickMask == 0)
+				nodeMask &= ~brickBit;
+			m_occupiedCount--;
+		}
+	}
+
+	int OccupancyGrid::GetNeighbours6(const glm::ivec3 & cell) const
+	{
+		static const glm::ivec3 offsets[6] = { {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1} };
+
+		int neighbours = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			if (IsOccupied(cell + offsets[i]))
+				neighbours |= (1 << i);
+		}
+		return neighbours;
+	}
+
+	bool OccupancyGrid::Raycast(const Ray & ray, GridHit & hit, float maxDistance) const
+	{
+		if (m_occupiedCount == 0)
+			return false;
+
+		const glm::vec3 & o = ray.m_origin;
+		const glm::vec3 & d = ray.m_direction;
+
+		glm::ivec3 step;
+		glm::vec3 invDir;
+		for (int a = 0; a < 3; a++)
+		{
+			step[a] = (d[a] > 0.0f) ? 1 : ((d[a] < 0.0f) ? -1 : 0);
+			invDir[a] = (step[a] != 0) ? 1.0f / d[a] : 0.0f;
+		}
+
+		//Clip the ray with the grid box [0, dims]
+		float tEnter = 0.0f;
+		float tLeave = maxDistance;
+		int enterAxis = -1;
+		for (int a = 0; a < 3; a++)
+		{
+			if (step[a] == 0)
+			{
+				if (o[a] < 0.0f || o[a] >= (float)m_dims[a])
+					return false;
+				continue;
+			}
+			float t0 = (0.0f - o[a]) * invDir[a];
+			float t1 = ((float)m_dims[a] - o[a]) * invDir[a];
+			if (t0 > t1)
+				std::swap(t0, t1);
+			if (t0 > tEnter)
+			{
+				tEnter = t0;
+				enterAxis = a;
+			}
+			tLeave = std::min(tLeave, t1);
+		}
+		if (tEnter > tLeave)
+			return false;
+
+		//First cell
+		glm::ivec3 cell = glm::clamp(glm::ivec3(glm::floor(ray.At(tEnter))), glm::ivec3(0), m_dims - 1);
+		glm::ivec3 normal(0);
+		if (enterAxis >= 0)
+		{
+			cell[enterAxis] = (step[enterAxis] > 0) ? 0 : m_dims[enterAxis] - 1;
+			normal[enterAxis] = -step[enterAxis];
+		}
+
+		float t = tEnter;
+		constexpr int NODE_CELLS = BRICK_SIZE * NODE_SIZE;
+
+		for (;;)
+		{
+			//Size of the empty (or occupied) block containing the cell : coarse node, brick or cell
+			int size = 1;
+			if (m_vNodeMasks[NodeIndex(cell / NODE_CELLS)] == 0)
+				size = NODE_CELLS;
+			else if (m_vBrickMasks[BrickIndex(cell / BRICK_SIZE)] == 0)
+				size = BRICK_SIZE;
+			else if ((m_vBrickMasks[BrickIndex(cell / BRICK_SIZE)] >> BrickBit(cell)) & 1u)
+			{
+				hit.m_cell = cell;
+				hit.m_normal = normal;
+				hit.m_id = m_vIds[CellIndex(cell)];
+				hit.m_distance = t;
+				return true;
+			}
+
+			//Leave the block by its nearest boundary crossed by the ray (tMax of Amanatides-Woo for a block of 'size' cells)
+			const glm::ivec3 blockMin = (cell / size) * size;
+			float tNext = std::numeric_limits<float>::max();
+			int axis = -1;
+			for (int a = 0; a < 3; a++)
+			{
+				if (step[a] == 0)
+					continue;
+				const int boundary = (step[a] > 0) ? blockMin[a] + size : blockMin[a];
+				const float tBoundary = ((float)boundary - o[a]) * invDir[a];
+				if (tBoundary < tNext)
+				{
+					tNext = tBoundary;
+					axis = a;
+				}
+			}
+
+			if (axis < 0 || tNext > tLeave)
+				return false;
+
+			//Next cell : one step on the leaving axis, the other coordinates stay in the block
+			const glm::ivec3 blockMax = glm::min(blockMin + (size - 1), m_dims - 1);
+			glm::ivec3 next = glm::clamp(glm::ivec3(glm::floor(ray.At(tNext))), blockMin, blockMax);
+			next[axis] = (step[axis] > 0) ? blockMin[axis] + size : blockMin[axis] - 1;
+
+			if (next[axis] < 0 || next[axis] >= m_dims[axis])
+				return false;
+
+			normal = glm::ivec3(0);
+			normal[axis] = -step[axis];
+			cell = next;
+			t = std::max(t, tNext);
+		}
+	}
+
+}
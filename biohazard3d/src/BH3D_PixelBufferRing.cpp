@@ -0,0 +1,191 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <cstring>
+#include <cassert>
+
+#include "BH3D_PixelBufferRing.hpp"
+#include "BH3D_GLCheckError.hpp"
+#include "BH3D_Logger.hpp"
+
+namespace bh3d
+{
+	PixelBufferRing::~PixelBufferRing()
+	{
+		Destroy();
+	}
+
+	void PixelBufferRing::Destroy()
+	{
+		for (auto & buffer : m_vBuffers)
+		{
+			if (buffer.fence != nullptr)
+				glDeleteSync(buffer.fence);
+			if (buffer.bufferID != 0)
+				glDeleteBuffers(1, &buffer.bufferID);
+		}
+		m_vBuffers.clear();
+		m_current = 0;
+	}
+
+	std::size_t PixelBufferRing::ImageByteSize(GLsizei width, GLsizei height, GLenum format, GLenum type)
+	{
+		std::size_t components = 0;
+		switch (format)
+		{
+		case GL_RED: case GL_GREEN: case GL_BLUE: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+			components = 1; break;
+		case GL_RG: case GL_RG_INTEGER: case GL_DEPTH_STENCIL:
+			components = 2; break;
+		case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: case GL_BGR_INTEGER:
+			components = 3; break;
+		case GL_RGBA: case GL_BGRA: case GL_RGBA_INTEGER: case GL_BGRA_INTEGER:
+			components = 4; break;
+		default:
+			return 0;
+		}
+
+		std::size_t pixelSize = 0;
+		switch (type)
+		{
+		case GL_UNSIGNED_BYTE: case GL_BYTE:
+			pixelSize = components; break;
+		case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+			pixelSize = components * 2; break;
+		case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT:
+			pixelSize = components * 4; break;
+		case GL_UNSIGNED_BYTE_3_3_2: case GL_UNSIGNED_BYTE_2_3_3_REV:
+			pixelSize = 1; break;
+		case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_5_6_5_REV: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+		case GL_UNSIGNED_SHORT_5_5_5_1: case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+			pixelSize = 2; break;
+		case GL_UNSIGNED_INT_8_8_8_8: case GL_UNSIGNED_INT_8_8_8_8_REV: case GL_UNSIGNED_INT_10_10_10_2: case GL_UNSIGNED_INT_2_10_10_10_REV:
+			pixelSize = 4; break;
+		default:
+			return 0;
+		}
+
+		//The rows are aligned on GL_UNPACK_ALIGNMENT, except the last one
+		GLint alignment = 4;
+		glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+		const std::size_t rowSize = pixelSize * width;
+		const std::size_t alignedRowSize = (rowSize + alignment - 1) / alignment * alignment;
+
+		return height > 0 ? alignedRowSize * (height - 1) + rowSize : 0;
+	}
+
+	PixelBufferRing::PixelBuffer * PixelBufferRing::Stage(const void *pixels, std::size_t byteSize)
+	{
+		BH3D_GL_CHECK_ERROR;
+
+		assert(pixels != nullptr);
+		if (byteSize == 0 || m_bufferCount == 0)
+			return nullptr;
+
+		//The buffers are created with the first upload (a OpenGL context is required)
+		if (m_vBuffers.empty())
+		{
+			m_vBuffers.resize(m_bufferCount);
+			for (auto & buffer : m_vBuffers)
+				glGenBuffers(1, &buffer.bufferID);
+		}
+
+		auto & buffer = m_vBuffers[m_current];
+		m_current = (m_current + 1) % m_bufferCount;
+
+		if (buffer.bufferID == 0)
+			return nullptr;
+
+		//Wait until the previous upload doesn't read the buffer anymore
+		if (buffer.fence != nullptr)
+		{
+			GLenum waitReturn = glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			while (waitReturn == GL_TIMEOUT_EXPIRED)
+				waitReturn = glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			assert(waitReturn != GL_WAIT_FAILED);
+			glDeleteSync(buffer.fence);
+			buffer.fence = nullptr;
+		}
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.bufferID);
+
+		//The buffer only grows (the streamed images have usually the same size)
+		if (buffer.capacity < byteSize)
+		{
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, byteSize, nullptr, GL_STREAM_DRAW);
+			buffer.capacity = byteSize;
+		}
+
+		//The fence guarantees that the buffer is free : no implicit synchronisation
+		void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, byteSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (dst == nullptr)
+		{
+			BH3D_LOGGER_ERROR("Can't map the pixel buffer");
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			return nullptr;
+		}
+
+		std::memcpy(dst, pixels, byteSize);
+
+		if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE)
+		{
+			BH3D_LOGGER_ERROR("The pixel buffer data are corrupted");
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			return nullptr;
+		}
+
+		return &buffer;
+	}
+
+	void PixelBufferRing::Release(PixelBuffer & buffer)
+	{
+		buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	bool PixelBufferRing::TexSubImage2D(GLenum target, GLint level, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+	{
+		PixelBuffer * buffer = Stage(pixels, ImageByteSize(width, height, format, type));
+		if (buffer == nullptr)
+			return false;
+
+		glTexSubImage2D(target, level, 0, 0, width, height, format, type, nullptr);		//offset 0 in the bound buffer
+		Release(*buffer);
+
+		return true;
+	}
+
+	bool PixelBufferRing::TexSubImage3D(GLenum target, GLint level, GLint layer, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+	{
+		PixelBuffer * buffer = Stage(pixels, ImageByteSize(width, height, format, type));
+		if (buffer == nullptr)
+			return false;
+
+		glTexSubImage3D(target, level, 0, 0, layer, width, height, 1, format, type, nullptr);	//offset 0 in the bound buffer
+		Release(*buffer);
+
+		return true;
+	}
+}
@@ -0,0 +1,198 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <system_error>
+
+#include "BH3D_ProgramCache.hpp"
+#include "BH3D_File.hpp"
+#include "BH3D_Hash.hpp"
+#include "BH3D_GLCheckError.hpp"
+#include "BH3D_Logger.hpp"
+#include "BH3D_Common.hpp"
+
+namespace bh3d
+{
+	namespace
+	{
+		const char PROGRAM_IDENTIFIER[8] = { 'B', 'H', '3', 'D', 'P', 'R', 'G', '\0' };
+		constexpr std::uint32_t PROGRAM_FILE_VERSION = 1;
+
+		//File layout : header, driver string, program binary
+		struct ProgramHeader
+		{
+			char identifier[8];
+			std::uint32_t version;
+			std::uint32_t binaryFormat;
+			std::uint64_t keyHash;			//checked against the file name collisions
+			std::uint32_t driverLength;
+			std::uint32_t binaryLength;
+		};
+		static_assert(sizeof(ProgramHeader) == 32, "Program header without padding");
+	}
+
+	const std::string & ProgramCache::GetDriver()
+	{
+		if (m_driver.empty())
+		{
+			auto glString = [](GLenum name) {
+				const GLubyte * str = glGetString(name);
+				return str ? std::string(reinterpret_cast<const char *>(str)) : std::string();
+			};
+			m_driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+		}
+		return m_driver;
+	}
+
+	bool ProgramCache::IsSupported()
+	{
+		if (m_binaryFormats < 0)
+		{
+			GLint formats = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			m_binaryFormats = formats;
+			if (formats == 0)
+				BH3D_LOGGER_WARNING("No program binary format : the program cache is disabled");
+		}
+		return m_binaryFormats > 0;
+	}
+
+	std::filesystem::path ProgramCache::GetCachePath(const std::string & key)
+	{
+		std::stringstream ss;
+		ss << std::hex << std::setw(16) << std::setfill('0') << HashFNV1a(GetDriver() + "|" + key) << ".bin";
+		return m_directory / ss.str();
+	}
+
+	GLuint ProgramCache::Load(const std::string & key)
+	{
+		if (!IsSupported())
+			return 0;
+
+		BH3D_GL_CHECK_ERROR;
+
+		const auto path = GetCachePath(key);
+
+		std::error_code ec;
+		if (!std::filesystem::exists(path, ec))
+			return 0;
+
+		MappedFile file;
+		if (!file.Open(path))
+			return 0;
+
+		const std::string & driver = GetDriver();
+
+		ProgramHeader header;
+		bool valid = file.Size() >= sizeof(header);
+		if (valid)
+		{
+			std::memcpy(&header, file.Data(), sizeof(header));
+			valid = std::memcmp(header.identifier, PROGRAM_IDENTIFIER, sizeof(PROGRAM_IDENTIFIER)) == 0 &&
+				header.version == PROGRAM_FILE_VERSION &&
+				header.keyHash == HashFNV1a(key) &&
+				header.driverLength == driver.size() &&
+				header.binaryLength > 0 &&
+				file.Size() == sizeof(header) + (std::size_t)header.driverLength + (std::size_t)header.binaryLength &&
+				std::memcmp(file.Data() + sizeof(header), driver.data(), driver.size()) == 0;
+		}
+
+		if (!valid)
+		{
+			BH3D_LOGGER_WARNING("Out of date program cache file : " << path);
+			file.Close();
+			std::filesystem::remove(path, ec);
+			return 0;
+		}
+
+		GLuint program = glCreateProgram();
+		glProgramBinary(program, (GLenum)header.binaryFormat, file.Data() + sizeof(header) + header.driverLength, (GLsizei)header.binaryLength);
+
+		//The driver can reject a binary (format no longer supported...) : the program is linked again from the sources
+		GLint link = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &link);
+		if (link != GL_TRUE)
+		{
+			BH3D_LOGGER_WARNING("Program binary rejected by the driver : " << path);
+			glDeleteProgram(program);
+			file.Close();
+			std::filesystem::remove(path, ec);
+			return 0;
+		}
+
+		BH3D_LOGGER("Program cache : " << path);
+		return program;
+	}
+
+	bool ProgramCache::Store(const std::string & key, GLuint program)
+	{
+		if (program == 0 || !IsSupported())
+			return BH3D_ERROR;
+
+		BH3D_GL_CHECK_ERROR;
+
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return BH3D_ERROR;
+
+		std::vector<char> binary((std::size_t)length);
+		GLsizei written = 0;
+		GLenum format = 0;
+		glGetProgramBinary(program, length, &written, &format, binary.data());
+		if (written <= 0)
+			return BH3D_ERROR;
+
+		const std::string & driver = GetDriver();
+
+		ProgramHeader header;
+		std::memcpy(header.identifier, PROGRAM_IDENTIFIER, sizeof(PROGRAM_IDENTIFIER));
+		header.version = PROGRAM_FILE_VERSION;
+		header.binaryFormat = format;
+		header.keyHash = HashFNV1a(key);
+		header.driverLength = (std::uint32_t)driver.size();
+		header.binaryLength = (std::uint32_t)written;
+
+		std::error_code ec;
+		std::filesystem::create_directories(m_directory, ec);
+
+		const auto path = GetCachePath(key);
+		const bool stored = WriteFileAtomic(path, [&](std::ostream & os) {
+			os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+			os.write(driver.data(), driver.size());
+			os.write(binary.data(), written);
+		});
+		if (!stored)
+			return BH3D_ERROR;
+
+		BH3D_LOGGER("Program cache written : " << path);
+		return BH3D_OK;
+	}
+}
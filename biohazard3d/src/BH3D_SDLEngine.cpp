@@ -1,4 +1,6 @@
 #include <sstream>
+#include <cmath>
+#include <chrono>
 
 #include <SDL2/SDL.h>
 
@@ -108,21 +110,123 @@ namespace bh3d
 	{
 		CreateWindow();		//Create a SDL windows with a opengl context
 		InitOpenGL();		//Init opengl stuff (Some GLad and Opengl default values)
+
+		m_frameUniformBuffer.Create(sizeof(FrameUniforms), BH3D_FRAME_UNIFORM_BINDING);
+	}
+
+	void SDLEngine::UpdateFrameUniforms()
+	{
+		m_frameUniforms.projection = m_cameraEngine.m_projection;
+		m_frameUniforms.view = m_cameraEngine.m_modelview * m_cameraEngine.m_transform;
+		m_frameUniforms.proj_view = m_cameraEngine.ProjViewTransform();
+		m_frameUniforms.camera_position = glm::vec4(m_cameraEngine.m_position, 1.0f);
+		m_frameUniforms.time = glm::vec4((float)m_renderTime, (float)m_fps.GetElapseTimeSecond(), 0.0f, 0.0f);
+
+		if (m_frameUniformBuffer.IsValid())
+			m_frameUniformBuffer.Update(m_frameUniforms);
 	}
 
 	//Main loop of the opengl application
 	void SDLEngine::Run() 
 	{	
 		Resize();			//Call the resize function once before the first display
-		
+		SetUncappedRendering(m_schedulerInfo.uncappedRendering);
+
+		assert(m_schedulerInfo.simulationStep > 0.0 && m_schedulerInfo.maxSimulationSteps > 0);
+		if (m_schedulerInfo.threadedSimulation)
+		{
+			RunThreaded();
+			return;
+		}
+
+		const double step = m_schedulerInfo.simulationStep;
+		double accumulator = 0.0;
+		m_simulationTime = 0.0;
+
+		m_fps = Fps();
 		while (PollEvents())	//Collect overall event (return false when the program have to exist)
 		{
+			m_fps.Compute();
+			accumulator += m_fps.GetElapseTimeSecond();
+
 			Update();				//Event processing and stuff like that
+
+			//Fixed step simulation, independent of the frame rate
+			m_simulationSteps = 0;
+			while (accumulator >= step && m_simulationSteps < m_schedulerInfo.maxSimulationSteps)
+			{
+				m_simulationTime += step;
+				Simulate((float)step);
+				accumulator -= step;
+				m_simulationSteps++;
+			}
+			if (accumulator >= step)	//Too late : drop the remaining ticks
+				accumulator = std::fmod(accumulator, step);
+
+			m_interpolation = (float)(accumulator / step);
+			m_renderTime = m_simulationTime + accumulator;
+
+			m_textureManager.UploadAsyncTextures(m_schedulerInfo.textureUploadBudget);	//Textures decoded by the workers
 			Display();				//Display function
 			SDL_GL_SwapWindow(m_SDL_Windows_GL_Context);	// Swap our buffer to display the current contents of buffer on screen 
 		}
 	}
 
+	void SDLEngine::RunThreaded()
+	{
+		using clock = std::chrono::steady_clock;
+		const auto step = std::chrono::duration_cast<clock::duration>(Fps::second(m_schedulerInfo.simulationStep));
+		const auto start = clock::now();
+		auto seconds = [start](clock::time_point t) { return Fps::second(t - start).count(); };
+
+		m_simulationTime = 0.0;
+		m_simulationTicks = 0;
+		m_simulationRunning = true;
+
+		//Simulation thread : one tick per step, the late ticks beyond maxSimulationSteps are dropped
+		std::thread simulationThread([this, step, start, seconds]() {
+			auto next = start;
+			while (m_simulationRunning.load(std::memory_order_acquire))
+			{
+				next += step;
+				const auto now = clock::now();
+				if (now - next > step * m_schedulerInfo.maxSimulationSteps)
+					next = now;
+				else if (next > now)
+					std::this_thread::sleep_until(next);
+
+				m_simulationTime = seconds(next);
+				Simulate((float)m_schedulerInfo.simulationStep);
+				m_simulationTicks.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+
+		//GL thread : displays the last snapshot published by the simulation
+		m_fps = Fps();
+		while (PollEvents())
+		{
+			m_fps.Compute();
+			Update();
+
+			m_simulationSteps = m_simulationTicks.exchange(0, std::memory_order_relaxed);
+			m_renderTime = seconds(clock::now());	//the snapshots are interpolated between their two last ticks : the display is one tick behind
+			m_interpolation = 0.0f;					//only GetInterpolation(tickTime) is meaningful with the snapshots
+
+			m_textureManager.UploadAsyncTextures(m_schedulerInfo.textureUploadBudget);
+			Display();
+			SDL_GL_SwapWindow(m_SDL_Windows_GL_Context);
+		}
+
+		m_simulationRunning.store(false, std::memory_order_release);
+		simulationThread.join();
+	}
+
+	void SDLEngine::SetUncappedRendering(bool uncapped)
+	{
+		m_schedulerInfo.uncappedRendering = uncapped;
+		SDL_GL_SetSwapInterval(uncapped ? 0 : m_windowInfo.vsync);
+	}
+
 	void SDLEngine::SwapWindow() {
 		// Swap our buffer to display the current contents of buffer on screen
 		SDL_GL_SwapWindow(m_SDL_Windows_GL_Context);
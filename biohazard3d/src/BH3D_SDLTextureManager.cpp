@@ -23,6 +23,7 @@
  */
 
 #include <memory>
+#include <cstring>
 
 #include <SDL2/SDL_image.h>
 
@@ -37,37 +38,161 @@ namespace bh3d
 		return surface;
 	}
 
-	bool SDLTextureManager::LoadResourceFromFile(const std::filesystem::path & pathname, Texture& texture)
+	namespace
 	{
-		//charge l'image avec la SDL
-		auto surface = make_surface(
-			IMG_Load(pathname.generic_string().c_str())
-		); 
+		//Decode an image file in a RGBA surface
+		std::shared_ptr<SDL_Surface> LoadSurfaceRGBA(const std::filesystem::path & pathname)
+		{
+			//charge l'image avec la SDL
+			auto surface = make_surface(
+				IMG_Load(pathname.generic_string().c_str())
+			);
+
+			// Vérification du chargement
+			if (surface == nullptr)
+			{
+				BH3D_LOGGER_ERROR("Can't Load the texture : " << IMG_GetError() << pathname);
+				return nullptr;
+			}
 
-		// Vérification du chargement
-		if (surface == nullptr)
+			//Force le format RGBA
+			auto surfaceRGBA = make_surface(
+				SDL_ConvertSurfaceFormat(surface.get(), SDL_PIXELFORMAT_ABGR8888, 0)
+			);
+			if (surfaceRGBA == nullptr)
+			{
+				BH3D_LOGGER_ERROR("Can't convert the texture in RGBA : " << SDL_GetError() << pathname);
+				return nullptr;
+			}
+			return surfaceRGBA;
+		}
+
+		//Copy the rows of a RGBA surface (without the pitch padding)
+		void CopySurfacePixels(const SDL_Surface * surface, unsigned char * dst)
 		{
-			BH3D_LOGGER_ERROR("Can't Load the texture : " << IMG_GetError() << pathname);
+			const std::size_t rowSize = (std::size_t)surface->w * 4;
+			const unsigned char * src = static_cast<const unsigned char *>(surface->pixels);
+			for (int row = 0; row < surface->h; row++)
+				std::memcpy(dst + row * rowSize, src + (std::size_t)row * surface->pitch, rowSize);
+		}
+	}
+
+	bool SDLTextureManager::DecodeResourceFromFile(const std::filesystem::path & pathname, TextureImage & image)
+	{
+		auto textureRGBA = LoadSurfaceRGBA(pathname);
+		if (textureRGBA == nullptr)
 			return false;
+
+		image.width = textureRGBA->w;
+		image.height = textureRGBA->h;
+		image.layers = 1;
+		image.format = GL_RGBA;
+		image.type = GL_UNSIGNED_BYTE;
+		image.pixels.resize((std::size_t)image.width * image.height * 4);
+		CopySurfacePixels(textureRGBA.get(), image.pixels.data());
+
+		return true;
+	}
+
+	bool SDLTextureManager::DecodeArrayResourceFromFiles(const std::vector<std::filesystem::path> & vPathnames, TextureImage & image)
+	{
+		if (vPathnames.empty())
+			return false;
+
+		//The images are decoded in parallel
+		std::vector<std::shared_ptr<SDL_Surface>> vLayers(vPathnames.size());
+		JobSystem::Default().ParallelFor(0, vPathnames.size(), 1, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; i++)
+				vLayers[i] = LoadSurfaceRGBA(vPathnames[i]);
+		});
+
+		for (std::size_t i = 0; i < vLayers.size(); i++)
+		{
+			if (vLayers[i] == nullptr)
+				return false;
+
+			//All the layers of a texture array have the same size : rescale to the first image size
+			if (i > 0 && (vLayers[i]->w != vLayers[0]->w || vLayers[i]->h != vLayers[0]->h))
+			{
+				BH3D_LOGGER("Texture array layer resized : " << vPathnames[i] << " (" << vLayers[i]->w << "x" << vLayers[i]->h << " -> " << vLayers[0]->w << "x" << vLayers[0]->h << ")");
+
+				auto resized = make_surface(
+					SDL_CreateRGBSurfaceWithFormat(0, vLayers[0]->w, vLayers[0]->h, 32, SDL_PIXELFORMAT_ABGR8888)
+				);
+				SDL_SetSurfaceBlendMode(vLayers[i].get(), SDL_BLENDMODE_NONE);
+				if (resized == nullptr || SDL_BlitScaled(vLayers[i].get(), nullptr, resized.get(), nullptr) != 0)
+				{
+					BH3D_LOGGER_ERROR("Can't resize the texture : " << SDL_GetError() << vPathnames[i]);
+					return false;
+				}
+				vLayers[i] = resized;
+			}
 		}
 
-		//Force le format RGBA
-		auto textureRGBA = make_surface(
-			SDL_ConvertSurfaceFormat(surface.get(), SDL_PIXELFORMAT_ABGR8888, 0)
-		);
-		surface.reset();
+		image.width = vLayers[0]->w;
+		image.height = vLayers[0]->h;
+		image.layers = (GLsizei)vLayers.size();
+		image.format = GL_RGBA;
+		image.type = GL_UNSIGNED_BYTE;
+
+		const std::size_t layerSize = (std::size_t)image.width * image.height * 4;
+		image.pixels.resize(layerSize * vLayers.size());
+		for (std::size_t i = 0; i < vLayers.size(); i++)
+			CopySurfacePixels(vLayers[i].get(), image.pixels.data() + i * layerSize);
+
+		return true;
+	}
+
+	bool SDLTextureManager::LoadResourceFromFile(const std::filesystem::path & pathname, Texture& texture)
+	{
+		if (LoadCachedTexture({ pathname }, m_textureTarget, texture))
+			return true;
+
+		TextureImage image;
+		if (!DecodeResourceFromFile(pathname, image))
+			return false;
 
 		//Create a opengl texture
 		texture = TextureManager::CreateTextureRGBA(
-			textureRGBA->w, 
-			textureRGBA->h,
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			textureRGBA->pixels
+			image.width,
+			image.height,
+			image.format,
+			image.type,
+			image.pixels.data()
 		);
+
+		StoreCachedTexture({ pathname }, texture);
 	
 		return texture.IsValid();
 	}
+
+	bool SDLTextureManager::LoadArrayResourceFromFiles(const std::vector<std::filesystem::path> & vPathnames, Texture& texture)
+	{
+		if (LoadCachedTexture(vPathnames, GL_TEXTURE_2D_ARRAY, texture))
+			return true;
+
+		TextureImage image;
+		if (!DecodeArrayResourceFromFiles(vPathnames, image))
+			return false;
+
+		std::vector<const void*> vLayerPixels;
+		vLayerPixels.reserve(image.layers);
+		for (GLsizei layer = 0; layer < image.layers; layer++)
+			vLayerPixels.push_back(image.LayerPixels(layer));
+
+		//Create a opengl texture array
+		texture = TextureManager::CreateTextureArrayRGBA(
+			image.width,
+			image.height,
+			image.format,
+			image.type,
+			vLayerPixels
+		);
+
+		StoreCachedTexture(vPathnames, texture);
+
+		return texture.IsValid();
+	}
 	
 }
  
@@ -23,12 +23,14 @@
  * THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <fstream>
 
 #include "BH3D_Common.hpp"
 #include "BH3D_GLCheckError.hpp"
 #include "BH3D_Logger.hpp"
 #include "BH3D_Shader.hpp"
+#include "BH3D_UniformBuffer.hpp"
 
 namespace bh3d
 {
@@ -72,10 +74,19 @@ namespace bh3d
 		m_vertexID = other.m_vertexID;
 		m_fragmentID = other.m_fragmentID;
 		m_error = std::move(other.m_error);
+		m_vertexFile = other.m_vertexFile;
+		m_fragmentFile = other.m_fragmentFile;
+		m_vUniforms = std::move(other.m_vUniforms);
+		m_uniformIndex = std::move(other.m_uniformIndex);
+		defaultUniform = other.defaultUniform;
 
 		other.m_programID = 0;
 		other.m_vertexID = 0;
 		other.m_fragmentID = 0;
+
+		other.TrackSourceFiles(false);
+		const std::filesystem::path & vertexPath = m_vertexFile;
+		TrackSourceFiles(!vertexPath.empty());
 		return *this;
 	}
 
@@ -83,6 +94,7 @@ namespace bh3d
 	{
 		if (s_bindedShader && (s_bindedShader->GetGLProgramID() == m_programID))
 			s_bindedShader = nullptr;
+		TrackSourceFiles(false);
 		Destroy();
 	}
 
@@ -93,7 +105,13 @@ namespace bh3d
 
 
 	int Shader::Load(const File & vertexSource, const File & fragmentSource) {
-		if (LoadT<const File>(vertexSource, fragmentSource) == BH3D_OK) {
+		m_vertexFile = vertexSource;
+		m_fragmentFile = fragmentSource;
+		TrackSourceFiles(true);
+
+		std::string vertexBuffer, fragmentBuffer;
+		if (vertexSource.ReadAndSaveIn(vertexBuffer) == BH3D_OK && fragmentSource.ReadAndSaveIn(fragmentBuffer) == BH3D_OK &&
+			LoadSources(vertexBuffer.c_str(), fragmentBuffer.c_str()) == BH3D_OK) {
 			BH3D_LOGGER("Shader -> [VERT] : " << vertexSource.Filename() << " -> [FRAG] : " << fragmentSource.Filename());
 			return BH3D_OK;
 		}
@@ -102,7 +120,10 @@ namespace bh3d
 	}
 
 	int Shader::LoadRaw(const void * vertexRaw, const void * fragmentRaw) {
-		if (LoadT<const void *>(vertexRaw, fragmentRaw) == BH3D_OK) {
+		m_vertexFile = File();
+		m_fragmentFile = File();
+		TrackSourceFiles(false);
+		if (LoadSources((const GLchar *)vertexRaw, (const GLchar *)fragmentRaw) == BH3D_OK) {
 			BH3D_LOGGER("Shader -> [VERT] : raw data -> [FRAG] : raw data");
 			return BH3D_OK;
 		}
@@ -110,12 +131,67 @@ namespace bh3d
 		return BH3D_ERROR;
 	}
 
+	int Shader::LoadSources(const GLchar * vertexSource, const GLchar * fragmentSource)
+	{
+		this->Destroy();
+
+		//Program binary of a previous run : no compilation
+		std::string programKey;
+		if (s_programCache)
+		{
+			programKey = GetProgramKey(vertexSource, fragmentSource);
+			m_programID = s_programCache->Load(programKey);
+			if (m_programID != 0)
+			{
+				ReflectUniforms();
+				DefaultUniformLocation();
+				return BH3D_OK;
+			}
+		}
+
+		if (LoadTypeShader(m_vertexID, GL_VERTEX_SHADER, vertexSource) == BH3D_ERROR) {
+			return BH3D_ERROR;
+		}
+
+		if (LoadTypeShader(m_fragmentID, GL_FRAGMENT_SHADER, fragmentSource) == BH3D_ERROR) {
+			return BH3D_ERROR;
+		}
+
+		if (LinkProgramShader() == BH3D_ERROR) {
+			return BH3D_ERROR;
+		}
+
+		if (s_programCache)
+			s_programCache->Store(programKey, m_programID);
+
+		ReflectUniforms();
+		DefaultUniformLocation();
+
+		return BH3D_OK;
+	}
+
+	std::string Shader::GetProgramKey(const GLchar * vertexSource, const GLchar * fragmentSource) const
+	{
+		//The attribute bindings are part of the linked program
+		std::string key = "[VERT]";
+		key += vertexSource;
+		key += "[FRAG]";
+		key += fragmentSource;
+		for (const auto & attrib : tAttribs)
+			key += "[ATTRIB]" + std::to_string(attrib.index) + ":" + attrib.name;
+		return key;
+	}
+
 	int Shader::LinkProgramShader()
 	{
 		BH3D_GL_CHECK_ERROR;
 
 		m_programID = glCreateProgram();
 
+		//The linked program can be read back for the program cache
+		if (s_programCache)
+			glProgramParameteri(m_programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 		glAttachShader(m_programID, m_vertexID);
 		glAttachShader(m_programID, m_fragmentID);
 
@@ -144,11 +220,12 @@ namespace bh3d
 		return BH3D_OK;
 	}
 
-	int Shader::LoadTypeShader(GLuint &shader, GLenum type, const void* raw)
+	//Compile a shader object, 0 if the compilation fails (the log is in error)
+	static GLuint CompileShader(GLenum type, const void* raw, std::string & error)
 	{
 		BH3D_GL_CHECK_ERROR;
 
-		shader = glCreateShader(type);
+		GLuint shader = glCreateShader(type);
 
 		const GLchar * gl_raw = (const GLchar*) raw;
 
@@ -162,13 +239,24 @@ namespace bh3d
 		if (errorCompilation != GL_TRUE)
 		{
 			GLint errorLenght = 0;
-			// Si la compilation a �chou�e, on r�cup�re l'erreur puis on l'affiche
 			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &errorLenght);
 
-			m_error.resize(errorLenght + 1, '\0');
-			glGetShaderInfoLog(shader, errorLenght, &errorLenght, (GLchar*)m_error.data());
-			BH3D_LOGGER_ERROR(" Shader compile fail : " << m_error)
+			error.resize(errorLenght + 1, '\0');
+			glGetShaderInfoLog(shader, errorLenght, &errorLenght, (GLchar*)error.data());
+			BH3D_LOGGER_ERROR(" Shader compile fail : " << error)
 
+			glDeleteShader(shader);
+			return 0;
+		}
+
+		return shader;
+	}
+
+	int Shader::LoadTypeShader(GLuint &shader, GLenum type, const void* raw)
+	{
+		shader = CompileShader(type, raw, m_error);
+		if (shader == 0)
+		{
 			Destroy();
 			return BH3D_ERROR;
 		}
@@ -176,32 +264,194 @@ namespace bh3d
 		return BH3D_OK;
 	}
 
-
-	int Shader::LoadTypeShader(GLuint &shader, GLenum type, const File & source)
+	int Shader::Reload()
 	{
-		//lecture du fichier
-		std::string buffer;
-		if (source.ReadAndSaveIn(buffer) != BH3D_OK)
+		const std::filesystem::path & vertexPath = m_vertexFile;
+		const std::filesystem::path & fragmentPath = m_fragmentFile;
+		if (!IsValid() || vertexPath.empty() || fragmentPath.empty())
+		{
+			BH3D_LOGGER_WARNING("Shader reload : the shader isn't loaded from files");
+			return BH3D_ERROR;
+		}
+
+		BH3D_GL_CHECK_ERROR;
+
+		std::string vertexBuffer, fragmentBuffer;
+		if (m_vertexFile.ReadAndSaveIn(vertexBuffer) != BH3D_OK || m_fragmentFile.ReadAndSaveIn(fragmentBuffer) != BH3D_OK)
 			return BH3D_ERROR;
 
-		if (LoadTypeShader(shader, type, buffer.c_str()) != BH3D_OK)
+		//The new sources are checked before touching the current program
+		std::string error;
+		const GLuint vertexID = CompileShader(GL_VERTEX_SHADER, vertexBuffer.c_str(), error);
+		const GLuint fragmentID = vertexID ? CompileShader(GL_FRAGMENT_SHADER, fragmentBuffer.c_str(), error) : 0;
+
+		GLint link = GL_FALSE;
+		if (vertexID && fragmentID)
+		{
+			//A failed link breaks a program : the link is tested on a temporary one
+			GLuint testID = glCreateProgram();
+			glAttachShader(testID, vertexID);
+			glAttachShader(testID, fragmentID);
+			for (const auto & attrib : tAttribs)
+				glBindAttribLocation(testID, attrib.index, (GLchar *)attrib.name.data());
+			glLinkProgram(testID);
+			glGetProgramiv(testID, GL_LINK_STATUS, &link);
+			if (link != GL_TRUE)
+			{
+				GLint errorLength = 0;
+				glGetProgramiv(testID, GL_INFO_LOG_LENGTH, &errorLength);
+				error.resize(errorLength + 1, '\0');
+				glGetProgramInfoLog(testID, errorLength, &errorLength, (GLchar*)error.data());
+				BH3D_LOGGER_ERROR(" Shader link fail : " << error);
+			}
+			glDeleteProgram(testID);
+		}
+
+		if (link != GL_TRUE)
 		{
-			BH3D_LOGGER_ERROR("Compilation Shader Fail -> File : " << source.Filename() << " -- error : " << m_error);
+			glDeleteShader(vertexID);
+			glDeleteShader(fragmentID);
+			m_error = std::move(error);
+			BH3D_LOGGER_ERROR("Shader reload fail, the current program is kept -> [VERT] : " << m_vertexFile.Filename() << " -> [FRAG] : " << m_fragmentFile.Filename());
 			return BH3D_ERROR;
 		}
 
-		// Si tout c'est bien passé, on renvoie 0
+		//Same program, new shader objects (none if the program comes from the program cache)
+		if (m_vertexID != 0)
+			glDetachShader(m_programID, m_vertexID);
+		if (m_fragmentID != 0)
+			glDetachShader(m_programID, m_fragmentID);
+		glDeleteShader(m_vertexID);
+		glDeleteShader(m_fragmentID);
+
+		m_vertexID = vertexID;
+		m_fragmentID = fragmentID;
+		glAttachShader(m_programID, m_vertexID);
+		glAttachShader(m_programID, m_fragmentID);
+
+		BindAllAttribLocation();
+		if (s_programCache)
+			glProgramParameteri(m_programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(m_programID);
+
+		if (s_programCache)
+			s_programCache->Store(GetProgramKey(vertexBuffer.c_str(), fragmentBuffer.c_str()), m_programID);
+
+		//The uniform locations can change with the sources
+		ReflectUniforms();
+		DefaultUniformLocation();
+		m_error.clear();
+
+		BH3D_LOGGER("Shader reload -> [VERT] : " << m_vertexFile.Filename() << " -> [FRAG] : " << m_fragmentFile.Filename());
 		return BH3D_OK;
 	}
 
+	bool Shader::UsesFile(const std::filesystem::path & pathname) const
+	{
+		const std::filesystem::path & vertexPath = m_vertexFile;
+		const std::filesystem::path & fragmentPath = m_fragmentFile;
+		const auto normal = pathname.lexically_normal();
+		return !normal.empty() && (normal == vertexPath.lexically_normal() || normal == fragmentPath.lexically_normal());
+	}
+
+	std::size_t Shader::ReloadFile(const std::filesystem::path & pathname)
+	{
+		std::size_t count = 0;
+		for (Shader * shader : s_vFileShaders)
+		{
+			if (!shader->UsesFile(pathname))
+				continue;
+
+			//Not yet valid : the first load failed, the sources are loaded again
+			int result = BH3D_ERROR;
+			if (shader->IsValid())
+				result = shader->Reload();
+			else
+			{
+				const File vertexFile = shader->m_vertexFile;
+				const File fragmentFile = shader->m_fragmentFile;
+				result = shader->Load(vertexFile, fragmentFile);
+			}
+
+			if (result == BH3D_OK)
+				count++;
+		}
+		return count;
+	}
+
+	void Shader::TrackSourceFiles(bool track)
+	{
+		auto it = std::find(s_vFileShaders.begin(), s_vFileShaders.end(), this);
+		if (track && it == s_vFileShaders.end())
+			s_vFileShaders.push_back(this);
+		else if (!track && it != s_vFileShaders.end())
+			s_vFileShaders.erase(it);
+	}
+
 	void Shader::DefaultUniformLocation()
 	{
 		assert(defaultUniform.size() == (int) bh3d::UNIFORM_INDEX::N_NUMBER);
 		for (int uniform_index = (int) bh3d::UNIFORM_INDEX::PROJECTION; uniform_index < (int) bh3d::UNIFORM_INDEX::N_NUMBER; uniform_index++) {
 			const auto & uniform_name = BH3D_UNIFORM_NAME(uniform_index);
-			defaultUniform[uniform_index] = glGetUniformLocation(m_programID, (const GLchar *)uniform_name.c_str());
+			defaultUniform[uniform_index] = GetUniformLocation(uniform_name);
+		}
+
+	}
+
+	void Shader::ReflectUniforms()
+	{
+		m_vUniforms.clear();
+		m_uniformIndex.Clear();
+		if (!IsValid())
+			return;
+
+		BH3D_GL_CHECK_ERROR;
+
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(m_programID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(m_programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+		std::vector<GLchar> buffer((std::size_t)maxLength + 1, '\0');
+		for (GLint i = 0; i < count; i++)
+		{
+			Uniform uniform;
+			GLsizei length = 0;
+			glGetActiveUniform(m_programID, (GLuint)i, (GLsizei)buffer.size(), &length, &uniform.size, &uniform.type, buffer.data());
+
+			//The members of the uniform blocks have no location
+			uniform.location = glGetUniformLocation(m_programID, buffer.data());
+			if (uniform.location < 0)
+				continue;
+
+			uniform.name.assign(buffer.data(), (std::size_t)length);
+			if (uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+				uniform.name.resize(uniform.name.size() - 3);
+
+			m_uniformIndex.Insert(HashFNV1a(uniform.name), (std::uint32_t)m_vUniforms.size());
+			m_vUniforms.push_back(std::move(uniform));
+		}
+
+		//The frame data is shared by all the programs through one uniform buffer
+		const GLuint blockIndex = glGetUniformBlockIndex(m_programID, BH3D_FRAME_UNIFORM_BLOCK);
+		if (blockIndex != GL_INVALID_INDEX)
+			glUniformBlockBinding(m_programID, blockIndex, BH3D_FRAME_UNIFORM_BINDING);
+	}
+
+	GLint Shader::GetUniformLocation(std::string_view name) const
+	{
+		//Array element : name[0] is the array, the other elements are asked to the driver
+		if (!name.empty() && name.back() == ']')
+		{
+			if (name.size() > 3 && name.substr(name.size() - 3) == "[0]")
+				name.remove_suffix(3);
+			else
+				return glGetUniformLocation(m_programID, std::string(name).c_str());
 		}
 
+		const std::uint32_t slot = m_uniformIndex.Find(HashFNV1a(name), [this, name](std::uint32_t i) {
+			return m_vUniforms[i].name == name;
+		});
+		return slot == ResourceIndex::NONE ? -1 : m_vUniforms[slot].location;
 	}
 
 	void Shader::AddAttribLocation(GLuint index, const GLchar* name)
@@ -0,0 +1,377 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <cassert>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <system_error>
+
+#include "BH3D_TextureCache.hpp"
+#include "BH3D_File.hpp"
+#include "BH3D_Hash.hpp"
+#include "BH3D_GLCheckError.hpp"
+#include "BH3D_Logger.hpp"
+#include "BH3D_Common.hpp"
+
+namespace bh3d
+{
+	namespace
+	{
+		//KTX 1.1 file layout (https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html)
+		const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+		constexpr std::uint32_t KTX_ENDIANNESS = 0x04030201;
+		constexpr const char * KTX_SOURCE_KEY = "BH3DSource";
+
+		struct KTXHeader
+		{
+			std::uint32_t endianness;
+			std::uint32_t glType;
+			std::uint32_t glTypeSize;
+			std::uint32_t glFormat;
+			std::uint32_t glInternalFormat;
+			std::uint32_t glBaseInternalFormat;
+			std::uint32_t pixelWidth;
+			std::uint32_t pixelHeight;
+			std::uint32_t pixelDepth;
+			std::uint32_t numberOfArrayElements;
+			std::uint32_t numberOfFaces;
+			std::uint32_t numberOfMipmapLevels;
+			std::uint32_t bytesOfKeyValueData;
+		};
+		static_assert(sizeof(KTXHeader) == 13 * sizeof(std::uint32_t), "KTX header without padding");
+
+		inline std::size_t Align4(std::size_t size) { return (size + 3) & ~std::size_t(3); }
+	}
+
+	std::string TextureCache::GetSourceKey(const std::vector<std::filesystem::path> & vSources) const
+	{
+		std::stringstream ss;
+		for (const auto & source : vSources)
+		{
+			std::error_code ec;
+			const auto time = std::filesystem::last_write_time(source, ec);
+			if (ec)
+				return {};
+			const auto size = std::filesystem::file_size(source, ec);
+			if (ec)
+				return {};
+
+			ss << source.generic_string() << '|' << time.time_since_epoch().count() << '|' << size << ';';
+		}
+		ss << "format=" << (int)m_format;
+		return ss.str();
+	}
+
+	std::filesystem::path TextureCache::GetCachePath(const std::vector<std::filesystem::path> & vSources) const
+	{
+		std::string names;
+		for (const auto & source : vSources)
+			names += source.generic_string() + ';';
+
+		std::stringstream ss;
+		ss << std::hex << std::setw(16) << std::setfill('0') << HashFNV1a(names) << ".ktx";
+		return m_directory / ss.str();
+	}
+
+	bool TextureCache::Load(const std::vector<std::filesystem::path> & vSources, CachedTexture & cached) const
+	{
+		const std::string key = GetSourceKey(vSources);
+		if (key.empty())
+			return BH3D_ERROR;
+
+		const auto path = GetCachePath(vSources);
+		std::error_code ec;
+		if (!std::filesystem::exists(path, ec))
+			return BH3D_ERROR;
+
+		auto file = std::make_shared<MappedFile>();
+		if (!file->Open(path))
+			return BH3D_ERROR;
+
+		const unsigned char * data = file->Data();
+		const std::size_t size = file->Size();
+
+		KTXHeader header;
+		if (size < sizeof(KTX_IDENTIFIER) + sizeof(KTXHeader) || std::memcmp(data, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0)
+		{
+			BH3D_LOGGER_WARNING("Invalid texture cache file : " << path);
+			return BH3D_ERROR;
+		}
+		std::memcpy(&header, data + sizeof(KTX_IDENTIFIER), sizeof(KTXHeader));
+
+		//Only the files written by Store are read (same endianness, 2D or 2D array, no cube map)
+		if (header.endianness != KTX_ENDIANNESS || header.pixelDepth != 0 || header.numberOfFaces != 1 || header.numberOfMipmapLevels == 0)
+		{
+			BH3D_LOGGER_WARNING("Unsupported texture cache file : " << path);
+			return BH3D_ERROR;
+		}
+
+		std::size_t offset = sizeof(KTX_IDENTIFIER) + sizeof(KTXHeader);
+		const std::size_t keyValueEnd = offset + header.bytesOfKeyValueData;
+		if (keyValueEnd > size)
+			return BH3D_ERROR;
+
+		//The source key has to match : the source images may have been edited
+		bool upToDate = false;
+		while (offset + sizeof(std::uint32_t) <= keyValueEnd)
+		{
+			std::uint32_t keyValueSize = 0;
+			std::memcpy(&keyValueSize, data + offset, sizeof(keyValueSize));
+			offset += sizeof(keyValueSize);
+			if (offset + keyValueSize > keyValueEnd)
+				break;
+
+			const char * keyValue = reinterpret_cast<const char *>(data + offset);
+			const std::size_t keyLength = strnlen(keyValue, keyValueSize);
+			if (keyLength < keyValueSize && std::string(keyValue, keyLength) == KTX_SOURCE_KEY)
+			{
+				const char * value = keyValue + keyLength + 1;
+				upToDate = std::string(value, strnlen(value, keyValueSize - keyLength - 1)) == key;
+			}
+			offset += Align4(keyValueSize);
+		}
+		if (!upToDate)
+		{
+			BH3D_LOGGER("Texture cache out of date : " << path);
+			return BH3D_ERROR;
+		}
+		offset = keyValueEnd;
+
+		cached = CachedTexture();
+		cached.width = (GLsizei)header.pixelWidth;
+		cached.height = (GLsizei)header.pixelHeight;
+		cached.layers = (GLsizei)header.numberOfArrayElements;
+		cached.internalFormat = header.glInternalFormat;
+		cached.format = header.glFormat;
+		cached.type = header.glType;
+
+		for (std::uint32_t level = 0; level < header.numberOfMipmapLevels; level++)
+		{
+			std::uint32_t imageSize = 0;
+			if (offset + sizeof(imageSize) > size)
+				return BH3D_ERROR;
+			std::memcpy(&imageSize, data + offset, sizeof(imageSize));
+			offset += sizeof(imageSize);
+			if (offset + imageSize > size)
+			{
+				BH3D_LOGGER_WARNING("Truncated texture cache file : " << path);
+				return BH3D_ERROR;
+			}
+
+			CachedTexture::Level cachedLevel;
+			cachedLevel.width = std::max(1, cached.width >> level);
+			cachedLevel.height = std::max(1, cached.height >> level);
+			cachedLevel.data = data + offset;
+			cachedLevel.byteSize = imageSize;
+			cached.levels.push_back(cachedLevel);
+
+			offset += Align4(imageSize);
+		}
+
+		cached.storage = std::move(file);
+		return BH3D_OK;
+	}
+
+	bool TextureCache::Store(const std::vector<std::filesystem::path> & vSources, const CachedTexture & cached) const
+	{
+		assert(!cached.levels.empty());
+
+		const std::string key = GetSourceKey(vSources);
+		if (key.empty() || cached.levels.empty())
+			return BH3D_ERROR;
+
+		std::error_code ec;
+		std::filesystem::create_directories(m_directory, ec);
+
+		const auto path = GetCachePath(vSources);
+		const char padding[4] = { 0, 0, 0, 0 };
+
+		const std::uint32_t keyValueSize = (std::uint32_t)(std::strlen(KTX_SOURCE_KEY) + 1 + key.size() + 1);
+
+		KTXHeader header;
+		header.endianness = KTX_ENDIANNESS;
+		header.glType = cached.type;
+		header.glTypeSize = 1;
+		header.glFormat = cached.format;
+		header.glInternalFormat = cached.internalFormat;
+		header.glBaseInternalFormat = GL_RGBA;
+		header.pixelWidth = (std::uint32_t)cached.width;
+		header.pixelHeight = (std::uint32_t)cached.height;
+		header.pixelDepth = 0;
+		header.numberOfArrayElements = (std::uint32_t)cached.layers;
+		header.numberOfFaces = 1;
+		header.numberOfMipmapLevels = (std::uint32_t)cached.levels.size();
+		header.bytesOfKeyValueData = (std::uint32_t)(sizeof(keyValueSize) + Align4(keyValueSize));
+
+		const bool stored = WriteFileAtomic(path, [&](std::ostream & os) {
+			os.write(reinterpret_cast<const char *>(KTX_IDENTIFIER), sizeof(KTX_IDENTIFIER));
+			os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+			os.write(reinterpret_cast<const char *>(&keyValueSize), sizeof(keyValueSize));
+			os.write(KTX_SOURCE_KEY, std::strlen(KTX_SOURCE_KEY) + 1);
+			os.write(key.c_str(), key.size() + 1);
+			os.write(padding, Align4(keyValueSize) - keyValueSize);
+
+			for (const auto & level : cached.levels)
+			{
+				const std::uint32_t imageSize = (std::uint32_t)level.byteSize;
+				os.write(reinterpret_cast<const char *>(&imageSize), sizeof(imageSize));
+				os.write(reinterpret_cast<const char *>(level.data), level.byteSize);
+				os.write(padding, Align4(level.byteSize) - level.byteSize);
+			}
+		});
+		if (!stored)
+			return BH3D_ERROR;
+
+		BH3D_LOGGER("Texture cache written : " << path);
+		return BH3D_OK;
+	}
+
+	bool TextureCache::Capture(const Texture & texture, CachedTexture & cached) const
+	{
+		BH3D_GL_CHECK_ERROR;
+
+		const GLenum target = texture.GetGLTarget();
+		assert(texture.IsValid() && (target == GL_TEXTURE_2D || target == GL_TEXTURE_2D_ARRAY));
+		if (!texture.IsValid() || (target != GL_TEXTURE_2D && target != GL_TEXTURE_2D_ARRAY))
+			return BH3D_ERROR;
+
+		glBindTexture(target, texture);
+
+		GLint width = 0, height = 0, depth = 1, maxLevel = 0, minFilter = GL_LINEAR;
+		glGetTexLevelParameteriv(target, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(target, 0, GL_TEXTURE_HEIGHT, &height);
+		if (target == GL_TEXTURE_2D_ARRAY)
+			glGetTexLevelParameteriv(target, 0, GL_TEXTURE_DEPTH, &depth);
+		glGetTexParameteriv(target, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+		glGetTexParameteriv(target, GL_TEXTURE_MIN_FILTER, &minFilter);
+
+		if (width <= 0 || height <= 0 || depth <= 0)
+		{
+			glBindTexture(target, 0);
+			return BH3D_ERROR;
+		}
+
+		//Levels of the mip chain (only the level 0 without mipmap filtering)
+		const bool mipmap = minFilter != GL_LINEAR && minFilter != GL_NEAREST;
+		GLint levelCount = 1;
+		while (mipmap && levelCount <= maxLevel)
+		{
+			GLint levelWidth = 0;
+			glGetTexLevelParameteriv(target, levelCount, GL_TEXTURE_WIDTH, &levelWidth);
+			if (levelWidth == 0)	//end of the generated levels
+				break;
+			levelCount++;
+		}
+
+		//Read back the RGBA8 levels
+		std::vector<std::vector<unsigned char>> vLevels(levelCount);
+		for (GLint level = 0; level < levelCount; level++)
+		{
+			const GLsizei w = std::max(1, width >> level);
+			const GLsizei h = std::max(1, height >> level);
+			vLevels[level].resize((std::size_t)w * h * depth * 4);
+			glGetTexImage(target, level, GL_RGBA, GL_UNSIGNED_BYTE, vLevels[level].data());
+		}
+		glBindTexture(target, 0);
+
+		cached = CachedTexture();
+		cached.width = width;
+		cached.height = height;
+		cached.layers = target == GL_TEXTURE_2D_ARRAY ? depth : 0;
+
+		if (m_format == TextureCacheFormat::BPTC)
+		{
+			//The driver compresses the levels uploaded in a temporary texture with a compressed internal format
+			GLuint tmpTexture = 0;
+			glGenTextures(1, &tmpTexture);
+			glBindTexture(target, tmpTexture);
+
+			std::vector<std::vector<unsigned char>> vCompressedLevels(levelCount);
+			bool compressed = tmpTexture != 0;
+			for (GLint level = 0; compressed && level < levelCount; level++)
+			{
+				const GLsizei w = std::max(1, width >> level);
+				const GLsizei h = std::max(1, height >> level);
+				if (target == GL_TEXTURE_2D_ARRAY)
+					glTexImage3D(target, level, GL_COMPRESSED_RGBA_BPTC_UNORM, w, h, depth, 0, GL_RGBA, GL_UNSIGNED_BYTE, vLevels[level].data());
+				else
+					glTexImage2D(target, level, GL_COMPRESSED_RGBA_BPTC_UNORM, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, vLevels[level].data());
+
+				GLint isCompressed = GL_FALSE, compressedSize = 0;
+				glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED, &isCompressed);
+				glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &compressedSize);
+				compressed = isCompressed == GL_TRUE && compressedSize > 0;
+				if (!compressed)
+					break;
+
+				vCompressedLevels[level].resize((std::size_t)compressedSize);
+				glGetCompressedTexImage(target, level, vCompressedLevels[level].data());
+			}
+
+			glBindTexture(target, 0);
+			if (tmpTexture != 0)
+				glDeleteTextures(1, &tmpTexture);
+
+			if (compressed)
+			{
+				cached.internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+				cached.format = 0;
+				cached.type = 0;
+				vLevels = std::move(vCompressedLevels);
+			}
+			else
+			{
+				BH3D_LOGGER_WARNING("The driver can't compress the texture, the cache is uncompressed");
+			}
+		}
+
+		if (!cached.IsCompressed())
+		{
+			cached.internalFormat = GL_RGBA8;
+			cached.format = GL_RGBA;
+			cached.type = GL_UNSIGNED_BYTE;
+		}
+
+		for (GLint level = 0; level < levelCount; level++)
+		{
+			CachedTexture::Level cachedLevel;
+			cachedLevel.width = std::max(1, width >> level);
+			cachedLevel.height = std::max(1, height >> level);
+			cachedLevel.data = vLevels[level].data();
+			cachedLevel.byteSize = vLevels[level].size();
+			cached.levels.push_back(cachedLevel);
+		}
+
+		//The level pointers stay valid : the vectors are moved, not copied
+		cached.storage = std::make_shared<std::vector<std::vector<unsigned char>>>(std::move(vLevels));
+
+		return BH3D_OK;
+	}
+}
@@ -25,9 +25,11 @@
 
 #include <memory>
 #include <cassert>
+#include <algorithm>
 
 #include "BH3D_GLCheckError.hpp"
 #include "BH3D_Logger.hpp"
+#include "BH3D_Common.hpp"
 
 #include "BH3D_TextureManager.hpp"
 
@@ -55,32 +57,500 @@ namespace bh3d
 
 		assert(texture_id != 0);
 
-		glBindTexture(m_textureTarget, texture_id);
+		Texture texture(texture_id, m_textureTarget);
+		UpdateTextureRGBA(texture, width, height, format, type, pixels);
 
-		glTexParameteri(m_textureTarget, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(m_textureTarget, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(m_textureTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		return texture;
+
+	}
+
+	void TextureManager::UpdateTextureRGBA(const Texture & texture, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+	{
+		BH3D_GL_CHECK_ERROR;
+
+		assert(texture.IsValid());
+		assert(pixels != nullptr);
+
+		const GLenum target = texture.GetGLTarget();
+		glBindTexture(target, texture);
+
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 		if (m_useMipmap)
-			glTexParameteri(m_textureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 
-		glTexImage2D(m_textureTarget,
+		//Allocation, then copy of the pixels
+		glTexImage2D(target,
 			0,
 			GL_RGBA,
 			width, height,
 			0,
 			format,  //GL_RGBA
 			type, //GL_UNSIGNED_BYTE,
-			pixels);
+			nullptr);
+
+		TexSubImage2D(target, width, height, format, type, pixels);
+
+		if (m_useMipmap)
+			glGenerateMipmap(target);
+
+		glBindTexture(target, 0);
+	}
+
+	void TextureManager::UploadTextureRGBA(const Texture & texture, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+	{
+		BH3D_GL_CHECK_ERROR;
+
+		assert(texture.IsValid());
+		assert(pixels != nullptr);
+
+		const GLenum target = texture.GetGLTarget();
+		glBindTexture(target, texture);
+
+		TexSubImage2D(target, width, height, format, type, pixels);
 
 		if (m_useMipmap)
-			glGenerateMipmap(GL_TEXTURE_2D);
+			glGenerateMipmap(target);
 
-		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindTexture(target, 0);
+	}
+
+	void TextureManager::TexSubImage2D(GLenum target, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+	{
+		if (m_usePixelBuffer && m_pixelBuffers.TexSubImage2D(target, 0, width, height, format, type, pixels))
+			return;
 
-		return Texture(texture_id, m_textureTarget);
+		glTexSubImage2D(target, 0, 0, 0, width, height, format, type, pixels);
+	}
+
+	void TextureManager::TexSubImage3D(GLenum target, GLint layer, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+	{
+		if (m_usePixelBuffer && m_pixelBuffers.TexSubImage3D(target, 0, layer, width, height, format, type, pixels))
+			return;
 
+		glTexSubImage3D(target, 0, 0, 0, layer, width, height, 1, format, type, pixels);
 	}
+
+	Texture TextureManager::CreateTextureArrayRGBA(GLsizei width, GLsizei height, GLenum format, GLenum type, const std::vector<const void*> & vLayerPixels)
+	{
+
+		BH3D_GL_CHECK_ERROR;
+
+		assert(!vLayerPixels.empty());
+		assert(width > 0);
+		assert(height > 0);
+		assert(glGenTextures && glTexImage3D);
+
+		GLuint texture_id = 0;
+
+		glGenTextures(1, &texture_id);
+
+		if (texture_id == 0) {
+			BH3D_LOGGER_ERROR("OpenGL can't allocate texture ressource");
+			return {};
+		}
+
+		Texture texture(texture_id, GL_TEXTURE_2D_ARRAY);
+		UpdateTextureArrayRGBA(texture, width, height, format, type, vLayerPixels);
+
+		return texture;
+	}
+
+	void TextureManager::UpdateTextureArrayRGBA(const Texture & texture, GLsizei width, GLsizei height, GLenum format, GLenum type, const std::vector<const void*> & vLayerPixels)
+	{
+		BH3D_GL_CHECK_ERROR;
+
+		assert(texture.IsValid() && texture.GetGLTarget() == GL_TEXTURE_2D_ARRAY);
+		assert(!vLayerPixels.empty());
+
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, m_useMipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+
+		//Allocation of all the layers
+		glTexImage3D(GL_TEXTURE_2D_ARRAY,
+			0,
+			GL_RGBA,
+			width, height, (GLsizei)vLayerPixels.size(),
+			0,
+			format,
+			type,
+			nullptr);
+
+		//Copy of each layer
+		for (std::size_t layer = 0; layer < vLayerPixels.size(); layer++)
+		{
+			assert(vLayerPixels[layer] != nullptr);
+			TexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)layer, width, height, format, type, vLayerPixels[layer]);
+		}
+
+		if (m_useMipmap)
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+
+	Texture TextureManager::LoadArray(const std::vector<std::filesystem::path> & vPathnames, const std::string & resource_name)
+	{
+		if (vPathnames.empty())
+		{
+			assert(!vPathnames.empty() && "Empty path list");
+			return GetDefaultResouce();
+		}
+
+		auto valid_resource_name = resource_name;
+		if (valid_resource_name.empty())
+		{
+			for (const auto & pathname : vPathnames)
+				valid_resource_name += (valid_resource_name.empty() ? "" : ";") + pathname.generic_string();
+		}
+
+		//Check if the resource already exist
+		Texture texture;
+		if (Find(valid_resource_name, texture))
+			return texture;
+
+		if (!LoadArrayResourceFromFiles(vPathnames, texture))
+		{
+			BH3D_LOGGER_WARNING("Can't load the texture array : " << valid_resource_name);
+			return GetDefaultResouce();
+		}
+
+		m_resourceSources[valid_resource_name] = vPathnames;
+		return Add(std::move(texture), valid_resource_name);
+	}
+
+	Texture TextureManager::LoadAsync(const std::filesystem::path & pathname, const std::string & resource_name)
+	{
+		if (pathname.empty())
+		{
+			assert(!pathname.empty() && "Empty path");
+			return GetDefaultResouce();
+		}
+
+		auto valid_resource_name = resource_name.empty() ? pathname.generic_string() : resource_name;
+
+		return LoadAsync(valid_resource_name, { pathname }, 0, [this, pathname](TextureImage & image) {
+			return DecodeResourceFromFile(pathname, image);
+		});
+	}
+
+	Texture TextureManager::LoadArrayAsync(const std::vector<std::filesystem::path> & vPathnames, const std::string & resource_name)
+	{
+		if (vPathnames.empty())
+		{
+			assert(!vPathnames.empty() && "Empty path list");
+			return GetDefaultResouce();
+		}
+
+		auto valid_resource_name = resource_name;
+		if (valid_resource_name.empty())
+		{
+			for (const auto & pathname : vPathnames)
+				valid_resource_name += (valid_resource_name.empty() ? "" : ";") + pathname.generic_string();
+		}
+
+		return LoadAsync(valid_resource_name, vPathnames, (GLsizei)vPathnames.size(), [this, vPathnames](TextureImage & image) {
+			return DecodeArrayResourceFromFiles(vPathnames, image);
+		});
+	}
+
+	Texture TextureManager::LoadAsync(const std::string & resource_name, const std::vector<std::filesystem::path> & vSources, GLsizei layers, std::function<bool(TextureImage &)> && decode)
+	{
+		//Check if the resource already exist (loaded or pending)
+		Texture texture;
+		if (Find(resource_name, texture))
+			return texture;
+
+		//Placeholder in the final OpenGL texture (layers == 0 : 2D texture)
+		if (layers > 0)
+			texture = CreateTextureArrayRGBA(1, 1, GL_RGBA, GL_UNSIGNED_BYTE, std::vector<const void*>(layers, m_placeholderColor.data()));
+		else
+			texture = CreateTextureRGBA(1, 1, GL_RGBA, GL_UNSIGNED_BYTE, m_placeholderColor.data());
+
+		if (!texture.IsValid())
+			return GetDefaultResouce();
+
+		DecodeAsync(resource_name, vSources, texture, std::move(decode));
+		m_resourceSources[resource_name] = vSources;
+
+		BH3D_LOGGER("Resource async : " << resource_name << " (" << m_name << ")");
+
+		return Add(std::move(texture), resource_name);
+	}
+
+	void TextureManager::DecodeAsync(const std::string & resource_name, const std::vector<std::filesystem::path> & vSources, const Texture & texture, std::function<bool(TextureImage &)> && decode)
+	{
+		m_asyncPending.fetch_add(1, std::memory_order_relaxed);
+		JobSystem::Default().Run([this, resource_name, vSources, texture, cache = m_textureCache, decode = std::move(decode)]() {
+			AsyncUpload upload;
+			upload.resource_name = resource_name;
+			upload.vSources = vSources;
+			upload.texture = texture;
+
+			//The cached mip chain is only mapped, else the images are decoded
+			if (cache && cache->Load(vSources, upload.cached) && upload.cached.GetTarget() == texture.GetGLTarget())
+				upload.decoded = true;
+			else
+			{
+				upload.cached = CachedTexture();
+				upload.decoded = decode(upload.image);
+			}
+
+			std::lock_guard<std::mutex> lock(m_asyncMutex);
+			m_asyncUploads.push_back(std::move(upload));
+		}, &m_asyncJobs);
+	}
+
+	std::size_t TextureManager::Reload(const std::filesystem::path & pathname)
+	{
+		const auto changed = pathname.lexically_normal();
+
+		//Textures using the file : known sources, else a texture named by its path (Load)
+		std::vector<std::pair<std::string, std::vector<std::filesystem::path>>> vReloads;
+		for (auto it = m_resourceSources.begin(); it != m_resourceSources.end(); )
+		{
+			Texture texture;
+			if (!Find(it->first, texture))
+			{
+				it = m_resourceSources.erase(it);	//erased resource
+				continue;
+			}
+			if (std::any_of(it->second.begin(), it->second.end(), [&changed](const std::filesystem::path & source) { return source.lexically_normal() == changed; }))
+				vReloads.emplace_back(it->first, it->second);
+			++it;
+		}
+
+		for (const auto & name : { pathname.generic_string(), changed.generic_string() })
+		{
+			Texture texture;
+			const bool listed = std::any_of(vReloads.begin(), vReloads.end(), [&name](const auto & reload) { return reload.first == name; });
+			if (!listed && !m_resourceSources.count(name) && Find(name, texture))
+				vReloads.emplace_back(name, std::vector<std::filesystem::path>{ pathname });
+		}
+
+		for (auto & [resource_name, vSources] : vReloads)
+		{
+			Texture texture;
+			Find(resource_name, texture);
+
+			std::function<bool(TextureImage &)> decode;
+			if (texture.GetGLTarget() == GL_TEXTURE_2D_ARRAY)
+				decode = [this, vSources](TextureImage & image) { return DecodeArrayResourceFromFiles(vSources, image); };
+			else
+				decode = [this, source = vSources.front()](TextureImage & image) { return DecodeResourceFromFile(source, image); };
+
+			BH3D_LOGGER("Resource reload : " << resource_name << " (" << m_name << ")");
+			DecodeAsync(resource_name, vSources, texture, std::move(decode));
+		}
+
+		return vReloads.size();
+	}
+
+	std::size_t TextureManager::UploadAsyncTextures(std::size_t byteBudget)
+	{
+		FreeEvicted();		//the textures evicted by the workers releasing their references are deleted with the OpenGL context
+
+		std::size_t uploadedBytes = 0;
+		for (;;)
+		{
+			AsyncUpload upload;
+			{
+				std::lock_guard<std::mutex> lock(m_asyncMutex);
+				if (m_asyncUploads.empty())
+					break;
+				if (uploadedBytes > 0 && uploadedBytes + m_asyncUploads.front().ByteSize() > byteBudget)
+					break;
+				upload = std::move(m_asyncUploads.front());
+				m_asyncUploads.pop_front();
+			}
+			m_asyncPending.fetch_sub(1, std::memory_order_relaxed);
+
+			//The resource can be erased during the decoding
+			Texture current;
+			if (!Find(upload.resource_name, current) || !(current == upload.texture))
+				continue;
+
+			if (!upload.decoded)
+			{
+				BH3D_LOGGER_WARNING("Can't load the async resource, the placeholder is kept : " << upload.resource_name);
+				continue;
+			}
+
+			const TextureImage & image = upload.image;
+			if (!upload.cached.levels.empty())
+			{
+				UpdateTextureFromCache(upload.texture, upload.cached);
+			}
+			else if (upload.texture.GetGLTarget() == GL_TEXTURE_2D_ARRAY)
+			{
+				std::vector<const void*> vLayerPixels;
+				for (GLsizei layer = 0; layer < image.layers; layer++)
+					vLayerPixels.push_back(image.LayerPixels(layer));
+				UpdateTextureArrayRGBA(upload.texture, image.width, image.height, image.format, image.type, vLayerPixels);
+				StoreCachedTexture(upload.vSources, upload.texture);
+			}
+			else
+			{
+				UpdateTextureRGBA(upload.texture, image.width, image.height, image.format, image.type, image.pixels.data());
+				StoreCachedTexture(upload.vSources, upload.texture);
+			}
+
+			//The placeholder is replaced : the memory budget takes the real size
+			UpdateResourceByteSize(upload.resource_name);
+
+			uploadedBytes += upload.ByteSize();
+			BH3D_LOGGER("Resource ok : " << upload.resource_name << " (" << m_name << ")");
+		}
+
+		return GetAsyncPendingCount();
+	}
+
+	std::size_t TextureManager::AsyncUpload::ByteSize() const
+	{
+		std::size_t byteSize = image.pixels.size();
+		for (const auto & level : cached.levels)
+			byteSize += level.byteSize;
+		return byteSize;
+	}
+
+	bool TextureManager::LoadCachedTexture(const std::vector<std::filesystem::path> & vSources, GLenum target, Texture & texture)
+	{
+		if (!m_textureCache)
+			return BH3D_ERROR;
+
+		CachedTexture cached;
+		if (!m_textureCache->Load(vSources, cached) || cached.GetTarget() != target)
+			return BH3D_ERROR;
+
+		GLuint texture_id = 0;
+		glGenTextures(1, &texture_id);
+		if (texture_id == 0) {
+			BH3D_LOGGER_ERROR("OpenGL can't allocate texture ressource");
+			return BH3D_ERROR;
+		}
+
+		texture = Texture(texture_id, target);
+		UpdateTextureFromCache(texture, cached);
+
+		return BH3D_OK;
+	}
+
+	void TextureManager::StoreCachedTexture(const std::vector<std::filesystem::path> & vSources, const Texture & texture)
+	{
+		if (!m_textureCache || !texture.IsValid())
+			return;
+
+		CachedTexture cached;
+		if (!m_textureCache->Capture(texture, cached))
+			return;
+
+		//Smaller in video memory
+		if (cached.IsCompressed())
+			UpdateTextureFromCache(texture, cached);
+
+		//The file is written by a worker (the levels are kept alive by the copy of cached)
+		JobSystem::Default().Run([cache = m_textureCache, vSources, cached]() {
+			cache->Store(vSources, cached);
+		}, &m_asyncJobs);
+	}
+
+	void TextureManager::UpdateTextureFromCache(const Texture & texture, const CachedTexture & cached)
+	{
+		BH3D_GL_CHECK_ERROR;
+
+		const GLenum target = texture.GetGLTarget();
+		assert(texture.IsValid() && target == cached.GetTarget());
+		assert(!cached.levels.empty());
+
+		glBindTexture(target, texture);
+
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, cached.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, (GLint)cached.levels.size() - 1);
+
+		//The mip chain is uploaded as it is
+		for (std::size_t i = 0; i < cached.levels.size(); i++)
+		{
+			const auto & level = cached.levels[i];
+			if (cached.IsCompressed())
+			{
+				if (target == GL_TEXTURE_2D_ARRAY)
+					glCompressedTexImage3D(target, (GLint)i, cached.internalFormat, level.width, level.height, cached.layers, 0, (GLsizei)level.byteSize, level.data);
+				else
+					glCompressedTexImage2D(target, (GLint)i, cached.internalFormat, level.width, level.height, 0, (GLsizei)level.byteSize, level.data);
+			}
+			else
+			{
+				if (target == GL_TEXTURE_2D_ARRAY)
+					glTexImage3D(target, (GLint)i, cached.internalFormat, level.width, level.height, cached.layers, 0, cached.format, cached.type, level.data);
+				else
+					glTexImage2D(target, (GLint)i, cached.internalFormat, level.width, level.height, 0, cached.format, cached.type, level.data);
+			}
+		}
+
+		glBindTexture(target, 0);
+	}
+
+	std::size_t TextureManager::GetResourceByteSize(const Texture & texture) const
+	{
+		if (!texture.IsValid())
+			return 0;
+
+		BH3D_GL_CHECK_ERROR;
+
+		const GLenum target = texture.GetGLTarget();
+		glBindTexture(target, texture.GetGLTexture());
+
+		//width * height * depth * bytes per pixel of each allocated level
+		std::size_t byteSize = 0;
+		for (GLint level = 0; ; level++)
+		{
+			GLint width = 0, height = 0, depth = 0;
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &width);
+			if (width == 0)
+				break;
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_HEIGHT, &height);
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_DEPTH, &depth);
+
+			GLint compressed = GL_FALSE;
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED, &compressed);
+			if (compressed)
+			{
+				GLint levelSize = 0;
+				glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelSize);
+				byteSize += (std::size_t)levelSize;
+			}
+			else
+			{
+				GLint bits = 0;
+				for (GLenum sizeParam : { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE, GL_TEXTURE_STENCIL_SIZE })
+				{
+					GLint componentBits = 0;
+					glGetTexLevelParameteriv(target, level, sizeParam, &componentBits);
+					bits += componentBits;
+				}
+				byteSize += (std::size_t)width * (std::size_t)height * (std::size_t)std::max(depth, 1) * (std::size_t)((bits + 7) / 8);
+			}
+
+			//Last level of a complete mip chain
+			if (width == 1 && height == 1)
+				break;
+		}
+
+		glBindTexture(target, 0);
+
+		return byteSize;
+	}
+
 	void TextureManager::FreeResource(Texture& ressource)
 	{
 		BH3D_GL_CHECK_ERROR;
@@ -32,6 +32,7 @@
 #include "BH3D_TexturePerlin.hpp"
 #include "BH3D_GLCheckError.hpp"
 #include "BH3D_Logger.hpp"
+#include "BH3D_JobSystem.hpp"
 
 namespace bh3d
 {
@@ -44,42 +45,45 @@ namespace bh3d
 		float xFactor = 1.0f / (width - 1);
 		float yFactor = 1.0f / (height - 1);
 
-		for (int row = 0; row < height; row++) 
-		{
-			for (int col = 0; col < width; col++) 
+		//Each row is independent : the rows are computed by the job system workers
+		JobSystem::Default().ParallelFor(0, (std::size_t)height, 8, [&](std::size_t row_begin, std::size_t row_end) {
+			for (int row = (int)row_begin; row < (int)row_end; row++) 
 			{
-				float x = xFactor * col;
-				float y = yFactor * row;
-				float sum = 0.0f;
-				float freq = baseFreq;
-				float persist = persistence;
-				for (int oct = 0; oct < octave; oct++)
+				for (int col = 0; col < width; col++) 
 				{
-					glm::vec2 p(x * freq, y * freq);
+					float x = xFactor * col;
+					float y = yFactor * row;
+					float sum = 0.0f;
+					float freq = baseFreq;
+					float persist = persistence;
+					for (int oct = 0; oct < octave; oct++)
+					{
+						glm::vec2 p(x * freq, y * freq);
 
-					float val = 0.0f;
-					if (periodic) {
-						val = glm::perlin(p, glm::vec2(freq)) * persist;
-					}
-					else {
-						val = glm::perlin(p) * persist;
-					}
+						float val = 0.0f;
+						if (periodic) {
+							val = glm::perlin(p, glm::vec2(freq)) * persist;
+						}
+						else {
+							val = glm::perlin(p) * persist;
+						}
 
-					sum += val;
+						sum += val;
 
-					float result = (sum + 1.0f) / 2.0f;
+						float result = (sum + 1.0f) / 2.0f;
 
-					// Clamp strictly between 0 and 1
-					result = result > 1.0f ? 1.0f : result;
-					result = result < 0.0f ? 0.0f : result;
+						// Clamp strictly between 0 and 1
+						result = result > 1.0f ? 1.0f : result;
+						result = result < 0.0f ? 0.0f : result;
 
-					// Store in texture
-					pixels[((row * width + col) * octave) + oct] = (GLubyte)(result * 255.0f);
-					freq *= 2.0f;
-					persist *= persistence;
+						// Store in texture
+						pixels[((row * width + col) * octave) + oct] = (GLubyte)(result * 255.0f);
+						freq *= 2.0f;
+						persist *= persistence;
+					}
 				}
 			}
-		}
+		});
 
 		return m_TextureManager.AddTextureRGBA(width,height, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)pixels.data(),"");
 	}
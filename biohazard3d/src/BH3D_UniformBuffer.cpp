@@ -0,0 +1,97 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <cassert>
+#include <utility>
+
+#include "BH3D_UniformBuffer.hpp"
+#include "BH3D_GLCheckError.hpp"
+#include "BH3D_Logger.hpp"
+#include "BH3D_Common.hpp"
+
+namespace bh3d
+{
+	UniformBuffer& UniformBuffer::operator=(UniformBuffer && buffer) noexcept
+	{
+		if (this != &buffer)
+		{
+			Destroy();
+			std::swap(m_buffer, buffer.m_buffer);
+			std::swap(m_binding, buffer.m_binding);
+			std::swap(m_byteSize, buffer.m_byteSize);
+		}
+		return *this;
+	}
+
+	bool UniformBuffer::Create(GLsizeiptr byteSize, GLuint binding)
+	{
+		assert(byteSize > 0);
+		BH3D_GL_CHECK_ERROR;
+
+		Destroy();
+
+		glGenBuffers(1, &m_buffer);
+		if (m_buffer == 0)
+		{
+			BH3D_LOGGER_ERROR("Can't create the uniform buffer");
+			return BH3D_ERROR;
+		}
+
+		m_binding = binding;
+		m_byteSize = byteSize;
+
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		glBufferData(GL_UNIFORM_BUFFER, m_byteSize, nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		Bind();
+		return BH3D_OK;
+	}
+
+	void UniformBuffer::Update(const void * data, GLsizeiptr byteSize)
+	{
+		assert(IsValid() && byteSize <= m_byteSize);
+		BH3D_GL_CHECK_ERROR;
+
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		glBufferData(GL_UNIFORM_BUFFER, m_byteSize, nullptr, GL_DYNAMIC_DRAW);	//orphaning
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, byteSize, data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	void UniformBuffer::Bind() const
+	{
+		assert(IsValid());
+		glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_buffer);
+	}
+
+	void UniformBuffer::Destroy()
+	{
+		if (m_buffer != 0)
+			glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+		m_byteSize = 0;
+	}
+}
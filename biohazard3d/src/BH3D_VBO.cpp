@@ -35,8 +35,12 @@
 */
 
 #include <optional>
+#include <cstring>
+#include <algorithm>
 
+#include "BH3D_Common.hpp"
 #include "BH3D_VBO.hpp"
+#include "BH3D_Logger.hpp"
 
 #define BH3D_BUFFER_OFFSET(i) ((void*)(i))
 
@@ -78,6 +82,26 @@ namespace bh3d
 			}
 		}
 
+		//creation instance buffer (per instance data, updated with UpdateInstanceBufferData)
+		if (vInstanceBuffers.size())
+		{
+			std::size_t fullSize = 0;
+			for (const auto &buffer : vInstanceBuffers)
+				fullSize += buffer.byteSize;
+
+			glGenBuffers(1, &instanceBufferID);
+			glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+			glBufferData(GL_ARRAY_BUFFER, fullSize, nullptr, GL_DYNAMIC_DRAW);
+
+			std::size_t offset = 0;
+			for (const auto &buffer : vInstanceBuffers)
+			{
+				if (buffer.data != nullptr && buffer.byteSize > 0)
+					glBufferSubData(GL_ARRAY_BUFFER, offset, buffer.byteSize, buffer.data);
+				offset += buffer.byteSize;
+			}
+		}
+
 		//creation element array
 		if (vElementBuffers.size())
 		{
@@ -126,38 +150,247 @@ namespace bh3d
 		{
 			//Liaison avec le VBO
 			glBindBuffer(GL_ARRAY_BUFFER, arrayBufferID);
+			AttribPointers(vArrayBuffers);
+		}
 
-			std::size_t offset = 0;
-			for (const auto & buffer : vArrayBuffers)
+		if (instanceBufferID)
+		{
+			//Liaison avec le buffer d'instance
+			glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+			AttribPointers(vInstanceBuffers);
+		}
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void VBO::AttribPointers(const std::vector<ArrayBuffer> & vBuffers)
+	{
+		std::size_t offset = 0;
+		for (const auto & buffer : vBuffers)
+		{
+			std::optional<GLuint> lastAttribIndex;
+			//For each attrib (mainly used with struct of data)
+			for (unsigned int k = 0; k < buffer.nbAttrib; k++)
 			{
-				std::optional<GLuint> lastAttribIndex;
-				//For each attrib (mainly used with struct of data)
-				for (unsigned int k = 0; k < buffer.nbAttrib; k++)
+				if (lastAttribIndex.has_value() && lastAttribIndex == buffer.vAttribIndex[k]) 
+					continue;			//seul le premier est pris en compte en cas de plusieurs attribut identique
+				
+				lastAttribIndex = buffer.vAttribIndex[k];
+
+				glEnableVertexAttribArray(buffer.vAttribIndex[k]);
+
+				if(glVertexAttribIPointer && !buffer.vAttribInType.empty() && buffer.vAttribInType[k] == AttribType::INT)
+					glVertexAttribIPointer(buffer.vAttribIndex[k], buffer.vAttribSize[k], buffer.vAttribType[k], buffer.stride, BH3D_BUFFER_OFFSET(offset + buffer.vAttribOffsetStart[k]));
+				else if(glVertexAttribLPointer && !buffer.vAttribInType.empty() && buffer.vAttribInType[k] == AttribType::DOUBLE)
+					glVertexAttribLPointer(buffer.vAttribIndex[k], buffer.vAttribSize[k], buffer.vAttribType[k], buffer.stride, BH3D_BUFFER_OFFSET(offset + buffer.vAttribOffsetStart[k]));
+				else
 				{
-					if (lastAttribIndex.has_value() && lastAttribIndex == buffer.vAttribIndex[k]) 
-						continue;			//seul le premier est pris en compte en cas de plusieurs attribut identique
-					
-					lastAttribIndex = buffer.vAttribIndex[k];
-
-					glEnableVertexAttribArray(buffer.vAttribIndex[k]);
-
-					if(glVertexAttribIPointer && !buffer.vAttribInType.empty() && buffer.vAttribInType[k] == AttribType::INT)
-						glVertexAttribIPointer(buffer.vAttribIndex[k], buffer.vAttribSize[k], buffer.vAttribType[k], buffer.stride, BH3D_BUFFER_OFFSET(offset + buffer.vAttribOffsetStart[k]));
-					else if(glVertexAttribLPointer && !buffer.vAttribInType.empty() && buffer.vAttribInType[k] == AttribType::DOUBLE)
-						glVertexAttribLPointer(buffer.vAttribIndex[k], buffer.vAttribSize[k], buffer.vAttribType[k], buffer.stride, BH3D_BUFFER_OFFSET(offset + buffer.vAttribOffsetStart[k]));
-					else
-						glVertexAttribPointer(buffer.vAttribIndex[k], buffer.vAttribSize[k], buffer.vAttribType[k], GL_FALSE, buffer.stride, BH3D_BUFFER_OFFSET(offset + buffer.vAttribOffsetStart[k]));
+					const GLboolean normalized = (!buffer.vAttribInType.empty() && buffer.vAttribInType[k] == AttribType::NORMALIZED) ? GL_TRUE : GL_FALSE;
+					glVertexAttribPointer(buffer.vAttribIndex[k], buffer.vAttribSize[k], buffer.vAttribType[k], normalized, buffer.stride, BH3D_BUFFER_OFFSET(offset + buffer.vAttribOffsetStart[k]));
 				}
-				offset += buffer.byteSize;
+
+				if (buffer.divisor > 0)
+					glVertexAttribDivisor(buffer.vAttribIndex[k], buffer.divisor);
 			}
+			offset += buffer.byteSize;
+		}
+	}
+
+	void VBO::UpdateInstanceBufferData(const void *data, std::size_t byteSize, GLenum mod)
+	{
+		assert(instanceBufferID != 0 && "No instance buffer : add a structure array buffer with a divisor before the call of Create");
+		assert(!IsInstanceStream() && "Use CommitInstanceStream with an instance stream");
+		if (instanceBufferID == 0 || IsInstanceStream())
+			return;
+
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+		glBufferData(GL_ARRAY_BUFFER, byteSize, nullptr, mod);		//orphaning, the driver gives a new memory block if the previous one is still used
+		if (data != nullptr && byteSize > 0)
+			glBufferSubData(GL_ARRAY_BUFFER, 0, byteSize, data);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+
+
+	//Instance stream
+	//-------------------------------
+
+	bool VBO::CreateInstanceStream(GLuint instanceCapacity, std::size_t instanceByteSize, GLuint slotCount)
+	{
+		BH3D_GL_CHECK_ERROR;
+
+		assert(instanceBufferID != 0 && "No instance buffer : add a structure array buffer with a divisor before the call of Create");
+		assert(instanceCapacity > 0 && instanceByteSize > 0 && slotCount > 0);
+		if (instanceBufferID == 0 || instanceCapacity == 0 || instanceByteSize == 0 || slotCount == 0)
+			return BH3D_ERROR;
+
+		DeleteInstanceStream();
+
+		//glBufferStorage can be called once on the mutable instance buffer (created by Create), the VAO binding stays valid
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+		GLint immutable = GL_FALSE;
+		if (glBufferStorage)
+			glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_IMMUTABLE_STORAGE, &immutable);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		if (immutable == GL_TRUE)
+		{
+			BH3D_LOGGER_ERROR("The instance stream is already created, call Create to rebuild the instance buffer");
+			return BH3D_ERROR;
+		}
+
+		instanceStream.slotCount = slotCount;
+		instanceStream.instanceCapacity = instanceCapacity;
+		instanceStream.instanceByteSize = instanceByteSize;
+		instanceStream.slotByteSize = instanceCapacity * instanceByteSize;
+		instanceStream.currentSlot = 0;
+		instanceStream.committed = false;
+		instanceStream.vFences.assign(slotCount, nullptr);
+		instanceStream.vDirtyRanges.assign(slotCount, {});
+
+		const std::size_t fullSize = instanceStream.slotByteSize * slotCount;
+
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+		if (glBufferStorage)
+		{
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_ARRAY_BUFFER, fullSize, nullptr, flags);
+			instanceStream.persistentPtr = glMapBufferRange(GL_ARRAY_BUFFER, 0, fullSize, flags);
+			if (instanceStream.persistentPtr == nullptr)
+			{
+				BH3D_LOGGER_ERROR("Can't map the instance stream buffer");
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				DeleteInstanceStream();
+				return BH3D_ERROR;
+			}
+		}
+		else
+		{
+			glBufferData(GL_ARRAY_BUFFER, fullSize, nullptr, GL_DYNAMIC_DRAW);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-			glBindVertexArray(0);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		//The slots are empty, all the instances have to be written once
+		MarkInstanceStreamDirty(0, instanceCapacity);
+
+		return BH3D_OK;
+	}
+
+	void VBO::DeleteInstanceStream()
+	{
+		for (auto & fence : instanceStream.vFences)
+		{
+			if (fence != nullptr)
+				glDeleteSync(fence);
+		}
+
+		if (instanceStream.persistentPtr != nullptr && instanceBufferID != 0)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		instanceStream = InstanceStream();
+	}
 
+	void VBO::MarkInstanceStreamDirty(GLuint firstInstance, GLuint instanceCount)
+	{
+		assert(IsInstanceStream());
+		assert(firstInstance + instanceCount <= instanceStream.instanceCapacity);
+
+		const GLuint lastInstance = firstInstance + instanceCount;
+		for (auto & vRanges : instanceStream.vDirtyRanges)
+		{
+			//Merge with the last range if contiguous (the usual case of a sequential update)
+			if (!vRanges.empty() && firstInstance <= vRanges.back().second && lastInstance >= vRanges.back().first)
+			{
+				vRanges.back().first = std::min(vRanges.back().first, firstInstance);
+				vRanges.back().second = std::max(vRanges.back().second, lastInstance);
+			}
+			else
+			{
+				vRanges.emplace_back(firstInstance, lastInstance);
 			}
+		}
 	}
 
+	GLuint VBO::CommitInstanceStream(const void *data)
+	{
+		BH3D_GL_CHECK_ERROR;
+
+		assert(IsInstanceStream() && "Call CreateInstanceStream before");
+		assert(data != nullptr);
+
+		auto & stream = instanceStream;
+
+		//All the slots are up to date : the GPU can read the current one again
+		if (stream.committed && std::all_of(stream.vDirtyRanges.begin(), stream.vDirtyRanges.end(), [](const auto & vRanges) { return vRanges.empty(); }))
+			return stream.currentSlot * stream.instanceCapacity;
+
+		//The draw calls of the previous slot have been submitted : fence it
+		if (stream.committed)
+		{
+			auto & previousFence = stream.vFences[stream.currentSlot];
+			if (previousFence != nullptr)
+				glDeleteSync(previousFence);
+			previousFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			stream.currentSlot = (stream.currentSlot + 1) % stream.slotCount;
+		}
+		stream.committed = true;
+
+		const GLuint slot = stream.currentSlot;
+		auto & vRanges = stream.vDirtyRanges[slot];
+		const GLuint baseInstance = slot * stream.instanceCapacity;
+
+		if (vRanges.empty())
+			return baseInstance;
+
+		//Wait until the GPU doesn't read the slot anymore
+		if (auto & fence = stream.vFences[slot]; fence != nullptr)
+		{
+			GLenum waitReturn = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			while (waitReturn == GL_TIMEOUT_EXPIRED)
+				waitReturn = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			assert(waitReturn != GL_WAIT_FAILED);
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+
+		const std::size_t slotOffset = slot * stream.slotByteSize;
+		const char *src = static_cast<const char *>(data);
+
+		if (stream.persistentPtr != nullptr)
+		{
+			char *dst = static_cast<char *>(stream.persistentPtr) + slotOffset;
+			for (const auto & range : vRanges)
+				std::memcpy(dst + range.first * stream.instanceByteSize, src + range.first * stream.instanceByteSize, (range.second - range.first) * stream.instanceByteSize);
+		}
+		else
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+			for (const auto & range : vRanges)
+			{
+				const std::size_t offset = range.first * stream.instanceByteSize;
+				const std::size_t size = (range.second - range.first) * stream.instanceByteSize;
+				void *dst = glMapBufferRange(GL_ARRAY_BUFFER, slotOffset + offset, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+				if (dst == nullptr)
+				{
+					BH3D_LOGGER_ERROR("Can't map the instance stream buffer");
+					break;
+				}
+				std::memcpy(dst, src + offset, size);
+				glUnmapBuffer(GL_ARRAY_BUFFER);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		vRanges.clear();
+
+		return baseInstance;
+	}
 
 
 	//Array buffer
@@ -193,11 +426,13 @@ namespace bh3d
 
 	}
 
-	void VBO::AddStructArrayBufferData(GLuint nbAttrib, const GLuint *ptAttribIndex, const GLenum *ptAttribType, const GLuint *ptAttribSize, const GLuint *ptAttribOffsetStart, GLuint stride, std::size_t size, const void *data, const AttribType *ptAttribInType)
+	void VBO::AddStructArrayBufferData(GLuint nbAttrib, const GLuint *ptAttribIndex, const GLenum *ptAttribType, const GLuint *ptAttribSize, const GLuint *ptAttribOffsetStart, GLuint stride, std::size_t size, const void *data, const AttribType *ptAttribInType, GLuint divisor)
 	{
-		vArrayBuffers.push_back(ArrayBuffer());
-		auto & refArrayBuffer = vArrayBuffers.back();
+		auto & vBuffers = (divisor > 0) ? vInstanceBuffers : vArrayBuffers;
+		vBuffers.push_back(ArrayBuffer());
+		auto & refArrayBuffer = vBuffers.back();
 
+		refArrayBuffer.divisor = divisor;
 		refArrayBuffer.nbAttrib = nbAttrib;
 		refArrayBuffer.byteSize = size;
 		refArrayBuffer.data = data;
@@ -51,6 +51,20 @@ namespace bh3d
 
 	}
 
+	void TextureManagerOpenCV::UpdateTexture(const Texture & texture, const cv::Mat & img)
+	{
+		auto[formated_img, format] = FormatedMatForGL(img);
+
+		TextureManager::UploadTextureRGBA(
+			texture,
+			img.cols,
+			img.rows,
+			format,
+			GL_UNSIGNED_BYTE,
+			formated_img.ptr<const void>()
+		);
+	}
+
 	Texture TextureManagerOpenCV::AddTexture(const cv::Mat & img, const std::string & texture_name)
 	{
 
@@ -118,15 +132,38 @@ namespace bh3d
 
 	bool TextureManagerOpenCV::LoadResourceFromFile(const std::filesystem::path & pathname, Texture& texture) 
 	{
+		if (LoadCachedTexture({ pathname }, m_textureTarget, texture))
+			return true;
+
 		cv::Mat img = cv::imread(pathname.generic_string(), cv::IMREAD_UNCHANGED);
 		if (img.empty()) {
 			BH3D_LOGGER_WARNING("Opencv can't load the image :" << pathname);
 			return false;
 		}
 		texture = TextureManagerOpenCV::CreateTextureRGBA(img);
+		StoreCachedTexture({ pathname }, texture);
 		return texture.IsValid();
 	}
 
+	bool TextureManagerOpenCV::DecodeResourceFromFile(const std::filesystem::path & pathname, TextureImage & image)
+	{
+		cv::Mat img = cv::imread(pathname.generic_string(), cv::IMREAD_UNCHANGED);
+		if (img.empty()) {
+			BH3D_LOGGER_WARNING("Opencv can't load the image :" << pathname);
+			return false;
+		}
+
+		auto[formated_img, format] = FormatedMatForGL(img);
+
+		image.width = img.cols;
+		image.height = img.rows;
+		image.layers = 1;
+		image.format = format;
+		image.type = GL_UNSIGNED_BYTE;
+		image.pixels.assign(formated_img.datastart, formated_img.dataend);
+		return true;
+	}
+
 	bool TextureManagerOpenCV::LoadResourceFromRaw(const void * input, Texture& texture) 
 	{
 #ifdef _DEBUG
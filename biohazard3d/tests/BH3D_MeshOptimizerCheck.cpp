@@ -0,0 +1,249 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+//CPU check of the mesh optimization passes : the triangles of a shuffled grid are reordered and the ACMR has to go down,
+//the overdraw and vertex fetch passes keep the triangles, and Optimize keeps the positions of each triangle of a mesh and of its LOD
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "BH3D_MeshOptimizer.hpp"
+
+namespace
+{
+	constexpr unsigned int GRID_SIZE = 100;		//quads per side
+	constexpr unsigned int ROW = GRID_SIZE + 1;
+
+	//Grid triangles in a shuffled order (the worst case for the post transform cache)
+	std::vector<unsigned int> BuildShuffledGrid(unsigned int size)
+	{
+		const unsigned int row = size + 1;
+		std::vector<unsigned int> vTriangles;
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				const unsigned int v = y * row + x;
+				vTriangles.insert(vTriangles.end(), { v, v + row, v + 1, v + 1, v + row, v + row + 1 });
+			}
+		}
+
+		std::vector<unsigned int> vOrder(vTriangles.size() / 3);
+		for (unsigned int i = 0; i < vOrder.size(); i++)
+			vOrder[i] = i;
+		std::shuffle(vOrder.begin(), vOrder.end(), std::mt19937(42));
+
+		std::vector<unsigned int> vIndices;
+		vIndices.reserve(vTriangles.size());
+		for (auto t : vOrder)
+			vIndices.insert(vIndices.end(), vTriangles.begin() + t * 3, vTriangles.begin() + t * 3 + 3);
+		return vIndices;
+	}
+
+	std::vector<glm::vec3> BuildGridPositions(unsigned int size)
+	{
+		std::vector<glm::vec3> vPositions;
+		for (unsigned int y = 0; y <= size; y++)
+		{
+			for (unsigned int x = 0; x <= size; x++)
+				vPositions.emplace_back((float)x, (float)y, (float)((x * 7 + y * 3) % 5));
+		}
+		return vPositions;
+	}
+
+	//Triangles as position triples, sorted, each one starting by its smallest position (the winding is kept)
+	using Triangle = std::array<std::array<float, 3>, 3>;
+	std::vector<Triangle> SortedTriangles(const unsigned int * pIndices, std::size_t nIndices, const glm::vec3 * pPositions)
+	{
+		std::vector<Triangle> vSorted;
+		for (std::size_t i = 0; i < nIndices; i += 3)
+		{
+			Triangle triangle;
+			for (int k = 0; k < 3; k++)
+			{
+				const glm::vec3 & p = pPositions[pIndices[i + k]];
+				triangle[k] = { p.x, p.y, p.z };
+			}
+			std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+			vSorted.push_back(triangle);
+		}
+		std::sort(vSorted.begin(), vSorted.end());
+		return vSorted;
+	}
+
+	//Normal stored with each vertex to check that the streams are remapped together
+	glm::vec3 NormalOf(const glm::vec3 & position)
+	{
+		return glm::vec3(position.y, position.z, position.x);
+	}
+}
+
+int main()
+{
+	const std::vector<glm::vec3> vPositions = BuildGridPositions(GRID_SIZE);
+	const std::size_t nVertices = (std::size_t)ROW * ROW;
+	const std::vector<unsigned int> vShuffled = BuildShuffledGrid(GRID_SIZE);
+	const std::vector<Triangle> vGridTriangles = SortedTriangles(vShuffled.data(), vShuffled.size(), vPositions.data());
+
+	//Vertex cache : same triangles, ACMR close to the one of a strip order (3.0 -> about 0.68)
+	std::vector<unsigned int> vIndices = vShuffled;
+	const float before = bh3d::MeshOptimizer::ComputeACMR(vIndices.data(), vIndices.size(), nVertices);
+	bh3d::MeshOptimizer::OptimizeVertexCache(vIndices.data(), vIndices.size(), nVertices);
+	const float after = bh3d::MeshOptimizer::ComputeACMR(vIndices.data(), vIndices.size(), nVertices);
+
+	std::printf("ACMR : %.3f -> %.3f\n", before, after);
+
+	if (SortedTriangles(vIndices.data(), vIndices.size(), vPositions.data()) != vGridTriangles)
+	{
+		std::printf("The optimized triangles differ from the grid triangles\n");
+		return 1;
+	}
+
+	if (!(after < 0.8f))
+	{
+		std::printf("The vertex cache optimization doesn't reach an ACMR under 0.8\n");
+		return 1;
+	}
+
+	//Overdraw : same triangles, ACMR within the allowed degradation
+	bh3d::MeshOptimizer::OptimizeOverdraw(vIndices.data(), vIndices.size(), vPositions.data(), nVertices, 1.05f);
+	const float afterOverdraw = bh3d::MeshOptimizer::ComputeACMR(vIndices.data(), vIndices.size(), nVertices);
+
+	std::printf("ACMR after the overdraw pass : %.3f\n", afterOverdraw);
+
+	if (SortedTriangles(vIndices.data(), vIndices.size(), vPositions.data()) != vGridTriangles)
+	{
+		std::printf("The overdraw pass changes the triangles\n");
+		return 1;
+	}
+
+	if (afterOverdraw > after * 1.05f + 0.01f)
+	{
+		std::printf("The overdraw pass degrades the ACMR more than its threshold\n");
+		return 1;
+	}
+
+	//Vertex fetch : vertices numbered in the order of their first use, same triangles once the positions are remapped
+	std::vector<glm::vec3> vRemappedPositions = vPositions;
+	const std::vector<unsigned int> vRemap = bh3d::MeshOptimizer::OptimizeVertexFetch(vIndices.data(), vIndices.size(), nVertices);
+	bh3d::MeshOptimizer::RemapVertices(vRemappedPositions.data(), vRemap);
+
+	unsigned int next = 0;
+	for (auto id : vIndices)
+	{
+		if (id > next)
+		{
+			std::printf("The vertices are not numbered in the order of their first use\n");
+			return 1;
+		}
+		if (id == next)
+			next++;
+	}
+
+	if (SortedTriangles(vIndices.data(), vIndices.size(), vRemappedPositions.data()) != vGridTriangles)
+	{
+		std::printf("The vertex fetch pass changes the triangles\n");
+		return 1;
+	}
+
+	//Optimize on a mesh with a LOD : each triangle of each LOD keeps its positions, and the normals follow their vertices
+	{
+		constexpr unsigned int MESH_SIZE = 12;
+		const std::vector<glm::vec3> vMeshPositions = BuildGridPositions(MESH_SIZE);
+		const std::vector<unsigned int> vMeshIndices = BuildShuffledGrid(MESH_SIZE);
+
+		std::vector<glm::vec3> vNormals;
+		for (const auto & p : vMeshPositions)
+			vNormals.push_back(NormalOf(p));
+
+		std::vector<bh3d::Face> vFaces(vMeshIndices.size() / 3);
+		for (std::size_t i = 0; i < vMeshIndices.size(); i++)
+			vFaces[i / 3].id[i % 3] = vMeshIndices[i];
+
+		//Shifted vertex range : a second submesh before the grid
+		const std::vector<glm::vec3> vQuadPositions = { { -1, -1, 0 }, { -2, -1, 0 }, { -2, -2, 0 }, { -1, -2, 0 } };
+		std::vector<bh3d::Face> vQuadFaces(2);
+		vQuadFaces[0].id[0] = 0; vQuadFaces[0].id[1] = 1; vQuadFaces[0].id[2] = 2;
+		vQuadFaces[1].id[0] = 0; vQuadFaces[1].id[1] = 2; vQuadFaces[1].id[2] = 3;
+		std::vector<glm::vec3> vQuadNormals;
+		for (const auto & p : vQuadPositions)
+			vQuadNormals.push_back(NormalOf(p));
+
+		bh3d::Mesh mesh;
+		mesh.AddSubMesh(vQuadFaces, vQuadPositions, {}, vQuadNormals);
+		mesh.AddSubMesh(vFaces, vMeshPositions, {}, vNormals);
+
+		//LOD : every other triangle of each submesh
+		std::vector<std::vector<bh3d::Face>> vLodFaces(2);
+		for (std::size_t s = 0; s < 2; s++)
+		{
+			const auto & subMesh = mesh.GetTabSubMeshes()[s];
+			for (std::size_t f = subMesh.faceOffset; f < subMesh.faceOffset + subMesh.nFaces; f += 2)
+				vLodFaces[s].push_back(mesh.GetTabFace()[f]);
+		}
+		if (!mesh.AddLod(vLodFaces))
+		{
+			std::printf("The LOD can't be added to the mesh\n");
+			return 1;
+		}
+
+		auto SubMeshTriangles = [&mesh](std::size_t s) {
+			const auto & subMesh = mesh.GetTabSubMeshes()[s];
+			return SortedTriangles(mesh.GetTabFace()[subMesh.faceOffset].id, subMesh.nFaces * 3, mesh.GetTabPosition().data());
+		};
+
+		std::vector<std::vector<Triangle>> vBefore;
+		for (std::size_t s = 0; s < mesh.GetSubMeshCount(); s++)
+			vBefore.push_back(SubMeshTriangles(s));
+
+		const bh3d::MeshOptimizer::Report report = bh3d::MeshOptimizer::Optimize(mesh);
+		std::printf("Mesh ACMR : %.3f -> %.3f\n", report.acmrBefore, report.acmrAfter);
+
+		for (std::size_t s = 0; s < mesh.GetSubMeshCount(); s++)
+		{
+			if (SubMeshTriangles(s) != vBefore[s])
+			{
+				std::printf("Optimize changes the triangles of the submesh %zu\n", s);
+				return 1;
+			}
+		}
+
+		const auto & vOptimizedPositions = mesh.GetTabPosition();
+		const auto & vOptimizedNormals = mesh.GetTabNormal();
+		for (std::size_t v = 0; v < vOptimizedPositions.size(); v++)
+		{
+			if (vOptimizedNormals[v] != NormalOf(vOptimizedPositions[v]))
+			{
+				std::printf("Optimize doesn't remap the normals with the positions\n");
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
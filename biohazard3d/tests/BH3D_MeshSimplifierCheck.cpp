@@ -0,0 +1,249 @@
+/*
+ * Biohazard3D
+ * The MIT License
+ *
+ * Copyright 2014 Robxley (Alexis Cailly).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+//CPU check of the quadric simplification : index count reached on a closed mesh, no flipped triangle, borders kept,
+//and LOD faces inside the vertex range of their submesh
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "BH3D_MeshSimplifier.hpp"
+
+namespace
+{
+	//Closed sphere without attribute seam : subdivided icosahedron, counter clockwise triangles seen from outside
+	void BuildIcosphere(unsigned int subdivisions, std::vector<glm::vec3> & vPositions, std::vector<unsigned int> & vIndices)
+	{
+		const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+		vPositions = {
+			{ -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+			{ 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+			{ t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 }
+		};
+		for (auto & p : vPositions)
+			p = glm::normalize(p);
+
+		vIndices = {
+			0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+			1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+			3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+			4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1
+		};
+
+		for (unsigned int s = 0; s < subdivisions; s++)
+		{
+			std::map<std::pair<unsigned int, unsigned int>, unsigned int> middles;
+			auto Middle = [&](unsigned int a, unsigned int b) {
+				const auto key = std::make_pair(std::min(a, b), std::max(a, b));
+				auto it = middles.find(key);
+				if (it != middles.end())
+					return it->second;
+				vPositions.push_back(glm::normalize(vPositions[a] + vPositions[b]));
+				const unsigned int id = (unsigned int)vPositions.size() - 1;
+				middles[key] = id;
+				return id;
+			};
+
+			std::vector<unsigned int> vSubdivided;
+			for (std::size_t i = 0; i < vIndices.size(); i += 3)
+			{
+				const unsigned int a = vIndices[i], b = vIndices[i + 1], c = vIndices[i + 2];
+				const unsigned int ab = Middle(a, b), bc = Middle(b, c), ca = Middle(c, a);
+				vSubdivided.insert(vSubdivided.end(), { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca });
+			}
+			vIndices.swap(vSubdivided);
+		}
+	}
+
+	//Open height field of size x size quads in [0, size]^2, counter clockwise triangles seen from +z
+	void BuildTerrain(unsigned int size, std::vector<glm::vec3> & vPositions, std::vector<unsigned int> & vIndices)
+	{
+		const unsigned int row = size + 1;
+		vPositions.clear();
+		for (unsigned int y = 0; y < row; y++)
+		{
+			for (unsigned int x = 0; x < row; x++)
+				vPositions.emplace_back((float)x, (float)y, 0.5f * std::sin(0.3f * x) * std::cos(0.2f * y));
+		}
+
+		vIndices.clear();
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				const unsigned int v = y * row + x;
+				vIndices.insert(vIndices.end(), { v, v + 1, v + row, v + 1, v + row + 1, v + row });
+			}
+		}
+	}
+
+	glm::vec3 TriangleNormal(const std::vector<glm::vec3> & vPositions, const unsigned int * ids)
+	{
+		return glm::cross(vPositions[ids[1]] - vPositions[ids[0]], vPositions[ids[2]] - vPositions[ids[0]]);
+	}
+
+	//Edges used by a single triangle
+	std::vector<std::pair<unsigned int, unsigned int>> BorderEdges(const std::vector<unsigned int> & vIndices)
+	{
+		std::map<std::pair<unsigned int, unsigned int>, int> edges;
+		for (std::size_t i = 0; i < vIndices.size(); i++)
+		{
+			const unsigned int a = vIndices[i];
+			const unsigned int b = vIndices[i - i % 3 + (i + 1) % 3];
+			edges[std::make_pair(std::min(a, b), std::max(a, b))]++;
+		}
+
+		std::vector<std::pair<unsigned int, unsigned int>> vBorders;
+		for (const auto & edge : edges)
+		{
+			if (edge.second == 1)
+				vBorders.push_back(edge.first);
+		}
+		return vBorders;
+	}
+}
+
+int main()
+{
+	int errors = 0;
+
+	//Closed mesh : the target index count is reached and the triangles keep facing outward
+	{
+		std::vector<glm::vec3> vPositions;
+		std::vector<unsigned int> vIndices;
+		BuildIcosphere(3, vPositions, vIndices);
+
+		const std::size_t target = (vIndices.size() / 12) * 3;		//25% of the triangles
+		const std::vector<unsigned int> vSimplified = bh3d::MeshSimplifier::Simplify(vIndices.data(), vIndices.size(), vPositions.data(), vPositions.data(), vPositions.size(), target);
+
+		std::printf("Sphere : %zu -> %zu indices (target %zu)\n", vIndices.size(), vSimplified.size(), target);
+
+		if (vSimplified.size() > target + target / 10 || vSimplified.size() + target / 10 < target)
+		{
+			std::printf("The simplified sphere doesn't reach the target index count\n");
+			errors++;
+		}
+
+		for (std::size_t i = 0; i < vSimplified.size(); i += 3)
+		{
+			const glm::vec3 center = (vPositions[vSimplified[i]] + vPositions[vSimplified[i + 1]] + vPositions[vSimplified[i + 2]]) / 3.0f;
+			if (glm::dot(TriangleNormal(vPositions, vSimplified.data() + i), center) <= 0.0f)
+			{
+				std::printf("Flipped triangle in the simplified sphere\n");
+				errors++;
+				break;
+			}
+		}
+	}
+
+	//Open mesh : the triangles keep facing +z and the border vertices stay on the border of the terrain
+	{
+		constexpr unsigned int SIZE = 32;
+		std::vector<glm::vec3> vPositions;
+		std::vector<unsigned int> vIndices;
+		BuildTerrain(SIZE, vPositions, vIndices);
+
+		const std::size_t target = (vIndices.size() / 12) * 3;
+		const std::vector<unsigned int> vSimplified = bh3d::MeshSimplifier::Simplify(vIndices.data(), vIndices.size(), vPositions.data(), nullptr, vPositions.size(), target);
+
+		std::printf("Terrain : %zu -> %zu indices (target %zu)\n", vIndices.size(), vSimplified.size(), target);
+
+		for (std::size_t i = 0; i < vSimplified.size(); i += 3)
+		{
+			if (TriangleNormal(vPositions, vSimplified.data() + i).z <= 0.0f)
+			{
+				std::printf("Flipped triangle in the simplified terrain\n");
+				errors++;
+				break;
+			}
+		}
+
+		//A border edge of the simplified terrain lies on a side of the square
+		auto OnSameSide = [](const glm::vec3 & a, const glm::vec3 & b) {
+			const float size = (float)SIZE;
+			return (a.x == 0.0f && b.x == 0.0f) || (a.x == size && b.x == size) || (a.y == 0.0f && b.y == 0.0f) || (a.y == size && b.y == size);
+		};
+		for (const auto & edge : BorderEdges(vSimplified))
+		{
+			if (!OnSameSide(vPositions[edge.first], vPositions[edge.second]))
+			{
+				std::printf("A border vertex of the terrain left the border\n");
+				errors++;
+				break;
+			}
+		}
+	}
+
+	//LODs of a mesh of two submeshes : the faces of each LOD submesh use only the vertices of the submesh
+	{
+		std::vector<glm::vec3> vSpherePositions, vTerrainPositions;
+		std::vector<unsigned int> vSphereIndices, vTerrainIndices;
+		BuildIcosphere(2, vSpherePositions, vSphereIndices);
+		BuildTerrain(16, vTerrainPositions, vTerrainIndices);
+
+		auto ToFaces = [](const std::vector<unsigned int> & vIndices) {
+			std::vector<bh3d::Face> vFaces(vIndices.size() / 3);
+			for (std::size_t i = 0; i < vIndices.size(); i++)
+				vFaces[i / 3].id[i % 3] = vIndices[i];
+			return vFaces;
+		};
+
+		bh3d::Mesh mesh;
+		mesh.AddSubMesh(ToFaces(vSphereIndices), vSpherePositions, {}, vSpherePositions);
+		mesh.AddSubMesh(ToFaces(vTerrainIndices), vTerrainPositions, {}, std::vector<glm::vec3>(vTerrainPositions.size(), glm::vec3(0.0f, 0.0f, 1.0f)));
+
+		const unsigned int lodCount = bh3d::MeshSimplifier::GenerateLods(mesh, 3);
+		std::printf("LODs : %u\n", lodCount);
+
+		if (lodCount != 3)
+		{
+			std::printf("The mesh doesn't get the requested LODs\n");
+			errors++;
+		}
+
+		const auto & vSubMeshes = mesh.GetTabSubMeshes();
+		const auto & vFaces = mesh.GetTabFace();
+		for (const auto & subMesh : vSubMeshes)
+		{
+			for (std::size_t f = subMesh.faceOffset; f < subMesh.faceOffset + subMesh.nFaces; f++)
+			{
+				for (auto id : vFaces[f].id)
+				{
+					if (id < subMesh.vertexOffset || id >= subMesh.vertexOffset + subMesh.nVertices)
+					{
+						std::printf("A LOD face uses a vertex outside its submesh\n");
+						return 1;
+					}
+				}
+			}
+		}
+	}
+
+	return errors ? 1 : 0;
+}